@@ -45,6 +45,9 @@ extern EXPORT nh_bool nh_start_game(int fd, const char *name, int role, int race
 extern EXPORT int nh_command(const char *cmd, int rep, struct nh_cmd_arg *arg);
 extern EXPORT const char *const *nh_get_copyright_banner(void);
 
+/* log.c */
+extern EXPORT void nh_set_save_timer(void (*timer)(nh_bool done));
+
 /* logreplay.c */
 extern EXPORT nh_bool nh_view_replay_start(int fd, struct nh_window_procs *rwinprocs,
 					   struct nh_replay_info *info);
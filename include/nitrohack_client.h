@@ -36,6 +36,29 @@ enum authresult {
 };
 
 
+/* optional protocol features, announced by the client in "caps" during auth */
+#define NHNET_CAP_ANIMATION	(1 << 0)	/* understands play_animation */
+#define NHNET_CAP_BINARY_DISPLAY (1 << 1)	/* understands binary dbuf data */
+#define NHNET_CAP_COMPRESSION	(1 << 2)	/* understands compressed frames */
+#define NHNET_CAP_ALL		(NHNET_CAP_ANIMATION | NHNET_CAP_BINARY_DISPLAY | \
+				 NHNET_CAP_COMPRESSION)
+
+/* compressed frames: marker byte, 4 byte big-endian payload length, payload */
+#define NHNET_FRAME_MARKER	0x1f
+#define NHNET_FRAME_HEADER	5
+#define NHNET_Z_HISTORY		(32 * 1024)
+
+/* per-connection compression state, see netcompress.c */
+struct nhnet_zstream {
+    unsigned char *buf;	/* history, followed by the message being coded */
+    int histlen, bufsize;
+    int start;		/* compressor: the history begins at buf + start */
+    int hashed;		/* compressor: positions in buf that are in the chains */
+    int *head, *chain;	/* hash chains for the compressor */
+    int chainsize;
+};
+
+
 struct nhnet_game {
     int gameid;
     enum nh_log_status status;
@@ -85,6 +108,15 @@ extern EXPORT struct nh_topten_entry *nhnet_get_topten(int *out_len, char *statu
 extern EXPORT int nhnet_change_email(const char *email);
 extern EXPORT int nhnet_change_password(const char *password);
 
+/* netcompress.c: shared with the server, not part of the client API */
+extern void nhnet_zstream_reset(struct nhnet_zstream *zs);
+extern void nhnet_zstream_free(struct nhnet_zstream *zs);
+extern unsigned char *nhnet_compress(struct nhnet_zstream *zs, const char *data,
+				     int len, int *framelen);
+extern int nhnet_frame_length(const unsigned char *buf, int len);
+extern char *nhnet_decompress(struct nhnet_zstream *zs,
+			      const unsigned char *frame, int framelen);
+
 #undef EXPORT
 
 #if defined(NHNET_TRANSPARENT) && !defined(libnitrohack_client_EXPORTS)
@@ -514,6 +514,21 @@ struct nh_dbuf_entry {
     short dgnflags; /* encode/decode parts with macros below */
 };
 
+/* one map cell changed by a frame of a batched animation */
+struct nh_anim_cell {
+    short x, y;
+    struct nh_dbuf_entry dbe;
+};
+
+/* A frame of a batched animation passed by win_play_animation: the cells
+ * cells[first_cell .. first_cell + cell_count - 1] are drawn, then the display
+ * waits for "delay" delay_output periods. */
+struct nh_anim_frame {
+    int first_cell;
+    int cell_count;
+    int delay;
+};
+
 #define NH_EFFECT_TYPE(e) ((enum nh_effect_types)((e) >> 16))
 #define NH_EFFECT_ID(e) (((e) - 1) & 0xffff)
 
@@ -652,6 +667,9 @@ struct nh_window_procs {
     void (*win_outrip)(struct nh_menuitem *items,int icount, nh_bool tombstone,
 		       const char *name, int gold, const char *killbuf, int end_how, int year);
     void (*win_print_message_nonblocking)(int turn, const char *msg);
+    /* optional; if NULL, animations are sent as individual screen updates */
+    void (*win_play_animation)(struct nh_anim_frame *frames, int nframes,
+			       struct nh_anim_cell *cells, int ux, int uy);
 };
 
 #endif
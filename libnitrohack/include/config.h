@@ -18,6 +18,10 @@
 
 #define PANICLOG "paniclog"	/* log of panic and impossible events */
 
+/* count the calls of attacktype(), dmgtype() and related lookups in mondata.c;
+ * the #attacks wizard mode command shows the counts. */
+/* #define ATTK_STATS */
+
 #include "global.h"	/* Define everything else according to choices above */
 
 #endif /* CONFIG_H */
@@ -21,6 +21,8 @@ typedef struct dlb_library {
     long nentries;	/* # of files in directory */
     long rev;		/* dlb file revision */
     long strsize;	/* dlb file string size */
+    const char *map;	/* read-only mapping of the whole file, or NULL */
+    long mapsize;	/* size of the mapping */
 } library;
 
 /* library definitions */
@@ -12,6 +12,11 @@
 #define NORETURN __attribute__((noreturn))
 #endif
 
+/* ### alias.c ### */
+
+extern void alias_build(struct alias_table *at, const int *weights, int n);
+extern void alias_free(struct alias_table *at);
+
 /* ### allmain.c ### */
 
 extern void stop_occupation(void);
@@ -131,6 +136,7 @@ extern int getbones(d_level *levnum);
 
 extern void bot(void);
 extern int title_to_mon(const char *,int *,int *);
+extern int title_to_mon_linear(const char *,int *,int *);
 extern void max_rank_sz(void);
 extern const char *rank_of(int, short, boolean);
 
@@ -231,6 +237,7 @@ extern void under_ground(int);
 extern void under_water(int);
 extern void swallowed(int);
 extern void see_monsters(void);
+extern void see_nearby_monsters(void);
 extern void set_mimic_blocking(void);
 extern void see_objects(void);
 extern void see_traps(void);
@@ -253,10 +260,16 @@ extern void flush_screen_enable(void);
 extern void flush_screen_disable(void);
 extern void flush_screen(void);
 extern void flush_screen_nopos(void);
+extern void anim_begin(void);
+extern void anim_end(void);
+extern void anim_flush(void);
+extern void anim_free(void);
+extern void anim_delay_output(void);
 extern int back_to_cmap(struct level *lev, xchar x, xchar y);
 extern int zapdir_to_effect(int,int,int,boolean);
 extern void dump_screen(FILE *dumpfp);
 extern void set_wall_state(struct level *lev);
+extern void prime_bg_memo(struct level *lev);
 
 /* ### do.c ### */
 
@@ -591,6 +604,7 @@ extern boolean may_passwall(struct level *lev, xchar x, xchar y);
 extern boolean bad_rock(const struct permonst *,boolean,xchar,xchar);
 extern boolean invocation_pos(const d_level *dlev, xchar x, xchar y);
 extern boolean test_move(int, int, int, int, int, int);
+extern void reset_travel_cache(void);
 extern boolean try_escape_trap(xchar x, xchar y, schar dx, schar dy);
 extern int domove(schar dx, schar dy, schar dz);
 extern void invocation_message(void);
@@ -831,6 +845,7 @@ extern const struct permonst *rndmonst(struct level *lev);
 extern void reset_rndmonst(int);
 extern void save_rndmonst_state(struct memfile *mf);
 extern void restore_rndmonst_state(struct memfile *mf);
+extern void free_rndmonst_tables(void);
 extern boolean monclass_nogen(char);
 extern const struct permonst *mkclass(const d_level *dlev, char,int);
 extern int adj_lev(const d_level *dlev, const struct permonst *ptr);
@@ -1070,6 +1085,10 @@ extern void setmangry(struct monst *);
 extern void wakeup(struct monst *);
 extern void wake_nearby(void);
 extern void wake_nearto(int,int,int);
+extern int monsters_within(struct level *lev, int x, int y, int dist,
+                           struct monst **list);
+extern int monsters_around(struct level *lev, int x, int y, int radius,
+                           struct monst **list);
 extern void seemimic(struct monst *);
 extern void resistcham(void);
 extern void restartcham(void);
@@ -1106,9 +1125,14 @@ extern boolean ignores_scary(const struct permonst *);
 extern boolean is_unknown_dragon(const struct permonst *);
 extern int num_horns(const struct permonst *);
 extern boolean dmgtype(const struct permonst *,int);
+extern int check_attk_masks(void);
+#ifdef ATTK_STATS
+extern void list_attk_stats(struct menulist *);
+#endif
 extern int max_passive_dmg(struct monst *,struct monst *);
 extern int monsndx(const struct permonst *);
 extern int name_to_mon(const char *);
+extern int name_to_mon_linear(const char *);
 extern int gender(struct monst *);
 extern int pronoun_gender(const struct level *,struct monst *);
 extern boolean levl_follower(struct monst *);
@@ -1191,11 +1215,25 @@ extern boolean munstone(struct monst *,boolean);
 extern void awaken_soldiers(void);
 extern int do_play_instrument(struct obj *);
 
+/* ### nametrie.c ### */
+
+extern void trie_add(struct name_trie *t, const char *key, const char *ignore,
+		     int value);
+extern int trie_find(const struct name_trie *t, const char *key,
+		     const char *ignore);
+extern int trie_prefixes(const struct name_trie *t, const char *str, int *lens,
+			 int *vals, int max);
+extern void trie_free(struct name_trie *t);
+extern int check_name_tries(unsigned long seed, int count, char *badname);
+
 /* ### o_init.c ### */
 
 extern void init_objects(void);
 extern int find_skates(void);
 extern void oinit(const struct level *lev);
+extern void free_object_tables(void);
+extern int rnd_otyp(char oclass);
+extern int rnd_otyp_range(int first, int last);
 extern void freenames(void);
 extern void savenames(struct memfile *mf);
 extern void restnames(struct memfile *mf);
@@ -1241,6 +1279,7 @@ extern char *ysimple_name(const struct obj *);
 extern char *Ysimple_name2(const struct obj *);
 extern char *makeplural(const char *);
 extern char *makesingular(const char *);
+extern int wish_index_misses(const char *);
 extern struct obj *readobjnam(char *bp, struct obj *no_wish, boolean from_user);
 extern int rnd_class(int,int);
 extern const char *cloak_simple_name(const struct obj *cloak);
@@ -1825,6 +1864,8 @@ extern void store_version(struct memfile *mf);
 /* ### vision.c ### */
 
 extern void vision_init(void);
+extern void loc_sync(struct level *,int,int);
+extern void loc_sync_level(struct level *);
 extern boolean does_block(struct level *,int,int,const struct monst *);
 extern void vision_reset(void);
 extern void vision_recalc(int);
@@ -1947,6 +1988,8 @@ extern void setnotworn(struct obj *);
 extern void mon_set_minvis(struct monst *);
 extern void mon_adjust_speed(struct monst *,int,struct obj *);
 extern void update_mon_intrinsics(struct level *,struct monst *,struct obj *,boolean,boolean);
+extern unsigned int inv_props(struct monst *);
+extern void obj_inv_props_changed(struct obj *);
 extern int find_mac(const struct monst *);
 extern void m_dowear(struct level *,struct monst *,boolean);
 extern struct obj *which_armor(const struct monst *,long);
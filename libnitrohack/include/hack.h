@@ -110,6 +110,34 @@ extern coord bhitpos;	/* place where throw or zap hits or stops */
 #define FLASHED_LIGHT	3
 #define INVIS_BEAM	4
 
+/* precomputed weighted random selection, see alias.c and alias_select() */
+struct alias_table {
+	int n;		/* number of entries */
+	int total;	/* sum of all weights; 0 if the table is empty */
+	int *keep;	/* keep the drawn entry if the remainder is below this, */
+	int *alias;	/* otherwise select this one instead */
+};
+
+/* case-insensitive name lookup, see nametrie.c */
+struct trie_node {
+	char c;		/* last character of the key up to this node */
+	int child;	/* first node one character further, or -1 */
+	int sibling;	/* next node with the same parent, or -1 */
+	int vals;	/* first value for the key ending here, or -1 */
+};
+
+struct trie_val {
+	int value;
+	int next;	/* next value for the same key, or -1 */
+};
+
+struct name_trie {
+	struct trie_node *nodes;	/* nodes[0] is the root */
+	struct trie_val *vals;
+	int nnodes, maxnodes;
+	int nvals, maxvals;
+};
+
 #include "trap.h"
 #include "flag.h"
 #include "rm.h"
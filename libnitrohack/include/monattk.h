@@ -85,6 +85,17 @@
 #define AD_SAMU		252	/* hits, may steal Amulet (Wizard) */
 #define AD_CURS		253	/* random curse (ex. gremlin) */
 
+/*
+ *  Bits for the attack and damage types of each monster in mons[], which
+ *  makedefs collects into monattk_at[] and monattk_ad[] in monstr.c.
+ */
+#define AT_BIT(at)	(1U << ((at) >= AT_WEAP ? (at) - AT_WEAP + 30 : (at)))
+#define AD_BIT(ad)	(1ULL << ((ad) >= AD_SAMU ? (ad) - AD_SAMU + 54 : \
+				 (ad) >= AD_CLRC ? (ad) - AD_CLRC + 51 : (ad)))
+#define AT_HAS_BIT(at)	((at) < 30 || (at) >= AT_WEAP)
+#define AD_HAS_BIT(ad)	((ad) < 51 || ((ad) >= AD_CLRC && (ad) <= AD_RBRE) || \
+			 ((ad) >= AD_SAMU && (ad) <= AD_SAMU + 9))
+
 
 /*
  *  Monster to monster attacks.  When a monster attacks another (mattackm),
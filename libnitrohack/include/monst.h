@@ -78,6 +78,7 @@ struct monst {
 				   player (positive = good to kill) */
 	short movement;		/* movement points (derived from permonst definition and added effects */
 	unsigned short mintrinsics;	/* low 8 correspond to mresists */
+	uchar invprops;		/* INVP_* bits from inventory; see inv_props() */
 	schar mtame;		/* level of tameness, implies peaceful */
 	uchar m_ap_type;	/* what mappearance is describing: */
 #define M_AP_NOTHING	0	/* mappearance is unused -- monster appears as itself */
@@ -166,7 +167,16 @@ struct monst {
 #define NAME(mtmp)	(((char *)(mtmp)->mextra) + (mtmp)->mxlth)
 
 #define MON_WEP(mon)	((mon)->mw)
-#define MON_NOWEP(mon)	((mon)->mw = NULL)
+#define MON_NOWEP(mon)	((mon)->mw = NULL, reset_inv_props(mon))
+
+/* these are in invprops; not saved, but found again when needed */
+#define INVP_KNOWN	0x01	/* the other bits are up to date */
+#define INVP_ANTIMAGIC	0x02	/* worn or carried item grants magic resistance */
+#define INVP_BLND_RES	0x04	/* wielded or carried artifact prevents blinding */
+#define INVP_VISOR	0x08	/* wearing a visored helmet */
+#define INVP_REFLECT	0x10	/* something worn or wielded might reflect */
+
+#define reset_inv_props(mon)	((mon)->invprops = 0)
 
 #define DEADMONSTER(mon)	((mon)->mhp < 1)
 
@@ -7,6 +7,22 @@
  */
 #define EDITLEVEL	0
 
+/*
+ * Incremented whenever the game starts to use random numbers differently for
+ * the same actions, or otherwise plays out the same commands differently.
+ * New game logs record it after the version number, and replays of games
+ * started by older versions run the old code in the places listed here, so
+ * that they stay in sync with their logs.
+ * (See iflags.rng_revision.)
+ */
+#define RNGREV_ALIAS_MONS	1	/* rndmonst() and mkclass() use alias tables */
+#define RNGREV_ALIAS_OBJS	2	/* so do mkobj(), rnd_class() and mkbox_cnts() */
+#define RNGREV_MONS_IN_RANGE	3	/* area effects visit monsters by position */
+#define RNGREV_TRAVEL_CACHE	4	/* travel follows a cached distance map */
+#define RNGREV_SENSE_RANGE	5	/* per-turn redraws skip distant monsters
+					   and unseen objects and traps */
+#define RNG_REVISION		RNGREV_SENSE_RANGE
+
 #define COPYRIGHT_BANNER_A \
 "DynaHack Copyright 2012-2013 Tung Nguyen"
 
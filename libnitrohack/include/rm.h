@@ -524,9 +524,44 @@ struct wseg {
 
 
 struct ls_t;
+/*
+ * Memo of the background symbol of a wall, as worked out by wall_angle().
+ * An entry is only used while typ, seenv and wall info still match the
+ * location, so changes to the terrain invalidate it without further effort.
+ * Not saved; rebuilt by set_wall_state() and on demand.
+ */
+struct bg_memo {
+	schar typ;
+	uchar seenv;
+	uchar info;	/* wall_info | horizontal << 5 */
+	uchar cmap;
+};
+
+/*
+ * Row-major copies of the struct rm fields that vision reads, so that a row
+ * of the map can be scanned without striding over whole columns of
+ * locations. This is a view, not the real terrain: loc_sync() copies one
+ * location into it and loc_sync_level() the whole level. Vision does that
+ * in vision_reset(), does_block(), block_point() and unblock_point(), which
+ * is where code that changes the terrain already has to report it.
+ * Not saved; rebuilt by vision_reset().
+ */
+struct loc_planes {
+	schar typ[ROWNO][COLNO];
+	uchar lit[ROWNO][COLNO];
+	uchar flags[ROWNO][COLNO];
+};
+
+#define plane_typ(lev, x, y)	((lev)->planes.typ[y][x])
+#define plane_lit(lev, x, y)	((lev)->planes.lit[y][x])
+#define plane_flags(lev, x, y)	((lev)->planes.flags[y][x])
+#define plane_doormask(lev, x, y) plane_flags(lev, x, y)
+
 struct level {
     char		levname[64]; /* as given by the player via donamelevel */
     struct rm		locations[COLNO][ROWNO];
+    struct loc_planes	planes;
+    struct bg_memo	bgmemo[COLNO][ROWNO];
     struct obj		*objects[COLNO][ROWNO];
     struct monst	*monsters[COLNO][ROWNO];
     struct obj		*objlist;
@@ -538,7 +573,7 @@ struct level {
     struct mon_gen_override *mon_gen;
     struct lvl_sounds	*sounds;
 
-    timer_element	*lev_timers;
+    struct timer_queue	lev_timers;
     struct ls_t		*lev_lights;
     struct trap 	*lev_traps;
     struct engr		*lev_engr;
@@ -586,4 +621,8 @@ extern struct level *level;		/* pointer to an entry in levels */
 #define m_buried_at(x,y)	(MON_BURIED_AT(x,y) ? level->monsters[x][y] : \
 						       NULL)
 
+/* room needed for the list filled by monsters_within() and monsters_around():
+ * every location plus the steed */
+#define MONS_IN_RANGE_MAX	(COLNO * ROWNO + 1)
+
 #endif /* RM_H */
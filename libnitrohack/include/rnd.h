@@ -76,6 +76,19 @@ static inline int rnz(int i)
 	return (int)x;
 }
 
+/* weighted random entry of an alias table, or -1 if it is empty;
+ * see alias.c for how it uses the RNG */
+static inline int alias_select(const struct alias_table *at)
+{
+	int r, i;
+
+	if (at->total <= 0)
+	    return -1;
+	r = RND(at->n * at->total);
+	i = r / at->total;
+	return (r % at->total < at->keep[i]) ? i : at->alias[i];
+}
+
 #undef RND
 
 #endif
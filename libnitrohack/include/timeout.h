@@ -30,13 +30,27 @@ typedef void (*timeout_proc)(void *, long);
 
 /* used in timeout.c */
 typedef struct timer_element {
-    struct timer_element *next;	/* next item in chain */
+    struct timer_element *hnext;	/* next item in the same hash bucket */
     void *arg;			/* pointer to timeout argument */
     unsigned int timeout;	/* when we time out */
     unsigned int tid;		/* timer ID */
+    unsigned long seq;		/* insertion order; not saved */
+    int heappos;		/* index in timer_queue.heap */
     short kind;			/* kind of use */
     uchar func_index;		/* what to call when we time out */
     unsigned needs_fixup:1;	/* does arg need to be patched? */
 } timer_element;
 
+/*
+ * The timers of a level: a binary heap ordered by timeout, with ties going
+ * to the timer inserted last, and a hash table on arg for finding the timers
+ * of an object.  An all-zero timer_queue is empty.
+ */
+struct timer_queue {
+    timer_element **heap;
+    int count, heapsize;
+    timer_element **hash;
+    int hashsize;		/* a power of 2, or 0 before the first timer */
+};
+
 #endif /* TIMEOUT_H */
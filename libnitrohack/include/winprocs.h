@@ -6,7 +6,7 @@
 
 extern struct nh_window_procs windowprocs;
 
-#define win_pause_output (*windowprocs.win_pause)
+#define win_pause_output(r) (anim_flush(), (*windowprocs.win_pause)(r))
 #define display_buffer (*windowprocs.win_display_buffer)
 #define update_status (*windowprocs.win_update_status)
 #define print_message (*windowprocs.win_print_message)
@@ -14,6 +14,6 @@ extern struct nh_window_procs windowprocs;
 #define raw_print (*windowprocs.win_raw_print)
 #define outrip (*windowprocs.win_outrip)
 #define level_changed (*windowprocs.win_level_changed)
-#define win_delay_output (*windowprocs.win_delay)
+#define win_delay_output anim_delay_output
 
 #endif /* WINPROCS_H */
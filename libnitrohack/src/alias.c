@@ -0,0 +1,95 @@
+/* DynaHack may be freely redistributed.  See license for details. */
+
+/*
+ * Walker alias tables for weighted random selection.
+ *
+ * A table over n entries with integer weights is split into n buckets of
+ * equal size (the sum of all weights).  Each bucket holds part of the weight
+ * of its own entry and fills the rest with the weight of exactly one other
+ * entry, its alias.  Selecting an entry then takes constant time no matter
+ * how many entries there are, instead of walking a cumulative sum.
+ *
+ * The table is built from the weights with integer arithmetic only, so the
+ * resulting probabilities are exactly weight / total and the table is the
+ * same on every platform, which keeps game logs replayable.
+ *
+ * RNG use: alias_select() makes exactly one call, rn2(n * total); the
+ * quotient picks the bucket and the remainder decides between the bucket's
+ * own entry and its alias.  Nothing is drawn if total is 0.
+ */
+
+#include "hack.h"
+#include <limits.h>
+
+
+void alias_build(struct alias_table *at, const int *weights, int n)
+{
+    int *small, *large;
+    long *scaled;
+    int i, s, l, nsmall = 0, nlarge = 0;
+    long total = 0;
+
+    alias_free(at);
+    for (i = 0; i < n; i++)
+        total += weights[i];
+    if (n <= 0 || total <= 0)
+        return;
+    if (total > INT_MAX / n)
+        panic("alias_build: total weight %ld of %d entries is too large",
+              total, n);
+
+    at->n = n;
+    at->total = total;
+    at->keep = malloc(n * sizeof(int));
+    at->alias = malloc(n * sizeof(int));
+
+    /* every bucket has room for total; an entry's own share is weight * n */
+    scaled = malloc(n * sizeof(long));
+    small = malloc(n * sizeof(int));
+    large = malloc(n * sizeof(int));
+    for (i = 0; i < n; i++) {
+        scaled[i] = (long)weights[i] * n;
+        if (scaled[i] < total)
+            small[nsmall++] = i;
+        else
+            large[nlarge++] = i;
+    }
+
+    /* top up each underfull bucket from an overfull entry */
+    while (nsmall && nlarge) {
+        s = small[--nsmall];
+        l = large[nlarge - 1];
+        at->keep[s] = scaled[s];
+        at->alias[s] = l;
+        scaled[l] -= total - scaled[s];
+        if (scaled[l] < total) {
+            nlarge--;
+            small[nsmall++] = l;
+        }
+    }
+    /* whatever is left is exactly full */
+    while (nlarge) {
+        l = large[--nlarge];
+        at->keep[l] = total;
+        at->alias[l] = l;
+    }
+    while (nsmall) {
+        s = small[--nsmall];
+        at->keep[s] = total;
+        at->alias[s] = s;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+}
+
+
+void alias_free(struct alias_table *at)
+{
+    free(at->keep);
+    free(at->alias);
+    memset(at, 0, sizeof(struct alias_table));
+}
+
+/*alias.c*/
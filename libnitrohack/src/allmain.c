@@ -325,10 +325,32 @@ static void realtime_tasks(void)
 }
 
 
+/*
+ * The timer and light source chains of all levels are kept consistent where
+ * timers and lights change hands (obj_move_timers, set_obj_level, goto_level
+ * and friends).  Scanning every level for errors is therefore only done once
+ * per game load and after level changes; debug builds and wizard mode also
+ * do it before every move to catch violations close to where they happen.
+ */
+static void check_timers_and_lights(void)
+{
+#if !defined(DEBUG)
+    if (!wizard)
+        return;
+#endif
+    validate_timers();
+    validate_light_sources();
+}
+
+
 static void post_init_tasks(void)
 {
     encumber_msg(); /* in case they auto-picked up something */
 
+    /* the saved state might not be consistent */
+    validate_timers();
+    validate_light_sources();
+
     u.uz0.dlevel = u.uz.dlevel;
 
     prev_hp_notify = uhp();
@@ -354,7 +376,8 @@ boolean nh_start_game(int fd, const char *name, int irole, int irace, int igend,
         seed = turntime ^ get_seedval();
         /* initialize the random number generator */
         mt_srand(seed);
-    } /* else: turntime and rng seeding are done in logreplay.c */
+        iflags.rng_revision = RNG_REVISION;
+    } /* else: turntime, rng seeding and rng_revision are done in logreplay.c */
 
     startup_common(name, playmode);
 
@@ -511,8 +534,7 @@ static void you_moved(void)
     do { /* hero can't move this turn loop */
         wtcap = encumber_msg();
         calc_attr_bonus();
-        validate_timers();
-        validate_light_sources();
+        check_timers_and_lights();
 
         flags.mon_moving = TRUE;
         do {
@@ -784,10 +806,9 @@ static void special_vision_handling(void)
         see_objects();
         see_traps();
         if (u.uswallow) swallowed(0);
-    } else if (Unblind_telepat) {
-        see_monsters();
-    } else if (Warning || Warn_of_mon)
-        see_monsters();
+    } else if (Unblind_telepat || Warning || Warn_of_mon) {
+        see_nearby_monsters();
+    }
 
     if (vision_full_recalc)
         vision_recalc(0);   /* vision! */
@@ -803,8 +824,7 @@ static void pre_move_tasks(boolean didmove)
     find_ac();
 
     /* ensure timer and light source integrity */
-    validate_timers();
-    validate_light_sources();
+    check_timers_and_lights();
 
     if (!flags.mv || Blind)
         special_vision_handling();
@@ -602,6 +602,7 @@ void artifact_exists(struct obj *otmp, const char *name, boolean mod)
                 if (mod) /* artifacts can't have properties */
                     strip_oprops(otmp);
                 otmp->oartifact = (char)(mod ? m : 0);
+                obj_inv_props_changed(otmp);
                 otmp->age = 0;
                 if (otmp->otyp == RIN_INCREASE_DAMAGE)
                     otmp->spe = 0;
@@ -82,6 +82,47 @@ static const char *rank(void)
 }
 
 int title_to_mon(const char *str, int *rank_indx, int *title_length)
+{
+    /* every title is stored as ((role * 9) + rank) * 2 + female */
+    static struct name_trie titles;
+    int lens[BUFSZ], vals[BUFSZ];
+    int i, j, n, v, best = -1, bestlen = 0;
+
+    if (!titles.nnodes) {
+        for (i = 0; roles[i].name.m; i++)
+            for (j = 0; j < 9; j++) {
+                if (roles[i].rank[j].m)
+                    trie_add(&titles, roles[i].rank[j].m, NULL, (i * 9 + j) * 2);
+                if (roles[i].rank[j].f)
+                    trie_add(&titles, roles[i].rank[j].f, NULL,
+                             (i * 9 + j) * 2 + 1);
+            }
+    }
+
+    /* Of all the titles str starts with, use the one that comes first in
+     * roles[], checking male before female titles. */
+    n = trie_prefixes(&titles, str, lens, vals, BUFSZ);
+    for (i = 0; i < n; i++) {
+        v = titles.vals[vals[i]].value;     /* values are in ascending order */
+        if (best < 0 || v < best) {
+            best = v;
+            bestlen = lens[i];
+        }
+    }
+    if (best < 0)
+        return NON_PM;
+
+    i = best / 2 / 9;
+    if (rank_indx) *rank_indx = best / 2 % 9;
+    if (title_length) *title_length = bestlen;
+    if (best % 2 && roles[i].femalenum != NON_PM)
+        return roles[i].femalenum;
+    return roles[i].malenum;
+}
+
+
+/* title_to_mon() comparing str against every title in turn */
+int title_to_mon_linear(const char *str, int *rank_indx, int *title_length)
 {
     int i, j;
 
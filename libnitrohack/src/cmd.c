@@ -34,6 +34,8 @@ static int wiz_mon_polycontrol(void);
 static int wiz_show_wmodes(void);
 static int wiz_mazewalkmap(void);
 static int wiz_show_rooms(void);
+static int wiz_check_names(void);
+static int wiz_show_attacks(void);
 extern char SpLev_Map[COLNO][ROWNO];
 static void count_obj(struct obj *, long *, long *, boolean, boolean);
 static void obj_chain(struct menulist *, const char *, struct obj *, long *, long *);
@@ -148,6 +150,7 @@ const struct cmd_desc cmdlist[] = {
                                    {"go", "move, stopping for anything interesting", 'g', 0, FALSE, dogo, CMD_ARG_DIR | CMD_MOVE},
                                    {"go2", "like go, but branching corridors are boring", 'G', 0, FALSE, dogo2, CMD_ARG_DIR | CMD_MOVE},
 
+                                   {"attacks", "(DEBUG) check attack masks and show attack lookup counts", 0, 0, TRUE, wiz_show_attacks, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT | CMD_NOTIME},
                                    {"create monster", "(DEBUG) create a monster", C('g'), 0, TRUE, wiz_genesis, CMD_ARG_NONE | CMD_DEBUG},
                                    {"detect", "(DEBUG) detect monsters", 0, 0, TRUE, wiz_detect, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT},
                                    {"identify", "(DEBUG) identify all items in the inventory", C('i'), 0, TRUE, wiz_identify, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT},
@@ -156,6 +159,7 @@ const struct cmd_desc cmdlist[] = {
                                    {"lightsources", "(DEBUG) show mobile light sources", 0, 0, TRUE, wiz_light_sources, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT | CMD_NOTIME},
                                    {"mazewalkmap", "(DEBUG) show MAZEWALK paths", 0, 0, TRUE, wiz_mazewalkmap, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT | CMD_NOTIME},
                                    {"monpolycontrol", "(DEBUG) control monster polymorphs", 0, 0, TRUE, wiz_mon_polycontrol, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT},
+                                   {"nametries", "(DEBUG) check name lookups against linear scans", 0, 0, TRUE, wiz_check_names, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT | CMD_NOTIME},
                                    {"panic", "(DEBUG) test panic routine (fatal to game)", 0, 0, TRUE, wiz_panic, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT},
                                    {"polyself", "(DEBUG) polymorph self", 0, 0, TRUE, wiz_polyself, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT},
                                    {"printdungeon", "(DEBUG) print dungeon structure", 0, 0, TRUE, wiz_where, CMD_ARG_NONE | CMD_DEBUG | CMD_EXT | CMD_NOTIME},
@@ -398,6 +402,41 @@ static int wiz_panic(void)
     return 0;
 }
 
+/* #nametries command - compare the name tries with the scans they replaced */
+static int wiz_check_names(void)
+{
+    char buf[BUFSZ];
+    int bad;
+
+    bad = check_name_tries((unsigned long)moves, 5000, buf);
+    if (bad)
+        pline("%d of 5000 names were looked up differently, e.g. \"%s\".",
+              bad, buf);
+    else
+        pline("All 5000 names were looked up the same way.");
+    return 0;
+}
+
+/* #attacks command - check the attack masks from makedefs against mons[] */
+static int wiz_show_attacks(void)
+{
+    char buf[BUFSZ];
+    struct menulist menu;
+
+    init_menulist(&menu);
+    sprintf(buf, "Attack and damage type masks: %d disagreements with mons[].",
+            check_attk_masks());
+    add_menutext(&menu, buf);
+#ifdef ATTK_STATS
+    add_menutext(&menu, "");
+    list_attk_stats(&menu);
+#endif
+
+    display_menu(menu.items, menu.icount, NULL, PICK_NONE, NULL);
+    free(menu.items);
+    return 0;
+}
+
 /* #polyself command - change hero's form */
 static int wiz_polyself(void)
 {
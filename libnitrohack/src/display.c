@@ -104,6 +104,8 @@
  */
 #include "hack.h"
 #include "region.h"
+#include "artifact.h"
+#include "patchlevel.h"
 
 static void display_monster(xchar,xchar,struct monst *,int,xchar);
 static int swallow_to_effect(int, int);
@@ -117,11 +119,22 @@ static int set_crosswall(struct level *lev, int, int);
 static void set_seenv(struct rm *, int, int, int, int);
 static void t_warn(struct rm *);
 static int wall_angle(struct rm *);
+static int memo_wall_angle(struct level *lev, int x, int y);
 static void dbuf_set_object(int x, int y, int oid);
 static void dbuf_set_loc(int x, int y);
 
 static boolean delay_flushing;
 
+static unsigned long sense_props(void);
+
+/* the hero's senses as of the last see_monsters(); see see_nearby_monsters() */
+static struct sense_state {
+    struct level *lev;
+    xchar ux, uy;
+    unsigned long props;
+    struct obj *uwep;   /* may be an artifact that warns of monsters */
+} senses;
+
 #ifdef INVISIBLE_OBJECTS
 /*
  * vobj_at()
@@ -883,6 +896,7 @@ void shieldeff(xchar x, xchar y)
         return;
 
     if (cansee(x,y)) {  /* Don't see anything if can't see the location */
+        anim_begin();
         for (i = 0; i < SHIELD_COUNT; i += flags.sparkle) {
             dbuf_set_effect(x, y, dbuf_effect(E_MISC, shield_static[i]));
             flush_screen(); /* make sure the effect shows up */
@@ -890,6 +904,7 @@ void shieldeff(xchar x, xchar y)
         }
 
         dbuf_set_effect(x, y, 0);
+        anim_end();
     }
 }
 
@@ -950,6 +965,7 @@ void tmp_at(int x, int y)
         tsym->style = x;
         tsym->sym = y;
         flush_screen(); /* flush buffered glyphs */
+        anim_begin();
         return;
 
     case DISP_FREEMEM:  /* in case game ends with tmp_at() in progress */
@@ -959,6 +975,7 @@ void tmp_at(int x, int y)
                 free(tsym);
             tsym = tmp;
         }
+        anim_free();
         return;
 
     default:
@@ -988,6 +1005,7 @@ void tmp_at(int x, int y)
         if (tsym != &tsfirst)
             free(tsym);
         tsym = tmp;
+        anim_end();
         break;
 
     default:    /* do it */
@@ -1183,6 +1201,68 @@ void see_monsters(void)
     /* when mounted, hero's location gets caught by monster loop */
     if (!u.usteed)
         newsym(u.ux, u.uy);
+
+    senses.lev = level;
+    senses.ux = u.ux;
+    senses.uy = u.uy;
+    senses.props = sense_props();
+    senses.uwep = uwep;
+}
+
+
+/*
+ * Bitmask of the hero's abilities that decide how monsters out of sight are
+ * displayed.
+ */
+static unsigned long sense_props(void)
+{
+    return (!!Blind << 0) | (!!Blind_telepat << 1) | (!!Unblind_telepat << 2) |
+           (!!Warning << 3) | (!!Warn_of_mon << 4) | (!!See_invisible << 5) |
+           (!!Infravision << 6) | (!!Detect_monsters << 7) |
+           (!!Hallucination << 8) | (!!u.usteed << 9) | (!!u.uswallow << 10) |
+           (!!Underwater << 11) | ((unsigned long)flags.warntype << 12);
+}
+
+
+/*
+ * Per-turn update for range-limited senses (extrinsic telepathy and warning).
+ *
+ * Only monsters within sensing range of the hero's current or previous
+ * position can be displayed through these senses, so those are the only
+ * ones that need to be redrawn, unless the hero's senses themselves changed
+ * or the hero also has a sense without a range limit.
+ * They are redrawn every turn, since their attitude and level (which decide
+ * tame and peaceful markers and warning levels) may change at any time.
+ */
+void see_nearby_monsters(void)
+{
+    struct monst *mon;
+    int oldx = senses.ux, oldy = senses.uy;
+
+    /* blind telepathy and warning of a monster class reach any distance */
+    if (iflags.rng_revision < RNGREV_SENSE_RANGE || Detect_monsters ||
+        (Blind && Blind_telepat) || Warn_of_mon ||
+        (uwep && uwep->oartifact && spec_ability(uwep, SPFX_WARN_S)) ||
+        senses.lev != level || senses.props != sense_props() ||
+        senses.uwep != uwep) {
+        see_monsters();
+        return;
+    }
+
+    for (mon = level->monlist; mon; mon = mon->nmon) {
+        if (DEADMONSTER(mon)) continue;
+        /* 100 covers both warning range and BOLT_LIM telepathy */
+        if (dist2(mon->mx, mon->my, oldx, oldy) >= 100 &&
+            distu(mon->mx, mon->my) >= 100)
+            continue;
+        newsym(mon->mx, mon->my);
+        if (mon->wormno) see_wsegs(mon);
+    }
+    if (!u.usteed)
+        newsym(u.ux, u.uy);
+
+    senses.ux = u.ux;
+    senses.uy = u.uy;
 }
 
 /*
@@ -1211,12 +1291,20 @@ void set_mimic_blocking(void)
 /*
  * Loop through all of the object *locations* and update them.  Called when
  *  + hallucinating.
+ * Locations out of sight only show what the hero remembers, which newsym()
+ * would leave unchanged, so only the visible ones and the hero's own square
+ * (which may be felt) need an update.  Games from before RNGREV_SENSE_RANGE
+ * update all of them, since newsym() uses random numbers while hallucinating.
  */
+#define see_or_feel(x, y) (iflags.rng_revision < RNGREV_SENSE_RANGE || \
+                           cansee(x, y) || ((x) == u.ux && (y) == u.uy))
+
 void see_objects(void)
 {
     struct obj *obj;
     for (obj = level->objlist; obj; obj = obj->nobj)
-        if (vobj_at(obj->ox,obj->oy) == obj) newsym(obj->ox, obj->oy);
+        if (see_or_feel(obj->ox, obj->oy) && vobj_at(obj->ox,obj->oy) == obj)
+            newsym(obj->ox, obj->oy);
 }
 
 /*
@@ -1227,10 +1315,13 @@ void see_traps(void)
     struct trap *trap;
 
     for (trap = level->lev_traps; trap; trap = trap->ntrap)
-        if (level->locations[trap->tx][trap->ty].mem_trap)
+        if (level->locations[trap->tx][trap->ty].mem_trap &&
+            see_or_feel(trap->tx, trap->ty))
             newsym(trap->tx, trap->ty);
 }
 
+#undef see_or_feel
+
 /*
  * display_self()
  *
@@ -1533,6 +1624,151 @@ void cls(void)
 }
 
 
+/*
+ * Beams, explosions, thrown objects and shield effects are drawn as a sequence
+ * of flush_screen() and win_delay_output() calls.  If the window port supports
+ * it, these are collected between anim_begin() and anim_end() and sent as a
+ * single batch of frames.  Each frame only holds the cells that changed since
+ * the previous one.  The port plays the frames over its current map and then
+ * restores it; the final state is sent with a normal update_screen afterwards.
+ *
+ * Anything that must appear in order with the animation (messages, prompts,
+ * --More--) calls anim_flush() first.
+ */
+#define ANIM_MAX_CELLS (ROWNO * COLNO)
+
+static struct anim_batch {
+    int depth;              /* nesting level of anim_begin() calls */
+    struct nh_dbuf_entry shown[ROWNO][COLNO]; /* state after the last frame */
+    struct nh_anim_frame *frames;
+    int nframes, maxframes;
+    struct nh_anim_cell *cells;
+    int ncells, maxcells;
+} anim;
+
+
+static struct nh_anim_frame *anim_new_frame(void)
+{
+    struct nh_anim_frame *frame;
+
+    if (anim.nframes == anim.maxframes) {
+        anim.maxframes = anim.maxframes ? anim.maxframes * 2 : 32;
+        anim.frames = realloc(anim.frames,
+                              anim.maxframes * sizeof(struct nh_anim_frame));
+    }
+
+    frame = &anim.frames[anim.nframes++];
+    frame->first_cell = anim.ncells;
+    frame->cell_count = 0;
+    frame->delay = 0;
+    return frame;
+}
+
+
+/* record the difference between dbuf and the previous frame as a new frame */
+static void anim_add_frame(void)
+{
+    struct nh_anim_frame *frame = NULL;
+    struct nh_anim_cell *cell;
+    int x, y;
+
+    for (y = 0; y < ROWNO; y++) {
+        for (x = 1; x < COLNO; x++) {
+            if (!memcmp(&dbuf[y][x], &anim.shown[y][x], sizeof(struct nh_dbuf_entry)))
+                continue;
+
+            if (!frame)
+                frame = anim_new_frame();
+            if (anim.ncells == anim.maxcells) {
+                anim.maxcells = anim.maxcells ? anim.maxcells * 2 : 256;
+                anim.cells = realloc(anim.cells,
+                                     anim.maxcells * sizeof(struct nh_anim_cell));
+            }
+            cell = &anim.cells[anim.ncells++];
+            cell->x = x;
+            cell->y = y;
+            cell->dbe = dbuf[y][x];
+            anim.shown[y][x] = dbuf[y][x];
+            frame->cell_count++;
+        }
+    }
+
+    /* don't let a runaway effect grow the batch without bounds */
+    if (anim.ncells >= ANIM_MAX_CELLS)
+        anim_flush();
+}
+
+
+/* send all collected frames to the window port */
+void anim_flush(void)
+{
+    if (!anim.nframes)
+        return;
+
+    if (windowprocs.win_play_animation) {
+        (*windowprocs.win_play_animation)(anim.frames, anim.nframes,
+                                          anim.cells, u.ux, u.uy);
+        /* the port restores its map after playback; bring it up to date */
+        update_screen(dbuf, u.ux, u.uy);
+    }
+    anim.nframes = anim.ncells = 0;
+}
+
+
+void anim_begin(void)
+{
+    if (!windowprocs.win_play_animation)
+        return;
+
+    if (anim.depth == 0) {
+        /* show the map as it is before the animation starts; the port
+         * plays the frames on top of that */
+        flush_screen();
+        memcpy(anim.shown, dbuf, sizeof(dbuf));
+    }
+    anim.depth++;
+}
+
+
+void anim_end(void)
+{
+    if (!anim.depth)
+        return;
+
+    if (--anim.depth == 0) {
+        anim_flush();
+        if (iflags.botl)
+            bot();
+    }
+}
+
+
+/* throw away an unfinished animation, e.g. when the game ends during one */
+void anim_free(void)
+{
+    free(anim.frames);
+    free(anim.cells);
+    memset(&anim, 0, sizeof(anim));
+}
+
+
+/*
+ * Pause the display briefly.  During an animation the pause becomes part of
+ * the current frame instead of a separate call to the window port.
+ */
+void anim_delay_output(void)
+{
+    if (anim.depth && windowprocs.win_play_animation) {
+        if (!anim.nframes)
+            anim_new_frame();
+        anim.frames[anim.nframes - 1].delay++;
+        return;
+    }
+
+    (*windowprocs.win_delay)();
+}
+
+
 void flush_screen_disable(void)
 {
     delay_flushing = TRUE;
@@ -1552,6 +1788,12 @@ void flush_screen(void)
 {
     if (delay_flushing) return;
 
+    if (anim.depth) {
+        /* the status line is brought up to date when the animation ends */
+        anim_add_frame();
+        return;
+    }
+
     update_screen(dbuf, u.ux, u.uy);
 
     if (iflags.botl)
@@ -1567,6 +1809,7 @@ void flush_screen_nopos(void)
     update_screen(dbuf, -1, -1);
 }
 
+
 /* ========================================================================= */
 
 /*
@@ -1612,7 +1855,7 @@ int back_to_cmap(struct level *lev, xchar x, xchar y)
     case TLWALL:
     case TRWALL:
     case SDOOR:
-        idx = ptr->seenv ? wall_angle(ptr) : S_stone;
+        idx = ptr->seenv ? memo_wall_angle(lev, x, y) : S_stone;
         break;
     case DOOR:
         if (ptr->doormask) {
@@ -1924,11 +2167,52 @@ void set_wall_state(struct level *lev)
                 break;
             }
 
-            if (wmode >= 0)
+            if (wmode >= 0) {
                 loc->wall_info = (loc->wall_info & ~WM_MASK) | wmode;
+                if (loc->seenv)
+                    memo_wall_angle(lev, x, y);
+            }
         }
 }
 
+
+/*
+ * Fill the background memo for all walls of a level whose seen vector is
+ * already set, e.g. after the level was restored.
+ */
+void prime_bg_memo(struct level *lev)
+{
+    int x, y;
+    struct rm *loc;
+
+    for (x = 0; x < COLNO; x++)
+        for (loc = &lev->locations[x][0], y = 0; y < ROWNO; y++, loc++)
+            if (loc->seenv && ((IS_WALL(loc->typ) && loc->typ != DBWALL) ||
+                               loc->typ == SDOOR))
+                memo_wall_angle(lev, x, y);
+}
+
+/*
+ * Look up the wall angle of a location in the level's memo; recalculate it
+ * only if the location's type, seen vector or wall mode changed since.
+ */
+static int memo_wall_angle(struct level *lev, int x, int y)
+{
+    struct rm *loc = &lev->locations[x][y];
+    struct bg_memo *memo = &lev->bgmemo[x][y];
+    uchar info = loc->wall_info | (loc->horizontal << 5);
+
+    if (memo->typ != loc->typ || memo->seenv != loc->seenv ||
+        memo->info != info) {
+        memo->typ = loc->typ;
+        memo->seenv = loc->seenv;
+        memo->info = info;
+        memo->cmap = wall_angle(loc);
+    }
+
+    return memo->cmap;
+}
+
 /* ------------------------------------------------------------------------- */
 /* This matrix is used here and in vision.c. */
 unsigned const char seenv_matrix[3][3] = { {SV2,   SV1, SV0},
@@ -5,6 +5,11 @@
 #include "config.h"
 #include "dlb.h"
 
+#if defined(UNIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* without extern.h via hack.h, these haven't been declared for us */
 extern FILE *fopen_datafile(const char *,const char *,int);
 
@@ -41,6 +46,12 @@ typedef struct dlb_procs {
  * only in the Amiga port (the second library holds the sound files).
  * For Unix, the idea would be to split the library
  * into text and binary parts, where the text version could be shared.
+ *
+ * On Unix the whole library is mapped read-only after the directory has
+ * been read.  Rumors, oracles, quest text and data.base are then served
+ * straight from the page cache, so all game processes share one copy of
+ * them instead of each filling its own stdio buffers.  If the mapping
+ * fails we quietly fall back to reading through fdata.
  */
 
 #define MAX_LIBS 4
@@ -178,6 +189,28 @@ static boolean find_file(const char *name, library **lib, long *startp, long *si
     return FALSE;
 }
 
+/*
+ * Map the library file so that reads don't need to go through stdio.
+ * Failure is not an error; lp->map simply stays NULL.
+ */
+static void map_library(library *lp)
+{
+#if defined(UNIX)
+    struct stat st;
+    void *map;
+
+    if (fstat(fileno(lp->fdata), &st) == -1 || st.st_size <= 0)
+        return;
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(lp->fdata), 0);
+    if (map == MAP_FAILED)
+        return;
+
+    lp->map = map;
+    lp->mapsize = st.st_size;
+#endif
+}
+
 /*
  * Open the library of the given name and fill in the given library
  * structure.  Return TRUE if successful, FALSE otherwise.
@@ -189,6 +222,7 @@ boolean open_library(const char *lib_name, library *lp)
     lp->fdata = fopen_datafile(lib_name, RDBMODE, DATAPREFIX);
     if (lp->fdata) {
         if (readlibdir(lp)) {
+            map_library(lp);
             status = TRUE;
         } else {
             fclose(lp->fdata);
@@ -200,6 +234,10 @@ boolean open_library(const char *lib_name, library *lp)
 
 void close_library(library * lp)
 {
+#if defined(UNIX)
+    if (lp->map)
+        munmap((void *)lp->map, lp->mapsize);
+#endif
     fclose(lp->fdata);
     free(lp->dir);
     free(lp->sspace);
@@ -269,6 +307,12 @@ static int lib_dlb_fread(char *buf, int size, int quan, dlb *dp)
     if (quan == 0) return 0;
 
     pos = dp->start + dp->mark;
+    if (dp->lib->map && pos + size * quan <= dp->lib->mapsize) {
+        memcpy(buf, dp->lib->map + pos, size * quan);
+        dp->mark += size * quan;
+        return quan;
+    }
+
     if (dp->lib->fmark != pos) {
         fseek(dp->lib->fdata, pos, SEEK_SET);   /* check for error??? */
         dp->lib->fmark = pos;
@@ -309,12 +353,28 @@ static char *lib_dlb_fgets(char *buf, int len, dlb *dp)
     if (dp->mark >= dp->size) return NULL;
 
     len--;  /* save room for null */
-    for (i = 0, bp = buf;
-         i < len && dp->mark < dp->size && c != '\n'; i++, bp++) {
-        if (dlb_fread(bp, 1, 1, dp) <= 0) break;    /* EOF or error */
-        c = *bp;
+
+    /* scan for the end of the line directly in the mapped data */
+    if (dp->lib->map && dp->start + dp->size <= dp->lib->mapsize) {
+        const char *src = dp->lib->map + dp->start + dp->mark;
+        const char *nl;
+        long n = dp->size - dp->mark;
+
+        if (n > len) n = len;
+        nl = memchr(src, '\n', n);
+        if (nl) n = nl - src + 1;
+        memcpy(buf, src, n);
+        buf[n] = '\0';
+        dp->mark += n;
+        bp = buf + n;
+    } else {
+        for (i = 0, bp = buf;
+             i < len && dp->mark < dp->size && c != '\n'; i++, bp++) {
+            if (dlb_fread(bp, 1, 1, dp) <= 0) break;    /* EOF or error */
+            c = *bp;
+        }
+        *bp = '\0';
     }
-    *bp = '\0';
 
 #if defined(WIN32)
     if ((bp = strchr(buf, '\r')) != 0) {
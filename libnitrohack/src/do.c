@@ -1103,6 +1103,10 @@ void goto_level(d_level *newlevel, boolean at_stairs, boolean falling, boolean p
      * if they are attached to objects the hero is carrying */
     transfer_timers(origlev, level, 0);
     transfer_lights(origlev, level, 0);
+    /* this is where timers and lights move between levels, so make sure
+     * they all ended up in the right place */
+    validate_timers();
+    validate_light_sources();
 
     /* do this prior to level-change pline messages */
     vision_reset();     /* clear old level's line-of-sight */
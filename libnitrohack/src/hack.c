@@ -4,6 +4,7 @@
 #include <limits.h>
 
 #include "hack.h"
+#include "patchlevel.h"
 
 static void maybe_wail(void);
 static int moverock(schar dx, schar dy);
@@ -1101,6 +1102,243 @@ static int autotravel_weighting(int x, int y, unsigned distance)
     return distance * 10;
 }
 
+/* Walk around monsters that just get in the way. */
+static boolean divert_mon(int x, int y)
+{
+    const struct monst *mtmp = m_at(level, x, y);
+
+    return mtmp &&
+           /* can be seen or spotted */
+           canspotmon(level, mtmp) &&
+           mtmp->m_ap_type != M_AP_FURNITURE &&
+           mtmp->m_ap_type != M_AP_OBJECT &&
+           !(is_hider(mtmp->data) || mtmp->mundetected) &&
+           /* peaceful monsters */
+           ((mtmp->mpeaceful && !Hallucination) ||
+            /* monsters with no attacks */
+            noattacks(mtmp->data));
+}
+
+
+/*
+ * Travel distance map cache.
+ *
+ * Without it, findtravelpath() searches the whole level again for every
+ * single step of a trip, although nothing on the way usually changes.
+ * Instead, the distances from the destination to every square the hero could
+ * travel through are kept until the level changes in a way that matters to
+ * test_move(): terrain, doors, boulders, spotted traps or which squares have
+ * been seen.  The hero then just steps to the neighbouring square closest to
+ * the destination.  To notice those changes, a signature of every square is
+ * compared before each step, which costs far less than a search.
+ *
+ * Monsters that are merely in the way are left out of the map, because they
+ * move all the time; if one of them stands on every best next step, the
+ * search is done the old way for that step.
+ *
+ * Games started before RNGREV_TRAVEL_CACHE don't use the map, since their
+ * logs were recorded with a full search for every step.
+ */
+#define TRAVEL_UNREACHED	UINT_MAX
+
+/* everything about the hero that test_move() cares about during travel */
+struct travel_hero {
+    const struct permonst *data;
+    boolean passes_walls, ooze, airborne, blind, heavy, digger;
+};
+
+static struct travel_cache {
+    boolean valid;
+    d_level uz;
+    xchar tx, ty;
+    struct travel_hero hero;
+    unsigned dist[COLNO][ROWNO];
+    unsigned sig[COLNO][ROWNO];
+} travel_cache;
+
+
+void reset_travel_cache(void)
+{
+    travel_cache.valid = FALSE;
+}
+
+
+static void get_travel_hero(struct travel_hero *th)
+{
+    struct obj *obj;
+
+    memset(th, 0, sizeof(struct travel_hero));
+    th->data = youmonst.data;
+    th->passes_walls = !!Passes_walls;
+    th->ooze = can_ooze(&youmonst);
+    th->airborne = Levitation || Flying || is_clinger(youmonst.data);
+    th->blind = !!Blind;
+    th->heavy = invent && (inv_weight() + weight_cap() > 600);
+    th->digger = (tunnels(youmonst.data) && !needspick(youmonst.data)) ||
+                 carrying(PICK_AXE) || carrying(DWARVISH_MATTOCK) ||
+                 ((obj = carrying(WAN_DIGGING)) &&
+                  !objects[obj->otyp].oc_name_known);
+}
+
+
+static void get_travel_signature(unsigned sig[COLNO][ROWNO])
+{
+    const struct rm *loc;
+    const struct trap *trap;
+    int x, y;
+
+    for (x = 0; x < COLNO; x++) {
+        for (y = 0; y < ROWNO; y++) {
+            loc = &level->locations[x][y];
+            sig[x][y] = loc->typ | (loc->doormask << 8) |
+                        (loc->seenv ? 1 << 16 : 0) |
+                        (sobj_at(BOULDER, level, x, y) ? 1 << 17 : 0);
+        }
+    }
+    for (trap = level->lev_traps; trap; trap = trap->ntrap)
+        if (trap->tseen)
+            sig[trap->tx][trap->ty] |= 1 << 18;
+}
+
+
+/*
+ * Fill the distance map outward from (tx,ty).  This is the search done by
+ * findtravelpath() without a guess, except that it doesn't stop at the hero
+ * and that monsters don't count.
+ */
+static void fill_travel_cache(xchar tx, xchar ty)
+{
+    static const int ordered[] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    unsigned (*dist)[ROWNO] = travel_cache.dist;
+    xchar travelstepx[2][COLNO*ROWNO];
+    xchar travelstepy[2][COLNO*ROWNO];
+    int dirmax = u.umonnum == PM_GRID_BUG ? 4 : 8;
+    int n = 1, set = 0, radius = 1;
+    int i, x, y;
+
+    for (x = 0; x < COLNO; x++)
+        for (y = 0; y < ROWNO; y++)
+            dist[x][y] = TRAVEL_UNREACHED;
+    dist[tx][ty] = 0;
+    travelstepx[0][0] = tx;
+    travelstepy[0][0] = ty;
+
+    while (n != 0) {
+        int nn = 0;
+
+        for (i = 0; i < n; i++) {
+            int dir;
+            boolean alreadyrepeated = FALSE;
+
+            x = travelstepx[set][i];
+            y = travelstepy[set][i];
+            for (dir = 0; dir < dirmax; ++dir) {
+                int nx = x+xdir[ordered[dir]];
+                int ny = y+ydir[ordered[dir]];
+
+                if (!isok(nx, ny) || dist[nx][ny] != TRAVEL_UNREACHED)
+                    continue;
+
+                if ((!Passes_walls && !can_ooze(&youmonst) &&
+                     closed_door(level, nx, ny)) ||
+                    sobj_at(BOULDER, level, nx, ny) ||
+                    test_move(x, y, nx-x, ny-y, 0, TEST_TRAP)) {
+                    /* closed doors and boulders usually
+                     * cause a delay, so prefer another path */
+                    if ((int)dist[x][y] > radius-5) {
+                        if (!alreadyrepeated) {
+                            travelstepx[1-set][nn] = x;
+                            travelstepy[1-set][nn] = y;
+                            nn++;
+                            alreadyrepeated = TRUE;
+                        }
+                        continue;
+                    }
+                }
+                if ((test_move(x, y, nx-x, ny-y, 0, TEST_TRAP) ||
+                     test_move(x, y, nx-x, ny-y, 0, TEST_TRAV)) &&
+                    (level->locations[nx][ny].seenv ||
+                     (!Blind && couldsee(nx, ny)))) {
+                    travelstepx[1-set][nn] = nx;
+                    travelstepy[1-set][nn] = ny;
+                    dist[nx][ny] = radius;
+                    nn++;
+                }
+            }
+        }
+
+        n = nn;
+        set = 1-set;
+        radius++;
+    }
+}
+
+
+/*
+ * Take one step toward (tx,ty) using the distance map, which is refilled
+ * first if anything it depends on has changed.
+ * Returns 1 if a step was found, 0 if (tx,ty) can't be reached and -1 if
+ * monsters are in the way, so the caller has to search after all.
+ */
+static int travel_cached_step(xchar tx, xchar ty, schar *dx, schar *dy)
+{
+    static const int ordered[] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    static unsigned sig[COLNO][ROWNO];
+    struct travel_hero th;
+    unsigned here, best;
+    int dirmax = u.umonnum == PM_GRID_BUG ? 4 : 8;
+    int dir, x, y, bx = 0, by = 0;
+    boolean diverted = FALSE;
+
+    get_travel_hero(&th);
+    get_travel_signature(sig);
+    if (!travel_cache.valid || !on_level(&travel_cache.uz, &u.uz) ||
+        travel_cache.tx != tx || travel_cache.ty != ty ||
+        memcmp(&travel_cache.hero, &th, sizeof(th)) ||
+        memcmp(travel_cache.sig, sig, sizeof(sig))) {
+        fill_travel_cache(tx, ty);
+        travel_cache.valid = TRUE;
+        travel_cache.uz = u.uz;
+        travel_cache.tx = tx;
+        travel_cache.ty = ty;
+        travel_cache.hero = th;
+        memcpy(travel_cache.sig, sig, sizeof(sig));
+    }
+
+    /* only ever step closer, so that a monster in the way can't make the
+     * hero walk back and forth */
+    here = best = travel_cache.dist[u.ux][u.uy];
+    for (dir = 0; dir < dirmax; ++dir) {
+        x = u.ux - xdir[ordered[dir]];
+        y = u.uy - ydir[ordered[dir]];
+        if (!isok(x, y) || travel_cache.dist[x][y] >= best)
+            continue;
+        if (!test_move(x, y, u.ux-x, u.uy-y, 0, TEST_TRAP) &&
+            !test_move(x, y, u.ux-x, u.uy-y, 0, TEST_TRAV))
+            continue;
+        if (divert_mon(x, y)) {
+            diverted = TRUE;
+            continue;
+        }
+        best = travel_cache.dist[x][y];
+        bx = x;
+        by = y;
+    }
+
+    if (best == here)
+        return (here == TRAVEL_UNREACHED && !diverted) ? 0 : -1;
+
+    *dx = bx-u.ux;
+    *dy = by-u.uy;
+    if (bx == u.tx && by == u.ty) {
+        nomul(0, NULL);
+        /* reset run so domove run checks work */
+        flags.run = 8;
+        iflags.travelcc.x = iflags.travelcc.y = -1;
+    }
+    return 1;
+}
+
 /*
  * Find a path from the destination (u.tx,u.ty) back to (u.ux,u.uy).
  * A shortest path is returned.  If guess is non-NULL, instead travel
@@ -1140,6 +1378,9 @@ static boolean findtravelpath(boolean (*guess)(int, int), schar *dx, schar *dy)
             tx = u.ux; ty = u.uy; ux = u.tx; uy = u.ty;
         } else {
             tx = u.tx; ty = u.ty; ux = u.ux; uy = u.uy;
+            if (iflags.rng_revision >= RNGREV_TRAVEL_CACHE &&
+                (i = travel_cached_step(tx, ty, dx, dy)) >= 0)
+                return i;
         }
 
     noguess:
@@ -1160,8 +1401,6 @@ static boolean findtravelpath(boolean (*guess)(int, int), schar *dx, schar *dy)
                 boolean alreadyrepeated = FALSE;
 
                 for (dir = 0; dir < dirmax; ++dir) {
-                    const struct monst *mtmp;
-                    boolean divert_mon;
                     int nx = x+xdir[ordered[dir]];
                     int ny = y+ydir[ordered[dir]];
 
@@ -1203,23 +1442,10 @@ static boolean findtravelpath(boolean (*guess)(int, int), schar *dx, schar *dy)
                     if (!isok(nx, ny) || (guess == couldsee_func && !guess(nx, ny)))
                         continue;
 
-                    /* Walk around monsters that just get in the way. */
-                    mtmp = m_at(level, nx, ny);
-                    divert_mon = (mtmp &&
-                                  /* can be seen or spotted */
-                                  canspotmon(level, mtmp) &&
-                                  mtmp->m_ap_type != M_AP_FURNITURE &&
-                                  mtmp->m_ap_type != M_AP_OBJECT &&
-                                  !(is_hider(mtmp->data) || mtmp->mundetected) &&
-                                  /* peaceful monsters */
-                                  ((mtmp->mpeaceful && !Hallucination) ||
-                                   /* monsters with no attacks */
-                                   noattacks(mtmp->data)));
-
                     if ((!Passes_walls && !can_ooze(&youmonst) &&
                          closed_door(level, nx, ny)) ||
                         sobj_at(BOULDER, level, nx, ny) ||
-                        divert_mon ||
+                        divert_mon(nx, ny) ||
                         test_move(x, y, nx-x, ny-y, 0, TEST_TRAP)) {
                         /* closed doors and boulders usually
                          * cause a delay, so prefer another path */
@@ -1312,6 +1538,9 @@ static boolean findtravelpath(boolean (*guess)(int, int), schar *dx, schar *dy)
                     return TRUE;
                 goto found;
             }
+            if (iflags.rng_revision >= RNGREV_TRAVEL_CACHE &&
+                (i = travel_cached_step(px, py, dx, dy)) >= 0)
+                return i;
             tx = px;
             ty = py;
             ux = u.ux;
@@ -353,6 +353,7 @@ struct obj *addinv(struct obj *obj)
         setuqwep(obj);
 
  added:
+    reset_inv_props(&youmonst);
     addinv_core2(obj);
     carry_obj_effects(obj);     /* carrying affects the obj */
     update_inventory();
@@ -537,6 +538,7 @@ void freeinv_core(struct obj *obj)
 void freeinv(struct obj *obj)
 {
     extract_nobj(obj, &invent);
+    reset_inv_props(&youmonst);
     freeinv_core(obj);
     update_inventory();
 }
@@ -438,12 +438,17 @@ static void write_ls(struct memfile *mf, light_source *ls)
 void obj_move_light_source(struct obj *src, struct obj *dest)
 {
     light_source *ls;
+    struct level *right_lev = obj_is_local(dest) ? dest->olev : level;
 
     for (ls = src->olev->lev_lights; ls; ls = ls->next)
         if (ls->type == LS_OBJECT && ls->id == src)
             ls->id = dest;
     src->lamplit = 0;
     dest->lamplit = 1;
+
+    /* keep the light with dest if it lives somewhere else */
+    if (right_lev != src->olev)
+        transfer_lights(src->olev, right_lev, dest->o_id);
 }
 
 /* return true if there exist any light sources */
@@ -16,6 +16,7 @@ static struct memfile recent_cmd_states[2];
 static struct memfile *last_cmd_state = recent_cmd_states;
 static const char *const statuscodes[] = {"save", "done", "inpr"};
 static int last_curline;
+static void (*save_timer)(nh_bool done);
 
 static const unsigned char b64e[64] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -23,6 +24,15 @@ static const unsigned char b64e[64] =
 static void log_binary(const char *buf, int buflen, char prefix[3]);
 
 
+/* Register a function that is called before (done = FALSE) and after
+ * (done = TRUE) the game state is saved and diffed at the end of each command.
+ * The server uses this to measure the time spent there. */
+void nh_set_save_timer(void (*timer)(nh_bool done))
+{
+    save_timer = timer;
+}
+
+
 static int base64size(int n)
 {
     return compressBound(n) * 4 / 3 + 4 + 12; /* 12 for $4294967296$ */
@@ -214,8 +224,8 @@ void log_newgame(int logfd, unsigned long long start_time,
     else
         role = roles[u.initrole].name.m;
 
-    lprintf("NHGAME inpr %08x 00000000 %d.%d.%d\n", 0, VERSION_MAJOR,
-            VERSION_MINOR, PATCHLEVEL);
+    lprintf("NHGAME inpr %08x 00000000 %d.%d.%d.%d\n", 0, VERSION_MAJOR,
+            VERSION_MINOR, PATCHLEVEL, iflags.rng_revision);
 
     base64_encode(plname, encbuf);
     lprintf("%llx %x %d %s %s %s %s %s\n", start_time, seed, playmode, encbuf, role,
@@ -283,11 +293,15 @@ void log_command_result(void)
             (last_cmd_state == &recent_cmd_states[0] ?
              &recent_cmd_states[1] : &recent_cmd_states[0]);
 
+        if (save_timer)
+            save_timer(FALSE);
         mnew(this_cmd_state, last_cmd_state);
         savegame(this_cmd_state); /* both records the state, and calcs a diff */
         lprintf("\n~");
         mdiffflush(this_cmd_state);
         log_binary(this_cmd_state->diffbuf, this_cmd_state->diffpos, " f:");
+        if (save_timer)
+            save_timer(TRUE);
 #ifdef DEBUG
         /* some debug code for checking diff efficiency */
         int edits = 0, editbytes = 0, copies = 0, copybytes = 0, seeks = 0, i;
@@ -93,6 +93,7 @@ static const struct nh_window_procs def_replay_windowprocs = {
                                                               replay_level_changed,
                                                               replay_outrip,
                                                               replay_print_message,
+                                                              NULL, /* replays don't animate */
 };
 
 
@@ -663,6 +664,7 @@ void replay_setup_windowprocs(const struct nh_window_procs *procs)
     windowprocs.win_display_objects = replay_display_objects;
     windowprocs.win_pause = replay_pause;
     windowprocs.win_delay = replay_delay_output;
+    windowprocs.win_play_animation = NULL;
 
     replay_windowprocs = windowprocs;
 }
@@ -701,7 +703,7 @@ void replay_read_newgame(unsigned long long *init, int *playmode, char *namebuf,
                          int *initrole, int *initrace, int *initgend, int *initalign)
 {
     char *header, *verstr;
-    int ver1, ver2, ver3, n;
+    int ver1, ver2, ver3, rngrev, n;
     unsigned int seed;
 
     header = next_log_token();
@@ -714,9 +716,11 @@ void replay_read_newgame(unsigned long long *init, int *playmode, char *namebuf,
     next_log_token(); /* action count, see replay_begin() */
     verstr = next_log_token();
 
-    n = sscanf(verstr, "%d.%d.%d", &ver1, &ver2, &ver3);
-    if (n != 3)
+    n = sscanf(verstr, "%d.%d.%d.%d", &ver1, &ver2, &ver3, &rngrev);
+    if (n < 3)
         parse_error("No version found where it was expected");
+    /* logs from before RNG revisions were recorded have no 4th component */
+    iflags.rng_revision = (n == 4) ? rngrev : 0;
     /* now verstr is not read any more */
 
     if (ver1 != VERSION_MAJOR && ver2 != VERSION_MINOR)
@@ -1443,9 +1447,10 @@ enum nh_log_status nh_get_savegame_status(int fd, struct nh_game_info *gi)
     if (read(fd, header, 127) <= 0) return LS_INVALID;
     header[127] = '\0';
 
-    if (sscanf(header, "NHGAME %4s %x %*8s %d.%d.%d\n%n",
+    if (sscanf(header, "NHGAME %4s %x %*8s %d.%d.%d%n",
                status, &savepos, &v1, &v2, &v3, &n) < 5)
         return LS_INVALID;
+    n += strspn(header + n, ".0123456789"); /* RNG revision, if any */
     n2 = sscan_llx(header + n, &starttime);
     if (!n2) return LS_INVALID;
     n += n2;
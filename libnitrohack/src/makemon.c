@@ -7,6 +7,7 @@
 #include "edog.h"
 #include "eshk.h"
 #include "vault.h"
+#include "patchlevel.h"
 #include <ctype.h>
 
 /* this assumes that a human quest leader or nemesis is an archetype
@@ -685,6 +686,7 @@ struct monst *clone_mon(struct monst *mon,
     m2->my = mm.y;
 
     m2->minvent = NULL; /* objects don't clone */
+    reset_inv_props(m2);
     m2->mleashed = FALSE;
     /* Max HP the same, but current HP halved for both.  The caller
      * might want to override this by halving the max HP also.
@@ -1126,6 +1128,13 @@ static boolean uncommon(const d_level *dlev, int mndx)
         return (mons[mndx].geno & G_HELL) != 0;
 }
 
+static int level_align(const d_level *dlev)
+{
+    s_level *lev = Is_special(dlev);
+
+    return lev ? lev->flags.align : dungeons[dlev->dnum].flags.align;
+}
+
 /*
  *  shift the probability of a monster's generation by
  *  comparing the dungeon alignment and monster alignment.
@@ -1133,10 +1142,9 @@ static boolean uncommon(const d_level *dlev, int mndx)
  */
 static int align_shift(const d_level *dlev, const struct permonst *ptr)
 {
-    s_level *lev = Is_special(dlev);
     int alshift;
 
-    switch((lev) ? lev->flags.align : dungeons[dlev->dnum].flags.align) {
+    switch(level_align(dlev)) {
     default:    /* just in case */
     case AM_NONE:   alshift = 0;
         break;
@@ -1180,22 +1188,141 @@ static struct rndmonst_state {
     char mchoices[SPECIAL_PM];  /* value range is 0..127 */
 } rndmonst_state;
 
-/* select a random monster type */
-const struct permonst *rndmonst(struct level *lev)
+/*
+ * Monster generation for games with an RNG revision of at least
+ * RNGREV_ALIAS_MONS draws from alias tables (see alias.c).  rndmonst()
+ * and mkclass() each keep a few tables for the situations they were last
+ * called in, so that most draws only need a lookup and one random number.
+ *
+ * Everything that goes into a table is part of its key, except for the
+ * genocided and extinct species: any change to those bumps
+ * mongen_generation instead, which is part of every key.
+ *
+ * Older games keep using rndmonst_compat() and mkclass_compat(), which
+ * rebuild or walk the choices on every call but consume random numbers in
+ * exactly the way their logs expect.
+ */
+#define RNDMONST_TABLES  8
+#define MKCLASS_TABLES  16
+#define MONGEN_KEYLEN    5
+
+struct mongen_table {
+    int key[MONGEN_KEYLEN];
+    boolean valid;
+    unsigned int lastuse;
+    struct alias_table at;
+    short *mndx;        /* the monster for each entry of the table */
+};
+
+static struct mongen_table rndmonst_tables[RNDMONST_TABLES];
+static struct mongen_table mkclass_tables[MKCLASS_TABLES];
+static unsigned int mongen_generation, mongen_clock;
+
+/* properties of a level that restrict rndmonst() beyond its difficulty */
+#define GEN_ROGUE       0x01
+#define GEN_HELL        0x02
+#define GEN_BLACKMARKET 0x04
+#define GEN_PLANE       0x08    /* elemental plane */
+#define GEN_PLANE_EARTH 0x10
+#define GEN_PLANE_WATER 0x20
+#define GEN_PLANE_FIRE  0x40
+#define GEN_PLANE_AIR   0x80
+
+
+/* Find the table for key in cache, or replace the one that has gone unused
+ * longest; in that case the returned table is not valid and must be built. */
+static struct mongen_table *find_mongen_table(struct mongen_table *cache,
+                                              int count, const int *key)
 {
-    const struct permonst *ptr;
-    int mndx, ct;
-    const d_level *dlev = &lev->z;
+    struct mongen_table *t, *oldest = cache;
 
-    if (lev->mon_gen &&
-        rn2(100) < lev->mon_gen->override_chance &&
-        (ptr = get_override_mon(&lev->z, lev->mon_gen)) != NULL)
-        return ptr;
+    for (t = cache; t < cache + count; t++) {
+        if (t->valid && !memcmp(t->key, key, sizeof(t->key))) {
+            t->lastuse = ++mongen_clock;
+            return t;
+        }
+        if (!t->valid || (oldest->valid && t->lastuse < oldest->lastuse))
+            oldest = t;
+    }
+
+    t = oldest;
+    alias_free(&t->at);
+    free(t->mndx);
+    t->mndx = NULL;
+    memcpy(t->key, key, sizeof(t->key));
+    t->valid = FALSE;
+    t->lastuse = ++mongen_clock;
+    return t;
+}
+
+
+/* turn a weight for every candidate into a table with an entry for each
+ * candidate that can actually be chosen */
+static void fill_mongen_table(struct mongen_table *t, const short *cand,
+                              int *weight, int count)
+{
+    int i, n = 0;
+
+    t->mndx = malloc(max(count, 1) * sizeof(short));
+    for (i = 0; i < count; i++) {
+        if (weight[i] <= 0)
+            continue;
+        t->mndx[n] = cand[i];
+        weight[n++] = weight[i];
+    }
+    alias_build(&t->at, weight, n);
+    t->valid = TRUE;
+}
+
+
+void free_rndmonst_tables(void)
+{
+    int i;
+
+    for (i = 0; i < RNDMONST_TABLES; i++) {
+        alias_free(&rndmonst_tables[i].at);
+        free(rndmonst_tables[i].mndx);
+    }
+    for (i = 0; i < MKCLASS_TABLES; i++) {
+        alias_free(&mkclass_tables[i].at);
+        free(mkclass_tables[i].mndx);
+    }
+    memset(rndmonst_tables, 0, sizeof(rndmonst_tables));
+    memset(mkclass_tables, 0, sizeof(mkclass_tables));
+}
+
+
+/* generation frequency of a monster on a level for rndmonst(), 0 if it
+ * can't be generated there */
+static int rndmonst_weight(const d_level *dlev, int mndx,
+                           int minmlev, int maxmlev)
+{
+    const struct permonst *ptr = &mons[mndx];
+    boolean elemlevel = In_endgame(dlev) && !Is_astralevel(dlev);
+    int ct;
+
+    if (tooweak(mndx, minmlev) || toostrong(mndx, maxmlev))
+        return 0;
+    if (Is_rogue_level(dlev) && !isupper((uchar)def_monsyms[(int)(ptr->mlet)]))
+        return 0;
+    if (elemlevel && wrong_elem_type(dlev, ptr)) return 0;
+    if (uncommon(dlev, mndx)) return 0;
+    if (In_hell(dlev) && (ptr->geno & G_NOHELL)) return 0;
+    /* SWD: pets are not allowed in the black market */
+    if (is_domestic(ptr) && Is_blackmarket(dlev)) return 0;
+    ct = (int)(ptr->geno & G_FREQ) + align_shift(dlev, ptr);
+    if (ct < 0 || ct > 127)
+        panic("rndmonst: bad count [#%d: %d]", mndx, ct);
+    return ct;
+}
+
+
+static const struct permonst *rndmonst_compat(const d_level *dlev)
+{
+    int mndx, ct;
 
     if (rndmonst_state.choice_count < 0) {  /* need to recalculate */
         int minmlev, maxmlev;
-        boolean elemlevel;
-        boolean upper;
 
         rndmonst_state.choice_count = 0;
         /* look for first common monster */
@@ -1209,27 +1336,13 @@ const struct permonst *rndmonst(struct level *lev)
         } /* else `mndx' now ready for use below */
         minmlev = min_monster_difficulty(dlev);
         maxmlev = max_monster_difficulty(dlev);
-        upper = Is_rogue_level(dlev);
-        elemlevel = In_endgame(dlev) && !Is_astralevel(dlev);
 
         /*
          *  Find out how many monsters exist in the range we have selected.
          */
         /* (`mndx' initialized above) */
         for ( ; mndx < SPECIAL_PM; mndx++) {
-            ptr = &mons[mndx];
-            rndmonst_state.mchoices[mndx] = 0;
-            if (tooweak(mndx, minmlev) || toostrong(mndx, maxmlev))
-                continue;
-            if (upper && !isupper((uchar)def_monsyms[(int)(ptr->mlet)])) continue;
-            if (elemlevel && wrong_elem_type(dlev, ptr)) continue;
-            if (uncommon(dlev, mndx)) continue;
-            if (In_hell(dlev) && (ptr->geno & G_NOHELL)) continue;
-            /* SWD: pets are not allowed in the black market */
-            if (is_domestic(ptr) && Is_blackmarket(dlev)) continue;
-            ct = (int)(ptr->geno & G_FREQ) + align_shift(dlev, ptr);
-            if (ct < 0 || ct > 127)
-                panic("rndmonst: bad count [#%d: %d]", mndx, ct);
+            ct = rndmonst_weight(dlev, mndx, minmlev, maxmlev);
             rndmonst_state.choice_count += ct;
             rndmonst_state.mchoices[mndx] = (char)ct;
         }
@@ -1258,6 +1371,55 @@ const struct permonst *rndmonst(struct level *lev)
     return &mons[mndx];
 }
 
+
+/* select a random monster type */
+const struct permonst *rndmonst(struct level *lev)
+{
+    const struct permonst *ptr;
+    const d_level *dlev = &lev->z;
+    struct mongen_table *t;
+    int key[MONGEN_KEYLEN], genflags = 0, mndx, i;
+    short cand[SPECIAL_PM];
+    int weight[SPECIAL_PM];
+
+    if (lev->mon_gen &&
+        rn2(100) < lev->mon_gen->override_chance &&
+        (ptr = get_override_mon(&lev->z, lev->mon_gen)) != NULL)
+        return ptr;
+
+    if (iflags.rng_revision < RNGREV_ALIAS_MONS)
+        return rndmonst_compat(dlev);
+
+    if (Is_rogue_level(dlev)) genflags |= GEN_ROGUE;
+    if (In_hell(dlev)) genflags |= GEN_HELL;
+    if (Is_blackmarket(dlev)) genflags |= GEN_BLACKMARKET;
+    if (In_endgame(dlev) && !Is_astralevel(dlev)) {
+        genflags |= GEN_PLANE;
+        if (Is_earthlevel(dlev)) genflags |= GEN_PLANE_EARTH;
+        else if (Is_waterlevel(dlev)) genflags |= GEN_PLANE_WATER;
+        else if (Is_firelevel(dlev)) genflags |= GEN_PLANE_FIRE;
+        else if (Is_airlevel(dlev)) genflags |= GEN_PLANE_AIR;
+    }
+    key[0] = min_monster_difficulty(dlev);
+    key[1] = max_monster_difficulty(dlev);
+    key[2] = level_align(dlev);
+    key[3] = genflags;
+    key[4] = mongen_generation;
+
+    t = find_mongen_table(rndmonst_tables, RNDMONST_TABLES, key);
+    if (!t->valid) {
+        for (mndx = LOW_PM; mndx < SPECIAL_PM; mndx++) {
+            cand[mndx - LOW_PM] = mndx;
+            weight[mndx - LOW_PM] = rndmonst_weight(dlev, mndx, key[0], key[1]);
+        }
+        fill_mongen_table(t, cand, weight, SPECIAL_PM - LOW_PM);
+    }
+
+    /* maybe no common mons left, or all are too weak or too strong */
+    i = alias_select(&t->at);
+    return (i < 0) ? NULL : &mons[t->mndx[i]];
+}
+
 /* called when you change level (experience or dungeon depth) or when
    monster species can no longer be created (genocide or extinction) */
 /* mndx: particular species that can no longer be created */
@@ -1269,6 +1431,7 @@ void reset_rndmonst(int mndx)
     } else if (mndx < SPECIAL_PM) {
         rndmonst_state.choice_count -= rndmonst_state.mchoices[mndx];
         rndmonst_state.mchoices[mndx] = 0;
+        mongen_generation++;
     } /* note: safe to ignore extinction of unique monsters */
 }
 
@@ -1285,6 +1448,7 @@ void restore_rndmonst_state(struct memfile *mf)
 {
     rndmonst_state.choice_count = mread32(mf);
     mread(mf, rndmonst_state.mchoices, sizeof(rndmonst_state.mchoices));
+    mongen_generation++;    /* mvitals[] were restored as well */
 }
 
 
@@ -1307,22 +1471,13 @@ boolean monclass_nogen(char monclass)
     return TRUE;
 }
 
-/*  The routine below is used to make one of the multiple types
- *  of a given monster class.  The spc parameter specifies a
- *  special casing bit mask to allow the normal genesis
- *  masks to be deactivated.  Returns 0 if no monsters
- *  in that class can be made.
- */
-const struct permonst *mkclass(const d_level *dlev, char class, int spc)
+
+static const struct permonst *mkclass_compat(const d_level *dlev, char class,
+                                             int mask)
 {
     int first, last, num = 0;
-    int maxmlev, mask = (G_NOGEN | G_UNIQ) & ~spc;
+    int maxmlev = level_difficulty(dlev) >> 1;
 
-    maxmlev = level_difficulty(dlev) >> 1;
-    if (class < 1 || class >= MAXMCLASSES) {
-        warning("mkclass called with bad class!");
-        return NULL;
-    }
     /*  Assumption #1:  monsters of a given class are contiguous in the
      *          mons[] array.
      */
@@ -1361,6 +1516,108 @@ const struct permonst *mkclass(const d_level *dlev, char class, int spc)
     return &mons[first];
 }
 
+
+/*
+ * Build the mkclass() table for a class: the chance of each monster is
+ * worked out exactly as mkclass_compat() would pick it, with its coin flips
+ * that may cut off the stronger monsters, and its skew towards monsters
+ * that are strong for the level.  The chances are scaled to weights that
+ * add up to about 1 << MKCLASS_SCALE.
+ */
+#define MKCLASS_SCALE 20
+
+static void build_mkclass_table(struct mongen_table *t, const d_level *dlev,
+                                char class, int mask)
+{
+    int first, last, num = 0, n = 0, ncuts = 0, j, k, c, hits, shift;
+    int maxmlev = level_difficulty(dlev) >> 1;
+    short cand[SPECIAL_PM];
+    int weight[SPECIAL_PM], span[SPECIAL_PM];
+    int cutlen[SPECIAL_PM + 1], cutnum[SPECIAL_PM + 1];
+    long long prob;
+
+    for (first = LOW_PM; first < SPECIAL_PM; first++)
+        if (mons[first].mlet == class) break;
+
+    for (last = first;
+         last < SPECIAL_PM && mons[last].mlet == class; last++) {
+        if ((mvitals[last].mvflags & G_GONE) || (mons[last].geno & mask) ||
+            is_placeholder(&mons[last]))
+            continue;
+        /* mkclass_compat() stops here if a coin flip says so */
+        if (num && toostrong(last, maxmlev) && monstr[last] != monstr[last-1]) {
+            cutlen[ncuts] = n;
+            cutnum[ncuts] = num;
+            ncuts++;
+        }
+        cand[n] = last;
+        /* a strong monster also gets the draw just past its frequency */
+        span[n] = (mons[last].geno & G_FREQ) +
+            (adj_lev(dlev, &mons[last]) > level_difficulty(dlev) * 2 &&
+             mons[last].mlevel != mons[last+1].mlevel);
+        num += mons[last].geno & G_FREQ;
+        n++;
+    }
+    cutlen[ncuts] = n;
+    cutnum[ncuts] = num;
+
+    memset(weight, 0, sizeof(weight));
+    if (num) {
+        /* stopping at cut j has a chance of 1 / 2^(j+1); getting past all
+         * of them one of 1 / 2^ncuts */
+        for (j = 0; j <= ncuts; j++) {
+            shift = (j < ncuts) ? j + 1 : ncuts;
+            if (shift > MKCLASS_SCALE)
+                continue;
+            for (k = 0, c = 0; k < cutlen[j] && c < cutnum[j]; c += span[k++]) {
+                hits = min(c + span[k], cutnum[j]) - c;
+                if (hits <= 0)
+                    continue;
+                prob = ((long long)hits << (MKCLASS_SCALE - shift)) / cutnum[j];
+                /* rounding must not make any possible monster impossible */
+                weight[k] += max(prob, 1);
+            }
+        }
+    }
+
+    fill_mongen_table(t, cand, weight, n);
+}
+
+
+/*  The routine below is used to make one of the multiple types
+ *  of a given monster class.  The spc parameter specifies a
+ *  special casing bit mask to allow the normal genesis
+ *  masks to be deactivated.  Returns 0 if no monsters
+ *  in that class can be made.
+ */
+const struct permonst *mkclass(const d_level *dlev, char class, int spc)
+{
+    int mask = (G_NOGEN | G_UNIQ) & ~spc;
+    struct mongen_table *t;
+    int key[MONGEN_KEYLEN], i;
+
+    if (class < 1 || class >= MAXMCLASSES) {
+        warning("mkclass called with bad class!");
+        return NULL;
+    }
+
+    if (iflags.rng_revision < RNGREV_ALIAS_MONS)
+        return mkclass_compat(dlev, class, mask);
+
+    key[0] = class;
+    key[1] = mask;
+    key[2] = level_difficulty(dlev);
+    key[3] = mvitals[PM_WIZARD_OF_YENDOR].died;  /* see adj_lev() */
+    key[4] = mongen_generation;
+
+    t = find_mongen_table(mkclass_tables, MKCLASS_TABLES, key);
+    if (!t->valid)
+        build_mkclass_table(t, dlev, class, mask);
+
+    i = alias_select(&t->at);
+    return (i < 0) ? NULL : &mons[t->mndx[i]];
+}
+
 /* adjust strength of monsters based on depth */
 int adj_lev(const d_level *dlev, const struct permonst *ptr)
 {
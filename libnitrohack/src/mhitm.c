@@ -93,8 +93,8 @@ static void missmm(struct monst *magr, struct monst *mdef, const struct attack *
  */
 int fightm(struct monst *mtmp)      /* have monsters fight each other */
 {
-    struct monst *mon, *nmon;
-    int result, has_u_swallowed;
+    struct monst *mon, *list[MONS_IN_RANGE_MAX];
+    int result, has_u_swallowed, i, n;
 
     /* perhaps the monster will resist Conflict */
     if (resist(mtmp, RING_CLASS, 0, 0))
@@ -107,9 +107,9 @@ int fightm(struct monst *mtmp)      /* have monsters fight each other */
     }
     has_u_swallowed = (u.uswallow && (mtmp == u.ustuck));
 
-    for (mon = level->monlist; mon; mon = nmon) {
-        nmon = mon->nmon;
-        if (nmon == mtmp) nmon = mtmp->nmon;
+    n = monsters_around(level, mtmp->mx, mtmp->my, 1, list);
+    for (i = 0; i < n; i++) {
+        mon = list[i];
         /* Be careful to ignore monsters that are already dead, since we
          * might be calling this before we've cleaned them up.  This can
          * happen if the monster attacked a cockatrice bare-handedly, for
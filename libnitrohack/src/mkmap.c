@@ -9,7 +9,6 @@
 
 static void init_map(struct level *lev, schar bg_typ);
 static void init_fill(struct level *lev, schar bg_typ, schar fg_typ);
-static schar get_map(struct level *lev, int col, int row, schar bg_typ);
 static void pass_one(struct level *lev, schar,schar);
 static void pass_two(struct level *lev, schar,schar);
 static void pass_three(struct level *lev, schar,schar);
@@ -19,7 +18,6 @@ static void finish_map(struct level *lev, schar,schar,xchar,xchar);
 static void remove_room(struct level *lev, unsigned roomno);
 static void backfill(struct level *lev, schar bg_typ, schar filler);
 
-char *new_locations;
 int min_rx, max_rx, min_ry, max_ry; /* rectangle bounds for regions */
 static int n_loc_filled;
 
@@ -73,109 +71,170 @@ static void init_fill(struct level *lev, schar bg_typ, schar fg_typ)
     }
 }
 
-static schar get_map(struct level *lev, int col, int row, schar bg_typ)
+/*
+ * The cellular automaton passes work on bit-packed columns: bit j of
+ * map_bits[x] is set if location (x,j) is fg_typ.  Locations outside
+ * 1 <= x <= WIDTH, 0 <= y < HEIGHT count as bg_typ.  A column fits in one
+ * word, so the neighbours of every row in a column are counted at once by
+ * adding shifted copies of the three columns into a bit-sliced counter.
+ */
+typedef unsigned long mapcol;
+
+#define ROW_BIT(j)      ((mapcol)1 << (j))
+#define ALL_ROWS        (ROW_BIT(HEIGHT+1) - 1)
+#define INNER_ROWS      (ALL_ROWS & ~ROW_BIT(0) & ~ROW_BIT(HEIGHT))
+
+struct nbr_count {
+    mapcol s0, s1, s2, s3;  /* binary digits of each row's count */
+};
+
+static mapcol map_bits[WIDTH+2];
+
+static void load_map_bits(struct level *lev, schar bg_typ, schar fg_typ)
 {
-    if (col <= 0 || row < 0 || col > WIDTH || row >= HEIGHT)
-        return bg_typ;
-    return lev->locations[col][row].typ;
+    mapcol outside = (bg_typ == fg_typ) ? ALL_ROWS : 0;
+    mapcol bits;
+    int i, j;
+
+    for (i = 1; i <= WIDTH; i++) {
+        bits = outside & ROW_BIT(HEIGHT);
+        for (j = 0; j < HEIGHT; j++)
+            if (lev->locations[i][j].typ == fg_typ)
+                bits |= ROW_BIT(j);
+        map_bits[i] = bits;
+    }
+    map_bits[WIDTH+1] = outside;
 }
 
-static const int dirs[16] = {
-                             -1, -1 /**/, -1, 0 /**/, -1, 1 /**/,
-                             0, -1 /**/,              0, 1 /**/,
-                             1, -1 /**/,  1, 0 /**/,  1, 1};
+static void count_add(struct nbr_count *c, mapcol p)
+{
+    mapcol carry;
+
+    carry = c->s0 & p;  c->s0 ^= p;  p = carry;
+    carry = c->s1 & p;  c->s1 ^= p;  p = carry;
+    carry = c->s2 & p;  c->s2 ^= p;
+    c->s3 |= carry;
+}
+
+/*
+ * Count the fg_typ neighbours of every row of column i.  The neighbour
+ * directly above (row j-1 of the same column) is left out if !above.
+ */
+static void count_neighbours(struct nbr_count *c, int i, boolean above)
+{
+    mapcol l = map_bits[i-1], m = map_bits[i], r = map_bits[i+1];
+
+    c->s0 = c->s1 = c->s2 = c->s3 = 0;
+    count_add(c, l << 1);
+    count_add(c, l);
+    count_add(c, l >> 1);
+    if (above)
+        count_add(c, m << 1);
+    count_add(c, m >> 1);
+    count_add(c, r << 1);
+    count_add(c, r);
+    count_add(c, r >> 1);
+}
+
+static void set_rows(struct level *lev, int i, mapcol rows, schar typ)
+{
+    int j;
+
+    for (j = 1; rows; j++)
+        if (rows & ROW_BIT(j)) {
+            lev->locations[i][j].typ = typ;
+            rows &= ~ROW_BIT(j);
+        }
+}
 
 static void pass_one(struct level *lev, schar bg_typ, schar fg_typ)
 {
+    struct nbr_count c;
+    mapcol die0, die1, born0, born1, col, bit;
+    boolean above;
     int i,j;
-    short count, dr;
 
-    for (i=2; i<=WIDTH; i++)
+    load_map_bits(lev, bg_typ, fg_typ);
+    for (i=2; i<=WIDTH; i++) {
+        /*
+         * This pass updates in place, so the location above has already
+         * been decided by the time a row is reached.  Count everything
+         * else up front (at most 7) and settle the rows top-down.
+         */
+        count_neighbours(&c, i, FALSE);
+        die0 = ~c.s2 & ~(c.s1 & c.s0);      /* 0..2, nothing above */
+        die1 = ~c.s2 & ~c.s1;               /* 0..1, plus one above */
+        born0 = c.s2 & (c.s1 | c.s0);       /* 5..7, nothing above */
+        born1 = c.s2;                       /* 4..7, plus one above */
+
+        col = map_bits[i];
         for (j=1; j<HEIGHT; j++) {
-            for (count=0, dr=0; dr < 8; dr++)
-                if (get_map(lev, i+dirs[dr*2], j+dirs[(dr*2)+1], bg_typ)
-                    == fg_typ)
-                    count++;
-
-            switch(count) {
-            case 0 : /* death */
-            case 1 :
-            case 2:
-                if (bg_typ >= MAX_TYPE) break;
+            bit = ROW_BIT(j);
+            above = (col & ROW_BIT(j-1)) != 0;
+            if ((above ? die1 : die0) & bit) {  /* death */
+                if (bg_typ >= MAX_TYPE) continue;
                 lev->locations[i][j].typ = bg_typ;
-                break;
-            case 5:
-            case 6:
-            case 7:
-            case 8:
-                if (fg_typ >= MAX_TYPE) break;
+                col = (bg_typ == fg_typ) ? (col | bit) : (col & ~bit);
+            } else if ((above ? born1 : born0) & bit) {
+                if (fg_typ >= MAX_TYPE) continue;
                 lev->locations[i][j].typ = fg_typ;
-                break;
-            default:
-                break;
+                col |= bit;
             }
         }
+        map_bits[i] = col;
+    }
 }
 
-#define new_loc(i,j)    *(new_locations+ ((j)*(WIDTH+1)) + (i))
-
 static void pass_two(struct level *lev, schar bg_typ, schar fg_typ)
 {
-    int i,j;
-    short count, dr;
+    struct nbr_count c;
+    int i;
 
-    for (i=2; i<=WIDTH; i++)
-        for (j=1; j<HEIGHT; j++) {
-            for (count=0, dr=0; dr < 8; dr++)
-                if (get_map(lev, i+dirs[dr*2], j+dirs[(dr*2)+1], bg_typ)
-                    == fg_typ)
-                    count++;
-            if (count == 5)
-                new_loc(i,j) = bg_typ;
-            else
-                new_loc(i,j) = get_map(lev, i,j, bg_typ);
-        }
+    if (bg_typ >= MAX_TYPE) return;
 
-    for (i=2; i<=WIDTH; i++)
-        for (j=1; j<HEIGHT; j++)
-            if (new_loc(i,j) < MAX_TYPE)
-                lev->locations[i][j].typ = new_loc(i,j);
+    load_map_bits(lev, bg_typ, fg_typ);
+    for (i=2; i<=WIDTH; i++) {
+        count_neighbours(&c, i, TRUE);
+        /* exactly 5 */
+        set_rows(lev, i, INNER_ROWS & c.s0 & ~c.s1 & c.s2 & ~c.s3, bg_typ);
+    }
 }
 
 static void pass_three(struct level *lev, schar bg_typ, schar fg_typ)
 {
-    int i,j;
-    short count, dr;
+    struct nbr_count c;
+    int i;
 
-    for (i=2; i<=WIDTH; i++)
-        for (j=1; j<HEIGHT; j++) {
-            for (count=0, dr=0; dr < 8; dr++)
-                if (get_map(lev, i+dirs[dr*2], j+dirs[(dr*2)+1], bg_typ)
-                    == fg_typ)
-                    count++;
-            if (count < 3)
-                new_loc(i,j) = bg_typ;
-            else
-                new_loc(i,j) = get_map(lev, i,j, bg_typ);
-        }
+    if (bg_typ >= MAX_TYPE) return;
 
-    for (i=2; i<=WIDTH; i++)
-        for (j=1; j<HEIGHT; j++)
-            if (new_loc(i,j) < MAX_TYPE)
-                lev->locations[i][j].typ = new_loc(i,j);
+    load_map_bits(lev, bg_typ, fg_typ);
+    for (i=2; i<=WIDTH; i++) {
+        count_neighbours(&c, i, TRUE);
+        /* fewer than 3 */
+        set_rows(lev, i, INNER_ROWS & ~c.s3 & ~c.s2 & ~(c.s1 & c.s0), bg_typ);
+    }
 }
 
 /*
- * use a flooding algorithm to find all locations that should
- * have the same rm number as the current location.
- * if anyroom is TRUE, use IS_ROOM to check room membership instead of
- * exactly matching level->locations[sx][sy].typ and walls are included as well.
+ * flood_fill_rm() fills one horizontal span per step and then scans the
+ * rows above and below it for further spans.  The pending steps are kept
+ * on an explicit stack, visited in exactly the order the old recursive
+ * version made its calls, so the rooms it produces are unchanged.
  */
-void flood_fill_rm(struct level *lev, int sx, int sy, int rmno, boolean lit, boolean anyroom)
+struct ff_frame {
+    xchar sx, sy;   /* leftmost location of the span */
+    xchar nx;       /* just past the span */
+    xchar i;        /* next column to check on row sy+dy */
+    schar dy;       /* -1 for the row above, then 1 for the row below */
+    boolean right;  /* i-1 has been checked, i+1 is next */
+};
+
+static struct ff_frame ff_stack[COLNO * ROWNO + 1];
+
+static void ff_span(struct level *lev, struct ff_frame *f, int sx, int sy,
+                    schar fg_typ, int rmno, boolean lit, boolean anyroom)
 {
     int i;
-    int nx;
-    schar fg_typ = lev->locations[sx][sy].typ;
 
     /* back up to find leftmost uninitialized location */
     while (sx > 0 &&
@@ -207,47 +266,91 @@ void flood_fill_rm(struct level *lev, int sx, int sy, int rmno, boolean lit, boo
         }
         n_loc_filled++;
     }
-    nx = i;
-
-    if (isok(sx,sy-1)) {
-        for (i=sx; i<nx; i++)
-            if (lev->locations[i][sy-1].typ == fg_typ) {
-                if ((int) lev->locations[i][sy-1].roomno != rmno)
-                    flood_fill_rm(lev, i,sy-1,rmno,lit,anyroom);
-            } else {
-                if ((i>sx || isok(i-1,sy-1)) &&
-                    lev->locations[i-1][sy-1].typ == fg_typ) {
-                    if ((int) lev->locations[i-1][sy-1].roomno != rmno)
-                        flood_fill_rm(lev, i-1,sy-1,rmno,lit,anyroom);
-                }
-                if ((i<nx-1 || isok(i+1,sy-1)) &&
-                    lev->locations[i+1][sy-1].typ == fg_typ) {
-                    if ((int) lev->locations[i+1][sy-1].roomno != rmno)
-                        flood_fill_rm(lev, i+1,sy-1,rmno,lit,anyroom);
+
+    f->sx = sx;
+    f->sy = sy;
+    f->nx = i;
+    f->i = sx;
+    f->dy = -1;
+    f->right = FALSE;
+}
+
+/* find the next unfilled location adjacent to the span, if any */
+static boolean ff_next(struct level *lev, struct ff_frame *f, schar fg_typ,
+                       int rmno, int *tx, int *ty)
+{
+    int i, y;
+
+    while (f->dy <= 1) {
+        i = f->i;
+        y = f->sy + f->dy;
+        if (!isok(f->sx, y) || i >= f->nx) {
+            f->dy += 2;
+            f->i = f->sx;
+            f->right = FALSE;
+            continue;
+        }
+        *ty = y;
+
+        if (!f->right) {
+            if (lev->locations[i][y].typ == fg_typ) {
+                f->i++;
+                if ((int) lev->locations[i][y].roomno != rmno) {
+                    *tx = i;
+                    return TRUE;
                 }
+                continue;
             }
-    }
-    if (isok(sx,sy+1)) {
-        for (i=sx; i<nx; i++)
-            if (lev->locations[i][sy+1].typ == fg_typ) {
-                if ((int) lev->locations[i][sy+1].roomno != rmno)
-                    flood_fill_rm(lev, i,sy+1,rmno,lit,anyroom);
-            } else {
-                if ((i>sx || isok(i-1,sy+1)) &&
-                    lev->locations[i-1][sy+1].typ == fg_typ) {
-                    if ((int) lev->locations[i-1][sy+1].roomno != rmno)
-                        flood_fill_rm(lev, i-1,sy+1,rmno,lit,anyroom);
-                }
-                if ((i<nx-1 || isok(i+1,sy+1)) &&
-                    lev->locations[i+1][sy+1].typ == fg_typ) {
-                    if ((int) lev->locations[i+1][sy+1].roomno != rmno)
-                        flood_fill_rm(lev, i+1,sy+1,rmno,lit,anyroom);
-                }
+            f->right = TRUE;
+            if ((i>f->sx || isok(i-1,y)) &&
+                lev->locations[i-1][y].typ == fg_typ &&
+                (int) lev->locations[i-1][y].roomno != rmno) {
+                *tx = i-1;
+                return TRUE;
             }
+            continue;
+        }
+
+        f->right = FALSE;
+        f->i++;
+        if ((i<f->nx-1 || isok(i+1,y)) &&
+            lev->locations[i+1][y].typ == fg_typ &&
+            (int) lev->locations[i+1][y].roomno != rmno) {
+            *tx = i+1;
+            return TRUE;
+        }
     }
+    return FALSE;
+}
 
-    if (nx > max_rx) max_rx = nx - 1; /* nx is just past valid region */
-    if (sy > max_ry) max_ry = sy;
+/*
+ * use a flooding algorithm to find all locations that should
+ * have the same rm number as the current location.
+ * if anyroom is TRUE, use IS_ROOM to check room membership instead of
+ * exactly matching level->locations[sx][sy].typ and walls are included as well.
+ */
+void flood_fill_rm(struct level *lev, int sx, int sy, int rmno, boolean lit, boolean anyroom)
+{
+    schar fg_typ = lev->locations[sx][sy].typ;
+    struct ff_frame *f;
+    int depth = 0, tx, ty;
+
+    ff_span(lev, &ff_stack[depth++], sx, sy, fg_typ, rmno, lit, anyroom);
+    while (depth > 0) {
+        f = &ff_stack[depth-1];
+        if (ff_next(lev, f, fg_typ, rmno, &tx, &ty)) {
+            /* every span with successors fills at least one new location */
+            if (depth >= SIZE(ff_stack)) {
+                impossible("flood_fill_rm: stack overflow");
+                continue;
+            }
+            ff_span(lev, &ff_stack[depth++], tx, ty, fg_typ, rmno, lit, anyroom);
+        } else {
+            if (f->nx > max_rx) max_rx = f->nx - 1; /* nx is just past valid region */
+            if (f->sy > max_ry) max_ry = f->sy;
+            depth--;
+        }
+    }
 }
 
 /*
@@ -464,8 +567,6 @@ void mkmap(struct level *lev, lev_init *init_lev)
     if (lit < 0)
         lit = (rnd(1+abs(depth(&u.uz))) < 11 && rn2(77)) ? 1 : 0;
 
-    new_locations = malloc((WIDTH+1) * HEIGHT);
-
     if (bg_typ < MAX_TYPE)
         init_map(lev, bg_typ);
     init_fill(lev, bg_typ, fg_typ);
@@ -495,7 +596,6 @@ void mkmap(struct level *lev, lev_init *init_lev)
         lev->flags.is_cavernous_lev = TRUE;
         backfill(lev, bg_typ, init_lev->filling);
     }
-    free(new_locations);
 }
 
 /*mkmap.c*/
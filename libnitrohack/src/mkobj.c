@@ -3,6 +3,7 @@
 
 #include "hack.h"
 #include "prop.h"
+#include "patchlevel.h"
 
 static void mkbox_cnts(struct obj *);
 static void obj_timer_checks(struct obj *, xchar, xchar, int);
@@ -88,27 +89,64 @@ struct obj *mksobj_at(int otyp, struct level *lev, int x, int y,
     return otmp;
 }
 
-struct obj *mkobj(struct level *lev, char oclass, boolean artif)
-{
-    int tprob, i, prob = rnd(1000);
+/*
+ * Alias tables for the class probability tables above, built on first use.
+ * Games with an RNG revision below RNGREV_ALIAS_OBJS walk the tables with
+ * rnd(100) instead.
+ */
+static struct icp_table {
+    const struct icp *iprobs;
+    int count;
+    struct alias_table at;
+} icp_tables[] = {
+    {mkobjprobs, SIZE(mkobjprobs)},
+    {boxiprobs, SIZE(boxiprobs)},
+    {rogueprobs, SIZE(rogueprobs)},
+    {hellprobs, SIZE(hellprobs)},
+};
 
-    if (oclass == RANDOM_CLASS) {
-        const struct icp *iprobs =
-            (Is_rogue_level(&lev->z)) ?
-            (const struct icp *)rogueprobs :
-            In_hell(&lev->z) ? (const struct icp *)hellprobs :
-            (const struct icp *)mkobjprobs;
+static char rnd_iclass(const struct icp *iprobs)
+{
+    struct icp_table *t;
+    int tprob, i, weight[MAXOCLASSES];
 
+    if (iflags.rng_revision < RNGREV_ALIAS_OBJS) {
         for (tprob = rnd(100);
              (tprob -= iprobs->iprob) > 0;
              iprobs++);
-        oclass = iprobs->iclass;
+        return iprobs->iclass;
     }
 
-    i = bases[(int)oclass];
-    while ((prob -= objects[i].oc_prob) > 0) i++;
+    for (t = icp_tables; t->iprobs != iprobs; t++)
+        ;
+    if (!t->at.n) {
+        for (i = 0; i < t->count; i++)
+            weight[i] = iprobs[i].iprob;
+        alias_build(&t->at, weight, t->count);
+    }
+    return iprobs[alias_select(&t->at)].iclass;
+}
 
-    if (objects[i].oc_class != oclass || !OBJ_NAME(objects[i]))
+struct obj *mkobj(struct level *lev, char oclass, boolean artif)
+{
+    int i, prob;
+
+    if (iflags.rng_revision < RNGREV_ALIAS_OBJS) {
+        /* the object is drawn before its class */
+        prob = rnd(1000);
+        if (oclass == RANDOM_CLASS)
+            oclass = rnd_iclass(Is_rogue_level(&lev->z) ? rogueprobs :
+                                In_hell(&lev->z) ? hellprobs : mkobjprobs);
+        i = bases[(int)oclass];
+        while ((prob -= objects[i].oc_prob) > 0) i++;
+    } else {
+        if (oclass == RANDOM_CLASS)
+            oclass = rnd_iclass(Is_rogue_level(&lev->z) ? rogueprobs :
+                                In_hell(&lev->z) ? hellprobs : mkobjprobs);
+        i = rnd_otyp(oclass);
+    }
+
+    if (i < 0 || objects[i].oc_class != oclass || !OBJ_NAME(objects[i]))
         panic("probtype error, oclass=%d i=%d", (int) oclass, i);
 
     return mksobj(lev, i, TRUE, artif);
@@ -147,12 +185,8 @@ static void mkbox_cnts(struct obj *box)
                 stop_timer(otmp->olev, REVIVE_MON, otmp);
             }
         } else {
-            int tprob;
-            const struct icp *iprobs = boxiprobs;
-
-            for (tprob = rnd(100); (tprob -= iprobs->iprob) > 0; iprobs++)
-                ;
-            if (!(otmp = mkobj(box->olev, iprobs->iclass, TRUE))) continue;
+            if (!(otmp = mkobj(box->olev, rnd_iclass(boxiprobs), TRUE)))
+                continue;
 
             /* handle a couple of special cases */
             if (otmp->oclass == COIN_CLASS) {
@@ -246,6 +280,7 @@ struct obj *splitobj(struct obj *obj, long num)
  */
 void replace_object(struct obj *obj, struct obj *otmp)
 {
+    obj_inv_props_changed(obj);
     otmp->where = obj->where;
     switch (obj->where) {
     case OBJ_FREE:
@@ -1232,6 +1267,7 @@ void obj_extract_self(struct obj *obj)
         break;
     case OBJ_MINVENT:
         extract_nobj(obj, &obj->ocarry->minvent);
+        reset_inv_props(obj->ocarry);
         break;
     case OBJ_BURIED:
         extract_nobj(obj, &obj->olev->buriedobjlist);
@@ -1307,6 +1343,8 @@ int add_to_minv(struct monst *mon, struct obj *obj)
               obj->where, obj->otyp, obj->invlet);
     }
 
+    reset_inv_props(mon);
+
     /* merge if possible */
     for (otmp = mon->minvent; otmp; otmp = otmp->nobj)
         if (merged(&otmp, &obj))
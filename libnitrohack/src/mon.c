@@ -4,6 +4,7 @@
 #include "hack.h"
 #include "mfndpos.h"
 #include "edog.h"
+#include "patchlevel.h"
 #include <ctype.h>
 
 static boolean restrap(struct monst *);
@@ -2117,9 +2118,12 @@ void wakeup(struct monst *mtmp)
 /* Wake up nearby monsters. */
 void wake_nearby(void)
 {
-    struct monst *mtmp;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int i, n;
 
-    for (mtmp = level->monlist; mtmp; mtmp = mtmp->nmon) {
+    n = monsters_within(level, u.ux, u.uy, u.ulevel*20, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
         if (!DEADMONSTER(mtmp) && distu(mtmp->mx,mtmp->my) < u.ulevel*20) {
             mtmp->msleeping = 0;
             if (mtmp->mtame && !mtmp->isminion)
@@ -2131,15 +2135,116 @@ void wake_nearby(void)
 /* Wake up monsters near some particular location. */
 void wake_nearto(int x, int y, int distance)
 {
-    struct monst *mtmp;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int i, n;
 
-    for (mtmp = level->monlist; mtmp; mtmp = mtmp->nmon) {
-        if (!DEADMONSTER(mtmp) && mtmp->msleeping && (distance == 0 ||
-                                                      dist2(mtmp->mx, mtmp->my, x, y) < distance))
+    if (distance == 0) {
+        for (mtmp = level->monlist; mtmp; mtmp = mtmp->nmon)
+            if (!DEADMONSTER(mtmp))
+                mtmp->msleeping = 0;
+        return;
+    }
+
+    n = monsters_within(level, x, y, distance, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
+        if (!DEADMONSTER(mtmp) && dist2(mtmp->mx, mtmp->my, x, y) < distance)
             mtmp->msleeping = 0;
     }
 }
 
+
+/*
+ * Spatial monster queries, for noises and other area effects.
+ *
+ * These fill list (which needs room for MONS_IN_RANGE_MAX entries) with the
+ * living monsters of lev whose position is in range of (x,y), and return how
+ * many there are.  Only the locations in range are looked at, row by row, so
+ * the cost doesn't depend on how many monsters the level has.  Long worms
+ * are found by their head only; the hero's steed, which isn't on the map,
+ * is included as well.
+ *
+ * The list is a snapshot, so callers may do anything to the monsters in it,
+ * but they must check the exact range themselves if what they do to one
+ * monster can move or kill another.  Games with an RNG revision below
+ * RNGREV_MONS_IN_RANGE get all monsters of the level in monlist order
+ * instead, since that is the order in which the loops these queries
+ * replaced used random numbers.
+ */
+static int monsters_in_span(struct level *lev, int x, int y, int dy, int dx,
+                            struct monst **list, int n)
+{
+    struct monst *mtmp;
+    int sx, ex;
+
+    y += dy;
+    sx = max(x - dx, 0);
+    ex = min(x + dx, COLNO - 1);
+    for (x = sx; x <= ex; x++) {
+        mtmp = lev->monsters[x][y];
+        if (mtmp && !DEADMONSTER(mtmp) && mtmp->mx == x && mtmp->my == y)
+            list[n++] = mtmp;
+    }
+    return n;
+}
+
+static int all_monsters(struct level *lev, struct monst **list)
+{
+    struct monst *mtmp;
+    int n = 0;
+
+    for (mtmp = lev->monlist; mtmp && n < MONS_IN_RANGE_MAX; mtmp = mtmp->nmon)
+        if (!DEADMONSTER(mtmp))
+            list[n++] = mtmp;
+    return n;
+}
+
+static int add_steed(struct level *lev, boolean in_range, struct monst **list,
+                     int n)
+{
+    if (lev == level && u.usteed && !DEADMONSTER(u.usteed) && in_range &&
+        n < MONS_IN_RANGE_MAX)
+        list[n++] = u.usteed;
+    return n;
+}
+
+/* monsters with dist2(mx, my, x, y) < dist */
+int monsters_within(struct level *lev, int x, int y, int dist,
+                    struct monst **list)
+{
+    int dy, dx, n = 0;
+
+    if (iflags.rng_revision < RNGREV_MONS_IN_RANGE)
+        return all_monsters(lev, list);
+
+    for (dy = -y; dy < ROWNO - y; dy++) {
+        if (dy * dy >= dist)
+            continue;
+        /* widest span of this row that is in range */
+        for (dx = 0; dx < COLNO && (dx+1) * (dx+1) + dy * dy < dist; dx++)
+            ;
+        n = monsters_in_span(lev, x, y, dy, dx, list, n);
+    }
+    return add_steed(lev, u.usteed &&
+                     dist2(u.usteed->mx, u.usteed->my, x, y) < dist, list, n);
+}
+
+/* monsters with distmin(mx, my, x, y) <= radius */
+int monsters_around(struct level *lev, int x, int y, int radius,
+                    struct monst **list)
+{
+    int dy, n = 0;
+
+    if (iflags.rng_revision < RNGREV_MONS_IN_RANGE)
+        return all_monsters(lev, list);
+
+    for (dy = max(-radius, -y); dy <= min(radius, ROWNO - 1 - y); dy++)
+        n = monsters_in_span(lev, x, y, dy, radius, list, n);
+    return add_steed(lev, u.usteed &&
+                     distmin(u.usteed->mx, u.usteed->my, x, y) <= radius,
+                     list, n);
+}
+
 /* NOTE: we must check for mimicry before calling this routine */
 void seemimic(struct monst *mtmp)
 {
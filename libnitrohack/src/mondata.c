@@ -7,6 +7,23 @@
 
 static const struct attack *dmgtype_fromattack(const struct permonst *,int,int);
 
+/* attack and damage types of the monsters in mons[], see AT_BIT and AD_BIT;
+ * other permonsts such as upermonst have to look at their attacks */
+extern const unsigned int monattk_at[];
+extern const unsigned long long monattk_ad[];
+#define has_attk_masks(ptr)	((ptr) >= &mons[LOW_PM] && (ptr) < &mons[NUMMONS])
+
+#ifdef ATTK_STATS
+/* how often each of the attack and damage type lookups below is called, how
+ * often it finds a match and how often it has to look at the attacks */
+enum { ATTK_ATTACKTYPE, ATTK_FORDMG, ATTK_DMGTYPE, ATTK_FROMATTACK, ATTK_FNS };
+enum { ATTK_CALLS, ATTK_HITS, ATTK_WALKS, ATTK_COUNTS };
+static long attk_stats[ATTK_FNS][ATTK_COUNTS];
+# define ATTK_COUNT(fn, what)	(attk_stats[fn][what]++)
+#else
+# define ATTK_COUNT(fn, what)	((void)0)
+#endif
+
 /*  These routines provide basic data for any type of monster. */
 
 void set_mon_data(struct monst *mon, const struct permonst *ptr, int flag)
@@ -26,16 +43,36 @@ const struct attack *attacktype_fordmg(const struct permonst *ptr, int atyp, int
 {
     const struct attack *a;
 
+    ATTK_COUNT(ATTK_FORDMG, ATTK_CALLS);
+    if (has_attk_masks(ptr) &&
+        (!(monattk_at[ptr - mons] & AT_BIT(atyp)) ||
+         (dtyp != AD_ANY && !(monattk_ad[ptr - mons] & AD_BIT(dtyp)))))
+        return NULL;
+
+    ATTK_COUNT(ATTK_FORDMG, ATTK_WALKS);
     for (a = &ptr->mattk[0]; a < &ptr->mattk[NATTK]; a++)
-        if (a->aatyp == atyp && (dtyp == AD_ANY || a->adtyp == dtyp))
+        if (a->aatyp == atyp && (dtyp == AD_ANY || a->adtyp == dtyp)) {
+            ATTK_COUNT(ATTK_FORDMG, ATTK_HITS);
             return a;
+        }
 
     return NULL;
 }
 
 boolean attacktype(const struct permonst *ptr, int atyp)
 {
-    return attacktype_fordmg(ptr, atyp, AD_ANY) ? TRUE : FALSE;
+    boolean found;
+
+    ATTK_COUNT(ATTK_ATTACKTYPE, ATTK_CALLS);
+    if (has_attk_masks(ptr))
+        found = (monattk_at[ptr - mons] & AT_BIT(atyp)) != 0;
+    else {
+        ATTK_COUNT(ATTK_ATTACKTYPE, ATTK_WALKS);
+        found = attacktype_fordmg(ptr, atyp, AD_ANY) ? TRUE : FALSE;
+    }
+    if (found)
+        ATTK_COUNT(ATTK_ATTACKTYPE, ATTK_HITS);
+    return found;
 }
 
 
@@ -61,23 +98,14 @@ boolean resists_drli(struct monst *mon)
 boolean resists_magm(struct monst *mon)
 {
     const struct permonst *ptr = mon->data;
-    struct obj *o;
 
     /* as of 3.2.0:  gray dragons, Angels, Oracle, Yeenoghu */
     if (dmgtype(ptr, AD_MAGM) || ptr == &mons[PM_BABY_GRAY_DRAGON] ||
         dmgtype(ptr, AD_RBRE))  /* Chromatic Dragon */
         return TRUE;
-    /* check for magic resistance granted by wielded weapon */
-    o = (mon == &youmonst) ? uwep : MON_WEP(mon);
-    if (o && o->oartifact && defends(AD_MAGM, o))
-        return TRUE;
-    /* check for magic resistance granted by worn or carried items */
-    o = (mon == &youmonst) ? invent : mon->minvent;
-    for ( ; o; o = o->nobj)
-        if ((o->owornmask && objects[o->otyp].oc_oprop == ANTIMAGIC) ||
-            (o->oartifact && protects(AD_MAGM, o)))
-            return TRUE;
-    return FALSE;
+    /* check for magic resistance granted by wielded weapon or
+     * worn or carried items */
+    return (inv_props(mon) & INVP_ANTIMAGIC) != 0;
 }
 
 /* TRUE iff monster is resistant to light-induced blindness */
@@ -85,7 +113,6 @@ boolean resists_blnd(struct monst *mon)
 {
     const struct permonst *ptr = mon->data;
     boolean is_you = (mon == &youmonst);
-    struct obj *o;
 
     if (is_you ? (Blind || u.usleep) :
         (mon->mblinded || !mon->mcansee || !haseyes(ptr) ||
@@ -97,14 +124,8 @@ boolean resists_blnd(struct monst *mon)
     if (dmgtype_fromattack(ptr, AD_BLND, AT_EXPL) ||
         dmgtype_fromattack(ptr, AD_BLND, AT_GAZE))
         return TRUE;
-    o = is_you ? uwep : MON_WEP(mon);
-    if (o && o->oartifact && defends(AD_BLND, o))
-        return TRUE;
-    o = is_you ? invent : mon->minvent;
-    for ( ; o; o = o->nobj)
-        if (o->oartifact && protects(AD_BLND, o))
-            return TRUE;
-    return FALSE;
+    /* wielded or carried artifacts */
+    return (inv_props(mon) & INVP_BLND_RES) != 0;
 }
 
 /* TRUE iff monster can be blinded by the given attack */
@@ -116,8 +137,6 @@ boolean can_blnd(struct monst *magr,    /* NULL == no specific aggressor */
 {
     boolean is_you = (mdef == &youmonst);
     boolean check_visor = FALSE;
-    struct obj *o;
-    const char *s;
 
     /* no eyes protect against all attacks for now */
     if (!haseyes(mdef->data))
@@ -176,14 +195,8 @@ boolean can_blnd(struct monst *magr,    /* NULL == no specific aggressor */
     }
 
     /* check if wearing a visor (only checked if visor might help) */
-    if (check_visor) {
-        o = (mdef == &youmonst) ? invent : mdef->minvent;
-        for ( ; o; o = o->nobj)
-            if ((o->owornmask & W_ARMH) &&
-                (s = OBJ_DESCR(objects[o->otyp])) != NULL &&
-                !strcmp(s, "visored helmet"))
-                return FALSE;
-    }
+    if (check_visor && (inv_props(mdef) & INVP_VISOR))
+        return FALSE;
 
     return TRUE;
 }
@@ -323,18 +336,132 @@ const struct attack *dmgtype_fromattack(const struct permonst *ptr, int dtyp, in
 {
     const struct attack *a;
 
+    ATTK_COUNT(ATTK_FROMATTACK, ATTK_CALLS);
+    if (has_attk_masks(ptr) &&
+        (!(monattk_ad[ptr - mons] & AD_BIT(dtyp)) ||
+         (atyp != AT_ANY && !(monattk_at[ptr - mons] & AT_BIT(atyp)))))
+        return NULL;
+
+    ATTK_COUNT(ATTK_FROMATTACK, ATTK_WALKS);
     for (a = &ptr->mattk[0]; a < &ptr->mattk[NATTK]; a++)
-        if (a->adtyp == dtyp && (atyp == AT_ANY || a->aatyp == atyp))
+        if (a->adtyp == dtyp && (atyp == AT_ANY || a->aatyp == atyp)) {
+            ATTK_COUNT(ATTK_FROMATTACK, ATTK_HITS);
             return a;
+        }
 
     return NULL;
 }
 
 boolean dmgtype(const struct permonst *ptr, int dtyp)
 {
-    return dmgtype_fromattack(ptr, dtyp, AT_ANY) ? TRUE : FALSE;
+    boolean found;
+
+    ATTK_COUNT(ATTK_DMGTYPE, ATTK_CALLS);
+    if (has_attk_masks(ptr))
+        found = (monattk_ad[ptr - mons] & AD_BIT(dtyp)) != 0;
+    else {
+        ATTK_COUNT(ATTK_DMGTYPE, ATTK_WALKS);
+        found = dmgtype_fromattack(ptr, dtyp, AT_ANY) ? TRUE : FALSE;
+    }
+    if (found)
+        ATTK_COUNT(ATTK_DMGTYPE, ATTK_HITS);
+    return found;
+}
+
+
+/* the first attack of ptr with type atyp and damage dtyp, either of which
+ * may be a wildcard, found without the masks */
+static const struct attack *walk_attacks(const struct permonst *ptr,
+                                         int atyp, int dtyp)
+{
+    const struct attack *a;
+
+    for (a = &ptr->mattk[0]; a < &ptr->mattk[NATTK]; a++)
+        if ((atyp == AT_ANY || a->aatyp == atyp) &&
+            (dtyp == AD_ANY || a->adtyp == dtyp))
+            return a;
+    return NULL;
+}
+
+/*
+ * Compare the masks makedefs wrote to monstr.c with the attacks in mons[],
+ * and the answers of the lookups above with walk_attacks() for every attack
+ * and damage type that has a bit.  Returns the number of disagreements.
+ */
+int check_attk_masks(void)
+{
+    const struct permonst *ptr;
+    unsigned int at_mask;
+    unsigned long long ad_mask;
+    int i, at, ad, bad = 0;
+#ifdef ATTK_STATS
+    long saved_stats[ATTK_FNS][ATTK_COUNTS];
+
+    memcpy(saved_stats, attk_stats, sizeof(attk_stats));
+#endif
+
+    for (ptr = &mons[LOW_PM]; ptr < &mons[NUMMONS]; ptr++) {
+        at_mask = 0;
+        ad_mask = 0;
+        for (i = 0; i < NATTK; i++) {
+            at_mask |= AT_BIT(ptr->mattk[i].aatyp);
+            ad_mask |= AD_BIT(ptr->mattk[i].adtyp);
+        }
+        if (at_mask != monattk_at[ptr - mons] ||
+            ad_mask != monattk_ad[ptr - mons])
+            bad++;
+
+        for (at = AT_NONE; at <= AT_MAGC; at++) {
+            if (!AT_HAS_BIT(at))
+                continue;
+            if (attacktype(ptr, at) != !!walk_attacks(ptr, at, AD_ANY) ||
+                attacktype_fordmg(ptr, at, AD_ANY) != walk_attacks(ptr, at, AD_ANY))
+                bad++;
+            for (ad = AD_PHYS; ad <= AD_CURS; ad++) {
+                if (!AD_HAS_BIT(ad))
+                    continue;
+                if (attacktype_fordmg(ptr, at, ad) != walk_attacks(ptr, at, ad) ||
+                    dmgtype_fromattack(ptr, ad, at) != walk_attacks(ptr, at, ad))
+                    bad++;
+            }
+        }
+        for (ad = AD_PHYS; ad <= AD_CURS; ad++) {
+            if (!AD_HAS_BIT(ad))
+                continue;
+            if (dmgtype(ptr, ad) != !!walk_attacks(ptr, AT_ANY, ad) ||
+                dmgtype_fromattack(ptr, ad, AT_ANY) != walk_attacks(ptr, AT_ANY, ad))
+                bad++;
+        }
+    }
+
+#ifdef ATTK_STATS
+    memcpy(attk_stats, saved_stats, sizeof(attk_stats));
+#endif
+    return bad;
 }
 
+
+#ifdef ATTK_STATS
+/* add the counts collected since the game was started to menu */
+void list_attk_stats(struct menulist *menu)
+{
+    static const char *const names[ATTK_FNS] = {
+        "attacktype", "attacktype_fordmg", "dmgtype", "dmgtype_fromattack"
+    };
+    char buf[BUFSZ];
+    int i;
+
+    sprintf(buf, "%-18s %10s %10s %10s", "", "calls", "found", "walks");
+    add_menutext(menu, buf);
+    for (i = 0; i < ATTK_FNS; i++) {
+        sprintf(buf, "%-18s %10ld %10ld %10ld", names[i],
+                attk_stats[i][ATTK_CALLS], attk_stats[i][ATTK_HITS],
+                attk_stats[i][ATTK_WALKS]);
+        add_menutext(menu, buf);
+    }
+}
+#endif
+
 /* returns the maximum damage a defender can do to the attacker via
  * a passive defense */
 int max_passive_dmg(struct monst *mdef, struct monst *magr)
@@ -390,7 +517,45 @@ int monsndx(const struct permonst *ptr)
     return i;
 }
 
-int name_to_mon(const char *in_str)
+/*
+ * The monster names in mons[], indexed for name_to_mon().  The names are
+ * stored as they are in mons[]; what the player calls a monster may differ
+ * because of the shuffled dragon appearances, see unobfuscate_monster().
+ */
+static struct name_trie mon_names;
+
+static const struct name_trie *mon_name_trie(void)
+{
+    int i;
+
+    if (!mon_names.nnodes)
+        for (i = LOW_PM; i < NUMMONS; i++)
+            trie_add(&mon_names, mons[i].mname, NULL, i);
+    return &mon_names;
+}
+
+/* the monster that is displayed as mons[mndx], the reverse of
+ * obfuscate_monster() */
+static int unobfuscate_monster(int mndx)
+{
+    int i, first, last;
+
+    if (mndx >= PM_GRAY_DRAGON && mndx <= PM_YELLOW_DRAGON) {
+        first = PM_GRAY_DRAGON;
+        last = PM_YELLOW_DRAGON;
+    } else if (mndx >= PM_BABY_GRAY_DRAGON && mndx <= PM_BABY_YELLOW_DRAGON) {
+        first = PM_BABY_GRAY_DRAGON;
+        last = PM_BABY_YELLOW_DRAGON;
+    } else
+        return mndx;
+
+    for (i = first; i <= last; i++)
+        if (obfuscate_monster(i) == mndx)
+            return i;
+    return mndx;
+}
+
+static int name_to_mon_scan(const char *in_str, boolean linear)
 {
     /* Be careful.  We must check the entire string in case it was
      * something such as "ettin zombie corpse".  The calling routine
@@ -404,11 +569,12 @@ int name_to_mon(const char *in_str)
      * This also permits plurals created by adding suffixes such as 's'
      * or 'es'.  Other plurals must still be handled explicitly.
      */
-    int i;
+    int i, n, v;
     int mntmp = NON_PM;
     char *s, *str, *term;
     char buf[BUFSZ];
     int len, slen;
+    int lens[BUFSZ], vals[BUFSZ];
 
     str = strcpy(buf, in_str);
 
@@ -482,30 +648,72 @@ int name_to_mon(const char *in_str)
                 return namep->pm_val;
     }
 
-    for (len = 0, i = LOW_PM; i < NUMMONS; i++) {
-        int m_i_len = strlen(mons_mname(&mons[i]));
-        if (m_i_len > len && !strncmpi(mons_mname(&mons[i]), str, m_i_len)) {
-            if (m_i_len == slen) return i;  /* exact match */
-            else if (slen > m_i_len &&
-                     (str[m_i_len] == ' ' ||
-                      !strcmpi(&str[m_i_len], "s") ||
-                      !strncmpi(&str[m_i_len], "s ", 2) ||
-                      !strcmpi(&str[m_i_len], "'") ||
-                      !strncmpi(&str[m_i_len], "' ", 2) ||
-                      !strcmpi(&str[m_i_len], "'s") ||
-                      !strncmpi(&str[m_i_len], "'s ", 3) ||
-                      !strcmpi(&str[m_i_len], "es") ||
-                      !strncmpi(&str[m_i_len], "es ", 3))) {
-                mntmp = i;
-                len = m_i_len;
+    if (linear) {
+        /* the scan the trie replaced, kept for check_name_tries() */
+        for (len = 0, i = LOW_PM; i < NUMMONS; i++) {
+            int m_i_len = strlen(mons_mname(&mons[i]));
+            if (m_i_len > len && !strncmpi(mons_mname(&mons[i]), str, m_i_len)) {
+                if (m_i_len == slen) return i;  /* exact match */
+                else if (slen > m_i_len &&
+                         (str[m_i_len] == ' ' ||
+                          !strcmpi(&str[m_i_len], "s") ||
+                          !strncmpi(&str[m_i_len], "s ", 2) ||
+                          !strcmpi(&str[m_i_len], "'") ||
+                          !strncmpi(&str[m_i_len], "' ", 2) ||
+                          !strcmpi(&str[m_i_len], "'s") ||
+                          !strncmpi(&str[m_i_len], "'s ", 3) ||
+                          !strcmpi(&str[m_i_len], "es") ||
+                          !strncmpi(&str[m_i_len], "es ", 3))) {
+                    mntmp = i;
+                    len = m_i_len;
+                }
             }
         }
+        if (mntmp == NON_PM) mntmp = title_to_mon_linear(str, NULL, NULL);
+        return mntmp;
+    }
+
+    n = trie_prefixes(mon_name_trie(), str, lens, vals, BUFSZ);
+    for (; n > 0; n--) {
+        /* the longest name first; the lowest index wins among equal names */
+        int m_i_len = lens[n - 1];
+        for (i = NON_PM, v = vals[n - 1]; v >= 0; v = mon_names.vals[v].next) {
+            int j = unobfuscate_monster(mon_names.vals[v].value);
+            if (i == NON_PM || j < i)
+                i = j;
+        }
+        if (m_i_len == slen) return i;  /* exact match */
+        else if (str[m_i_len] == ' ' ||
+                 !strcmpi(&str[m_i_len], "s") ||
+                 !strncmpi(&str[m_i_len], "s ", 2) ||
+                 !strcmpi(&str[m_i_len], "'") ||
+                 !strncmpi(&str[m_i_len], "' ", 2) ||
+                 !strcmpi(&str[m_i_len], "'s") ||
+                 !strncmpi(&str[m_i_len], "'s ", 3) ||
+                 !strcmpi(&str[m_i_len], "es") ||
+                 !strncmpi(&str[m_i_len], "es ", 3)) {
+            mntmp = i;
+            break;
+        }
     }
     if (mntmp == NON_PM) mntmp = title_to_mon(str, NULL, NULL);
     return mntmp;
 }
 
 
+int name_to_mon(const char *in_str)
+{
+    return name_to_mon_scan(in_str, FALSE);
+}
+
+
+/* name_to_mon() comparing the input against every name in mons[] */
+int name_to_mon_linear(const char *in_str)
+{
+    return name_to_mon_scan(in_str, TRUE);
+}
+
+
 /* returns 3 values (0=male, 1=female, 2=none) */
 int gender(struct monst *mtmp)
 {
@@ -1804,8 +1804,13 @@ boolean searches_for_item(struct monst *mon, struct obj *obj)
 
 boolean mon_reflects(struct monst *mon, const char *str)
 {
-    struct obj *orefl = which_armor(mon, W_ARMS);
+    struct obj *orefl;
 
+    /* nothing worn or wielded reflects, so only the scales are left */
+    if (!(inv_props(mon) & INVP_REFLECT))
+        goto scales;
+
+    orefl = which_armor(mon, W_ARMS);
     if (orefl && (orefl->otyp == SHIELD_OF_REFLECTION ||
                   (orefl->oprops & ITEM_REFLECTION))) {
         if (str) {
@@ -1874,10 +1879,12 @@ boolean mon_reflects(struct monst *mon, const char *str)
                 orefl->oprops_known |= ITEM_REFLECTION;
         }
         return TRUE;
+    }
 
-    } else if (mon->data == &mons[PM_SILVER_DRAGON] ||
-               mon->data == &mons[PM_CHROMATIC_DRAGON] ||
-               mon->data == &mons[PM_TIAMAT]) {
+scales:
+    if (mon->data == &mons[PM_SILVER_DRAGON] ||
+        mon->data == &mons[PM_CHROMATIC_DRAGON] ||
+        mon->data == &mons[PM_TIAMAT]) {
         /* Silver dragons only reflect when mature; babies do not */
         if (str)
             pline(str, s_suffix(mon_nam(mon)), "scales");
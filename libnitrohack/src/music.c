@@ -41,10 +41,12 @@ static int do_improvisation(struct obj *);
 
 static void awaken_monsters(int distance)
 {
-    struct monst *mtmp = level->monlist;
-    int distm;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int distm, i, n;
 
-    while (mtmp) {
+    n = monsters_within(level, u.ux, u.uy, distance, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
         if (!DEADMONSTER(mtmp)) {
             distm = distu(mtmp->mx, mtmp->my);
             if (distm < distance) {
@@ -57,7 +59,6 @@ static void awaken_monsters(int distance)
                     monflee(mtmp, 0, FALSE, TRUE);
             }
         }
-        mtmp = mtmp->nmon;
     }
 }
 
@@ -67,15 +68,17 @@ static void awaken_monsters(int distance)
 
 static void put_monsters_to_sleep(int distance)
 {
-    struct monst *mtmp = level->monlist;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int i, n;
 
-    while (mtmp) {
+    n = monsters_within(level, u.ux, u.uy, distance, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
         if (!DEADMONSTER(mtmp) && distu(mtmp->mx, mtmp->my) < distance &&
             sleep_monst(mtmp, dice(10,10), TOOL_CLASS)) {
             mtmp->msleeping = 1; /* 10d10 turns + wake_nearby to rouse */
             slept_monst(mtmp);
         }
-        mtmp = mtmp->nmon;
     }
 }
 
@@ -84,10 +87,13 @@ static void put_monsters_to_sleep(int distance)
  */
 static void charm_snakes(int distance)
 {
-    struct monst *mtmp = level->monlist;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
     int could_see_mon, was_peaceful;
+    int i, n;
 
-    while (mtmp) {
+    n = monsters_within(level, u.ux, u.uy, distance, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
         if (!DEADMONSTER(mtmp) && mtmp->data->mlet == S_SNAKE && mtmp->mcanmove &&
             distu(mtmp->mx, mtmp->my) < distance) {
             was_peaceful = mtmp->mpeaceful;
@@ -106,7 +112,6 @@ static void charm_snakes(int distance)
                           was_peaceful ? "" : ", and now seems quieter");
             }
         }
-        mtmp = mtmp->nmon;
     }
 }
 
@@ -115,9 +120,12 @@ static void charm_snakes(int distance)
  */
 static void calm_nymphs(int distance)
 {
-    struct monst *mtmp = level->monlist;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int i, n;
 
-    while (mtmp) {
+    n = monsters_within(level, u.ux, u.uy, distance, list);
+    for (i = 0; i < n; i++) {
+        mtmp = list[i];
         if (!DEADMONSTER(mtmp) && mtmp->data->mlet == S_NYMPH && mtmp->mcanmove &&
             distu(mtmp->mx, mtmp->my) < distance) {
             mtmp->msleeping = 0;
@@ -128,7 +136,6 @@ static void calm_nymphs(int distance)
                       "%s listens cheerfully to the music, then seems quieter.",
                       Monnam(mtmp));
         }
-        mtmp = mtmp->nmon;
     }
 }
 
@@ -156,14 +163,16 @@ void awaken_soldiers(void)
  */
 static void charm_monsters(int distance)
 {
-    struct monst *mtmp, *mtmp2;
+    struct monst *mtmp, *list[MONS_IN_RANGE_MAX];
+    int i, n;
 
     if (u.uswallow) {
         if (!resist(u.ustuck, TOOL_CLASS, 0, NOTELL))
             tamedog(u.ustuck, NULL);
     } else {
-        for (mtmp = level->monlist; mtmp; mtmp = mtmp2) {
-            mtmp2 = mtmp->nmon;
+        n = monsters_within(level, u.ux, u.uy, distance + 1, list);
+        for (i = 0; i < n; i++) {
+            mtmp = list[i];
             if (DEADMONSTER(mtmp)) continue;
 
             if (distu(mtmp->mx, mtmp->my) <= distance) {
@@ -0,0 +1,348 @@
+/* DynaHack may be freely redistributed.  See license for details. */
+
+/*
+ * Case-insensitive tries for looking up names.
+ *
+ * Wishes, polymorph control and the like turn a name typed by the player into
+ * a monster or object.  Instead of comparing the input against every name in
+ * mons[], obj_descr[] or the rank titles, the names are put into a trie once,
+ * so that looking one up only takes as many steps as the input is long.
+ *
+ * Any number of values can be stored under the same key; they are kept in the
+ * order they were added.  Characters listed in the ignore string given to
+ * trie_add() and trie_find() are skipped, so that "pick-axe", "pick axe" and
+ * "pickaxe" can share a key, the way fuzzymatch() treats them.
+ *
+ * Every node stores its first child and its next sibling, which keeps the
+ * trie small; a name lookup visits at most a few dozen siblings per level.
+ */
+
+#include "hack.h"
+
+
+static int trie_new_node(struct name_trie *t, char c)
+{
+    struct trie_node *n;
+
+    if (t->nnodes == t->maxnodes) {
+        t->maxnodes = t->maxnodes ? t->maxnodes * 2 : 256;
+        t->nodes = realloc(t->nodes, t->maxnodes * sizeof(struct trie_node));
+    }
+    n = &t->nodes[t->nnodes];
+    n->c = c;
+    n->child = n->sibling = n->vals = -1;
+    return t->nnodes++;
+}
+
+
+/* find the child of node for c, optionally adding it */
+static int trie_child(struct name_trie *t, int node, char c, boolean create)
+{
+    int n, last = -1;
+
+    for (n = t->nodes[node].child; n >= 0; n = t->nodes[n].sibling) {
+        if (t->nodes[n].c == c)
+            return n;
+        last = n;
+    }
+    if (!create)
+        return -1;
+
+    n = trie_new_node(t, c);
+    if (last >= 0)
+        t->nodes[last].sibling = n;
+    else
+        t->nodes[node].child = n;
+    return n;
+}
+
+
+void trie_add(struct name_trie *t, const char *key, const char *ignore,
+              int value)
+{
+    int node, v, *vp;
+
+    if (!t->nnodes)
+        trie_new_node(t, '\0');     /* the root */
+
+    for (node = 0; *key; key++)
+        if (!ignore || !strchr(ignore, *key))
+            node = trie_child(t, node, lowc(*key), TRUE);
+
+    if (t->nvals == t->maxvals) {
+        t->maxvals = t->maxvals ? t->maxvals * 2 : 256;
+        t->vals = realloc(t->vals, t->maxvals * sizeof(struct trie_val));
+    }
+    v = t->nvals++;
+    t->vals[v].value = value;
+    t->vals[v].next = -1;
+
+    /* append, so that values come back in the order they were added */
+    for (vp = &t->nodes[node].vals; *vp >= 0; vp = &t->vals[*vp].next)
+        ;
+    *vp = v;
+}
+
+
+/*
+ * Returns the index of the first value stored for key in t->vals, or -1.
+ * The others follow through t->vals[i].next.
+ */
+int trie_find(const struct name_trie *t, const char *key, const char *ignore)
+{
+    int node = 0;
+
+    if (!t->nnodes)
+        return -1;
+
+    for (; *key && node >= 0; key++)
+        if (!ignore || !strchr(ignore, *key))
+            node = trie_child((struct name_trie *)t, node, lowc(*key), FALSE);
+
+    return node >= 0 ? t->nodes[node].vals : -1;
+}
+
+
+/*
+ * Find all keys that str starts with, shortest first.  For each of them,
+ * the length of the key in str and the index of its first value are stored
+ * in lens[] and vals[].  Returns the number of keys found, at most max.
+ */
+int trie_prefixes(const struct name_trie *t, const char *str, int *lens,
+                  int *vals, int max)
+{
+    int node = 0, len = 0, n = 0;
+
+    if (!t->nnodes)
+        return 0;
+
+    while (n < max) {
+        if (len && t->nodes[node].vals >= 0) {
+            lens[n] = len;
+            vals[n] = t->nodes[node].vals;
+            n++;
+        }
+        if (!str[len])
+            break;
+        node = trie_child((struct name_trie *)t, node, lowc(str[len]), FALSE);
+        if (node < 0)
+            break;
+        len++;
+    }
+    return n;
+}
+
+
+void trie_free(struct name_trie *t)
+{
+    free(t->nodes);
+    free(t->vals);
+    memset(t, 0, sizeof(struct name_trie));
+}
+
+
+/*
+ * Checking the tries against the linear scans they replaced.
+ *
+ * check_name_tries() makes up names from mons[], the rank titles and
+ * obj_descr[], mangles them the ways players do and makes sure that
+ * name_to_mon() and title_to_mon() give the same answers as
+ * name_to_mon_linear() and title_to_mon_linear(), and that the wish index
+ * never skips an object that wishymatch() would accept.  It has its own
+ * random number generator so that the game's is left alone.
+ */
+
+static unsigned long fuzz_seed;
+
+static int fuzz_rn2(int x)
+{
+    fuzz_seed = fuzz_seed * 1103515245UL + 12345UL;
+    return (int)((fuzz_seed >> 16) % (unsigned long)x);
+}
+
+
+static const char *fuzz_name(void)
+{
+    static const char *const junk[] = {
+        "of", "s", "es", "'s", "ies", "ves", "vortices", "corpse", "a", "an",
+        "grey", "gray", "baby", "dwarven", "elfin", "aluminium", "bear trap",
+        "x", "",
+    };
+    const char *name = NULL;
+    int i, j, nroles;
+
+    for (nroles = 0; roles[nroles].name.m; nroles++)
+        ;
+
+    while (!name) {
+        switch (fuzz_rn2(5)) {
+        case 0:
+            name = mons[LOW_PM + fuzz_rn2(NUMMONS - LOW_PM)].mname;
+            break;
+        case 1:
+            i = fuzz_rn2(nroles);
+            j = fuzz_rn2(9);
+            name = fuzz_rn2(2) ? roles[i].rank[j].f : roles[i].rank[j].m;
+            break;
+        case 2:
+            name = obj_descr[fuzz_rn2(NUM_OBJECTS)].oc_name;
+            break;
+        case 3:
+            name = obj_descr[fuzz_rn2(NUM_OBJECTS)].oc_descr;
+            break;
+        default:
+            name = junk[fuzz_rn2(SIZE(junk))];
+            break;
+        }
+    }
+    return name;
+}
+
+
+/* replace the first occurrence of from in buf by to */
+static void fuzz_subst(char *buf, const char *from, const char *to)
+{
+    char tmp[BUFSZ];
+    char *p = strstri(buf, from);
+
+    if (p && strlen(buf) + strlen(to) < BUFSZ / 2) {
+        strcpy(tmp, p + strlen(from));
+        strcpy(p, to);
+        strcat(p, tmp);
+    }
+}
+
+
+/* change buf in one of the ways a player might misspell a name */
+static void fuzz_mutate(char *buf)
+{
+    static const char *const prefixes[] = {
+        "a ", "an ", "dwarvish ", "dwarven ", "elven ", "elvish ", "elfin ",
+        "aluminum", "aluminium", "beartrap", "bear trap", "bear-trap",
+        "beartrap ", "grey ", "baby grey ", "blessed ", "2 ",
+    };
+    static const char *const suffixes[] = {
+        "s", "es", "'", "'s", "' ", "'s ", "s ", "es ", " ", " corpse",
+        "ies", "ves", "vortices", " of ", " of ", " wand", "-", " x",
+    };
+    static const char *const swaps[][2] = {
+        {"dwarvish ", "dwarven "}, {"elven ", "elvish "}, {"elven ", "elfin "},
+        {"aluminum", "aluminium"}, {"gray", "grey"}, {"grey", "gray"},
+        {"beartrap", "bear trap"}, {"beartrap", "BEAR-TRAP"}, {" ", ""},
+        {" ", "-"}, {"-", " "}, {"-", ""}, {"y", "ies"}, {"f", "ves"},
+        {"ex", "ices"}, {"us", "i"},
+    };
+    char tmp[BUFSZ];
+    const char *of;
+    char *p;
+    int len = strlen(buf), i;
+
+    if (len > BUFSZ / 4) {
+        buf[fuzz_rn2(len)] = '\0';
+        return;
+    }
+
+    switch (fuzz_rn2(9)) {
+    case 0:     /* change the case of one letter */
+        if (len) {
+            i = fuzz_rn2(len);
+            buf[i] = (buf[i] == lowc(buf[i])) ? highc(buf[i]) : lowc(buf[i]);
+        }
+        break;
+    case 1:     /* add a space or a hyphen */
+        i = fuzz_rn2(len + 1);
+        memmove(buf + i + 1, buf + i, len - i + 1);
+        buf[i] = fuzz_rn2(2) ? ' ' : '-';
+        break;
+    case 2:     /* drop a character */
+        if (len) {
+            i = fuzz_rn2(len);
+            memmove(buf + i, buf + i + 1, len - i);
+        }
+        break;
+    case 3:     /* "foo of bar" <-> "bar foo" */
+        if ((of = strstri(buf, " of ")) != 0) {
+            strcpy(tmp, of + 4);
+            p = eos(strcat(tmp, " "));
+            strncpy(p, buf, of - buf);
+            p[of - buf] = '\0';
+        } else if ((p = strrchr(buf, ' ')) != 0) {
+            sprintf(tmp, "%s of ", p + 1);
+            strncat(tmp, buf, p - buf);
+        } else
+            break;
+        strcpy(buf, tmp);
+        break;
+    case 4:
+        strcpy(tmp, buf);
+        strcpy(buf, prefixes[fuzz_rn2(SIZE(prefixes))]);
+        strcat(buf, tmp);
+        break;
+    case 5:
+        strcat(buf, suffixes[fuzz_rn2(SIZE(suffixes))]);
+        break;
+    case 6:
+        i = fuzz_rn2(SIZE(swaps));
+        fuzz_subst(buf, swaps[i][0], swaps[i][1]);
+        break;
+    case 7:     /* cut it short */
+        buf[fuzz_rn2(len + 1)] = '\0';
+        break;
+    default:    /* run two names together */
+        strcat(buf, fuzz_rn2(2) ? " " : "");
+        strcat(buf, fuzz_name());
+        break;
+    }
+}
+
+
+/* check one name; returns TRUE if all the lookups agree */
+static boolean check_one_name(const char *str)
+{
+    int rank1 = -1, rank2 = -1, len1 = -1, len2 = -1;
+    boolean save_wizard = wizard, ok = TRUE;
+
+    if (name_to_mon(str) != name_to_mon_linear(str))
+        ok = FALSE;
+    if (title_to_mon(str, &rank1, &len1) !=
+        title_to_mon_linear(str, &rank2, &len2) ||
+        rank1 != rank2 || len1 != len2)
+        ok = FALSE;
+
+    /* wishymatch() treats "beartrap" differently for wizards */
+    wizard = FALSE;
+    if (wish_index_misses(str))
+        ok = FALSE;
+    wizard = TRUE;
+    if (wish_index_misses(str))
+        ok = FALSE;
+    wizard = save_wizard;
+
+    return ok;
+}
+
+
+/*
+ * Look up count made-up names.  Returns the number that were looked up
+ * differently and copies the first of them to badname.
+ */
+int check_name_tries(unsigned long seed, int count, char *badname)
+{
+    char buf[BUFSZ];
+    int i, n, bad = 0;
+
+    fuzz_seed = seed;
+    badname[0] = '\0';
+    for (i = 0; i < count; i++) {
+        strcpy(buf, fuzz_name());
+        for (n = fuzz_rn2(5); n > 0; n--)
+            fuzz_mutate(buf);
+        if (!check_one_name(buf)) {
+            if (!bad++)
+                strcpy(badname, buf);
+        }
+    }
+    return bad;
+}
+
+/*nametrie.c*/
@@ -9,6 +9,25 @@ static void shuffle(int,int,boolean);
 static void shuffle_all(void);
 static boolean interesting_to_discover(int);
 static void swap_armor(int,int,int);
+static void build_class_table(int oclass);
+
+/*
+ * Alias tables (see alias.c) for picking a random object type by oc_prob,
+ * either out of a whole class (rnd_otyp) or out of a range of objects
+ * (rnd_otyp_range, for rnd_class).  They are rebuilt whenever oc_prob
+ * changes: after init_objects() and restnames(), and for gems whenever
+ * setgemprobs() adjusts them to a new level.  Only games with an RNG
+ * revision of at least RNGREV_ALIAS_OBJS select objects this way.
+ */
+#define RANGE_TABLES 16
+
+static struct alias_table class_tables[MAXOCLASSES];
+static struct range_table {
+    int first, last;
+    unsigned int generation, lastuse;
+    struct alias_table at;
+} range_tables[RANGE_TABLES];
+static unsigned int objprob_generation, range_clock;
 
 
 static void setgemprobs(const d_level *dlev)
@@ -32,6 +51,85 @@ static void setgemprobs(const d_level *dlev)
     }
     for (j = first; j <= LAST_GEM; j++)
         objects[j].oc_prob = (171+j-first)/(LAST_GEM+1-first);
+
+    build_class_table(GEM_CLASS);
+}
+
+
+/* oc_prob of some objects in oclass changed */
+static void build_class_table(int oclass)
+{
+    int first = bases[oclass], last;
+    int weight[NUM_OBJECTS];
+
+    objprob_generation++;   /* all range tables are out of date */
+
+    for (last = first;
+         last < NUM_OBJECTS && objects[last].oc_class == oclass; last++)
+        weight[last - first] = objects[last].oc_prob;
+    alias_build(&class_tables[oclass], weight, last - first);
+}
+
+
+static void init_object_tables(void)
+{
+    int oclass;
+
+    for (oclass = 1; oclass < MAXOCLASSES; oclass++)
+        build_class_table(oclass);
+}
+
+
+void free_object_tables(void)
+{
+    int i;
+
+    for (i = 0; i < MAXOCLASSES; i++)
+        alias_free(&class_tables[i]);
+    for (i = 0; i < RANGE_TABLES; i++)
+        alias_free(&range_tables[i].at);
+    memset(range_tables, 0, sizeof(range_tables));
+}
+
+
+/* random object type of a class, weighted by oc_prob; -1 if none of them
+ * can be generated */
+int rnd_otyp(char oclass)
+{
+    int i = alias_select(&class_tables[(int)oclass]);
+
+    return (i < 0) ? -1 : bases[(int)oclass] + i;
+}
+
+
+/* random object type from first to last, weighted by oc_prob; -1 if all of
+ * them have a probability of 0 */
+int rnd_otyp_range(int first, int last)
+{
+    struct range_table *t, *oldest = range_tables;
+    int weight[NUM_OBJECTS];
+    int i;
+
+    for (t = range_tables; t < range_tables + RANGE_TABLES; t++) {
+        if (t->first == first && t->last == last &&
+            t->generation == objprob_generation)
+            break;
+        if (t->lastuse < oldest->lastuse)
+            oldest = t;
+    }
+    if (t == range_tables + RANGE_TABLES) {
+        t = oldest;
+        for (i = first; i <= last; i++)
+            weight[i - first] = objects[i].oc_prob;
+        alias_build(&t->at, weight, last - first + 1);
+        t->first = first;
+        t->last = last;
+        t->generation = objprob_generation;
+    }
+    t->lastuse = ++range_clock;
+
+    i = alias_select(&t->at);
+    return (i < 0) ? -1 : first + i;
 }
 
 /* shuffle descriptions on objects o_low to o_high */
@@ -133,6 +231,7 @@ void init_objects(void)
     }
     /* shuffle descriptions */
     shuffle_all();
+    init_object_tables();
 }
 
 static void shuffle_all(void)
@@ -393,6 +492,8 @@ void restnames(struct memfile *mf)
 
     for (i = 0; i < NUM_OBJECTS; i++)
         restobjclass(mf, &objects[i]);
+
+    init_object_tables();
 }
 
 
@@ -2,6 +2,7 @@
 /* DynaHack may be freely redistributed.  See license for details. */
 
 #include "hack.h"
+#include "patchlevel.h"
 
 /* Summary of all NetHack's object naming functions:
    obj_typename(otyp): entry in discovery list, from player's point of view
@@ -69,6 +70,7 @@
 #define NUMOBUF 12
 
 static char *strprepend(char *,const char *);
+static void invert_of(char *, const char *, const char *);
 static boolean wishymatch(const char *,const char *,boolean);
 static char *nextobuf(void);
 static void add_erosion_words(const struct obj *obj, char *, boolean);
@@ -2069,6 +2071,17 @@ char *makesingular(const char *oldstr)
     return bp;
 }
 
+/* turn "foo of bar" into "bar foo"; of points to " of " in str */
+static void invert_of(char *buf, const char *str, const char *of)
+{
+    char *p;
+
+    strcpy(buf, of + 4);
+    p = eos(strcat(buf, " "));
+    while (str < of) *p++ = *str++;
+    *p = '\0';
+}
+
 /* compare user string against object name string using fuzzy matching */
 static boolean wishymatch(const char *u_str,    /* from user, so might be variant spelling */
                           const char *o_str,    /* from objects[], so is in canonical form */
@@ -2086,23 +2099,17 @@ static boolean wishymatch(const char *u_str,    /* from user, so might be varian
 
     if (retry_inverted) {
         const char *u_of, *o_of;
-        char *p, buf[BUFSZ];
+        char buf[BUFSZ];
 
         /* when just one of the strings is in the form "foo of bar",
            convert it into "bar foo" and perform another comparison */
         u_of = strstri(u_str, " of ");
         o_of = strstri(o_str, " of ");
         if (u_of && !o_of) {
-            strcpy(buf, u_of + 4);
-            p = eos(strcat(buf, " "));
-            while (u_str < u_of) *p++ = *u_str++;
-            *p = '\0';
+            invert_of(buf, u_str, u_of);
             return fuzzymatch(buf, o_str, " -", TRUE);
         } else if (o_of && !u_of) {
-            strcpy(buf, o_of + 4);
-            p = eos(strcat(buf, " "));
-            while (o_str < o_of) *p++ = *o_str++;
-            *p = '\0';
+            invert_of(buf, o_str, o_of);
             return fuzzymatch(u_str, buf, " -", TRUE);
         }
     }
@@ -2189,6 +2196,93 @@ static const struct alt_spellings {
                  { NULL, 0 },
 };
 
+/*
+ * Index of the object names and descriptions in obj_descr[], so that
+ * readobjnam() only needs to call wishymatch() for the few objects whose
+ * name could possibly match, instead of for all of them.
+ *
+ * Names are stored the way fuzzymatch() compares them, ignoring case,
+ * spaces and hyphens; names of the form "foo of bar" are stored as
+ * "bar foo" as well.  wishymatch() accepts a few more spellings for
+ * names starting with "dwarvish" or "elven" and for "aluminum" and
+ * "beartrap", so those are always checked.
+ */
+static struct name_trie wish_names, wish_descrs;
+static boolean wish_always[NUM_OBJECTS];
+
+static void init_wish_index(void)
+{
+    char buf[BUFSZ];
+    const char *zn, *of;
+    int i;
+
+    for (i = 0; i < NUM_OBJECTS; i++) {
+        if ((zn = obj_descr[i].oc_name) != 0) {
+            trie_add(&wish_names, zn, " -", i);
+            if ((of = strstri(zn, " of ")) != 0) {
+                invert_of(buf, zn, of);
+                trie_add(&wish_names, buf, " -", i);
+            }
+            if (!strncmp(zn, "dwarvish ", 9) || !strncmp(zn, "elven ", 6) ||
+                !strcmp(zn, "aluminum") || !strcmp(zn, "beartrap"))
+                wish_always[i] = TRUE;
+        }
+        if ((zn = obj_descr[i].oc_descr) != 0) {
+            trie_add(&wish_descrs, zn, " -", i);
+            if (!strncmp(zn, "dwarvish ", 9) || !strncmp(zn, "elven ", 6) ||
+                !strcmp(zn, "aluminum") || !strcmp(zn, "beartrap"))
+                wish_always[i] = TRUE;
+        }
+    }
+}
+
+/* set marks[] for all entries in obj_descr[] that str might name */
+static void mark_wish_candidates(const struct name_trie *t, const char *str,
+                                 boolean retry_inverted, boolean *marks)
+{
+    char buf[BUFSZ];
+    const char *of;
+    int v;
+
+    memcpy(marks, wish_always, sizeof(wish_always));
+    for (v = trie_find(t, str, " -"); v >= 0; v = t->vals[v].next)
+        marks[t->vals[v].value] = TRUE;
+    if (retry_inverted && (of = strstri(str, " of ")) != 0) {
+        invert_of(buf, str, of);
+        for (v = trie_find(t, buf, " -"); v >= 0; v = t->vals[v].next)
+            marks[t->vals[v].value] = TRUE;
+    }
+}
+
+/*
+ * Count the entries in obj_descr[] that wishymatch() accepts for str but that
+ * the index would have skipped, both as a name and as a description.  Used
+ * by check_name_tries(); the answer should always be 0.
+ */
+int wish_index_misses(const char *str)
+{
+    boolean marks[NUM_OBJECTS];
+    const char *zn;
+    int i, misses = 0;
+
+    if (!wish_names.nnodes)
+        init_wish_index();
+
+    mark_wish_candidates(&wish_names, str, TRUE, marks);
+    for (i = 0; i < NUM_OBJECTS; i++)
+        if (!marks[i] && (zn = obj_descr[i].oc_name) != 0 &&
+            (wishymatch(str, zn, TRUE) || !strcmpi(str, zn)))
+            misses++;
+
+    mark_wish_candidates(&wish_descrs, str, FALSE, marks);
+    for (i = 0; i < NUM_OBJECTS; i++)
+        if (!marks[i] && (zn = obj_descr[i].oc_descr) != 0 &&
+            wishymatch(str, zn, FALSE))
+            misses++;
+
+    return misses;
+}
+
 /*
  * Return something wished for.  Specifying a null pointer for
  * the user request string results in a random object.  Otherwise,
@@ -2238,6 +2332,8 @@ struct obj *readobjnam(char *bp, struct obj *no_wish, boolean from_user)
 
     /* true if object has been found by its actual name */
     boolean found_by_actualn = FALSE;
+    /* objects whose name or description might match, see init_wish_index() */
+    boolean name_marks[NUM_OBJECTS], descr_marks[NUM_OBJECTS];
 
     cnt = spe = spesgn = typ = very = rechrg =
         blessed = uncursed = iscursed = isdrained = halfdrained =
@@ -2755,12 +2851,20 @@ struct obj *readobjnam(char *bp, struct obj *no_wish, boolean from_user)
     actualn = bp;
     if (!dn) dn = actualn; /* ex. "skull cap" */
  srch:
+    if (!wish_names.nnodes)
+        init_wish_index();
+    if (actualn)
+        mark_wish_candidates(&wish_names, actualn, TRUE, name_marks);
+    if (dn)
+        mark_wish_candidates(&wish_descrs, dn, FALSE, descr_marks);
+
     /* check real names of gems first */
     if (!oclass && actualn) {
         for (i = bases[GEM_CLASS]; i <= LAST_GEM; i++) {
             const char *zn;
 
-            if ((zn = OBJ_NAME(objects[i])) && !strcmpi(actualn, zn)) {
+            if (name_marks[objects[i].oc_name_idx] &&
+                (zn = OBJ_NAME(objects[i])) && !strcmpi(actualn, zn)) {
                 typ = i;
                 goto typfnd;
             }
@@ -2770,13 +2874,15 @@ struct obj *readobjnam(char *bp, struct obj *no_wish, boolean from_user)
     while (i < NUM_OBJECTS && (!oclass || objects[i].oc_class == oclass)){
         const char *zn;
 
-        if (actualn && (zn = OBJ_NAME(objects[i])) != 0 &&
+        if (actualn && name_marks[objects[i].oc_name_idx] &&
+            (zn = OBJ_NAME(objects[i])) != 0 &&
             wishymatch(actualn, zn, TRUE)) {
             typ = i;
             found_by_actualn = TRUE;
             goto typfnd;
         }
-        if (dn && (zn = OBJ_DESCR(objects[i])) != 0 &&
+        if (dn && descr_marks[objects[i].oc_descr_idx] &&
+            (zn = OBJ_DESCR(objects[i])) != 0 &&
             wishymatch(dn, zn, FALSE)) {
             /* don't match extra descriptions (w/o real name) */
             if (!OBJ_NAME(objects[i])) return NULL;
@@ -3345,6 +3451,10 @@ int rnd_class(int first, int last)
 
     if (first == last)
         return first;
+    if (iflags.rng_revision >= RNGREV_ALIAS_OBJS) {
+        i = rnd_otyp_range(first, last);
+        return (i >= 0) ? i : first + rn2(last-first+1);
+    }
     for (i=first; i<=last; i++)
         sum += objects[i].oc_prob;
     if (!sum) /* all zero */
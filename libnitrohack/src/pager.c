@@ -882,6 +882,144 @@ static void mondesc_all(struct menulist *menu, const struct permonst *pm)
 }
 
 
+/*
+ * The names in the "data" file, read in once on the first lookup; see
+ * do_data() in makedefs for the format.  Names with wildcards come first,
+ * followed by all other names in sorted order.
+ */
+struct dbase_key {
+    char *name;
+    int keyno;      /* position of the name in data.base */
+    int entry;      /* names sharing the same text have the same entry */
+    long offset;    /* of the text, relative to dbase.txt_offset */
+    int count;      /* number of lines of text */
+    boolean skip;   /* the name began with '~' */
+};
+
+static struct {
+    boolean loaded;
+    long txt_offset;
+    int nkeys, nwild;
+    struct dbase_key *keys;
+} dbase;
+
+
+static boolean load_dbase(void)
+{
+    dlb *fp;
+    char buf[BUFSZ], *tab;
+    struct dbase_key *key;
+    int i;
+
+    if (dbase.loaded)
+        return TRUE;
+
+    fp = dlb_fopen(DATAFILE, "r");
+    if (!fp) {
+        pline("Cannot open data file!");
+        return FALSE;
+    }
+
+    /* skip first record; read second */
+    if (!dlb_fgets(buf, BUFSZ, fp) || !dlb_fgets(buf, BUFSZ, fp)) {
+        impossible("can't read 'data' file");
+        dlb_fclose(fp);
+        return FALSE;
+    }
+    if (sscanf(buf, "%8lx\n", &dbase.txt_offset) < 1 || dbase.txt_offset <= 0 ||
+        !dlb_fgets(buf, BUFSZ, fp) ||
+        sscanf(buf, "%d,%d\n", &dbase.nkeys, &dbase.nwild) < 2 ||
+        dbase.nkeys < 0 || dbase.nwild < 0 || dbase.nwild > dbase.nkeys)
+        goto bad_data_file;
+
+    dbase.keys = malloc(dbase.nkeys * sizeof(struct dbase_key));
+    for (i = 0; i < dbase.nkeys; i++) {
+        key = &dbase.keys[i];
+        if (!dlb_fgets(buf, BUFSZ, fp) || !(tab = strchr(buf, '\t')) ||
+            sscanf(tab + 1, "%d,%d,%ld,%d\n", &key->keyno, &key->entry,
+                   &key->offset, &key->count) < 4) {
+            while (--i >= 0)
+                free(dbase.keys[i].name);
+            free(dbase.keys);
+            dbase.keys = NULL;
+            goto bad_data_file;
+        }
+        *tab = '\0';
+        key->skip = (*buf == '~');
+        key->name = strdup(&buf[key->skip ? 1 : 0]);
+    }
+
+    dlb_fclose(fp);
+    dbase.loaded = TRUE;
+    return TRUE;
+
+bad_data_file:
+    impossible("'data' file in wrong format");
+    dlb_fclose(fp);
+    return FALSE;
+}
+
+
+/* the first name in data.base for an entry after min_entry that matches
+ * str or alt */
+static const struct dbase_key *dbase_first_match(const char *str,
+                                                 const char *alt,
+                                                 int min_entry)
+{
+    const struct dbase_key *best = NULL, *key;
+    const char *strs[2];
+    int i, lo, hi, mid, s;
+
+    strs[0] = str;
+    strs[1] = alt;
+
+    for (i = 0; i < dbase.nwild; i++) {
+        key = &dbase.keys[i];
+        if (key->entry > min_entry &&
+            (pmatch(key->name, str) || (alt && pmatch(key->name, alt)))) {
+            best = key;     /* wildcard names are in data.base order */
+            break;
+        }
+    }
+
+    /* names without wildcards only match if they're equal */
+    for (s = 0; s < 2 && strs[s]; s++) {
+        lo = dbase.nwild;
+        hi = dbase.nkeys;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (strcmp(dbase.keys[mid].name, strs[s]) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (; lo < dbase.nkeys && !strcmp(dbase.keys[lo].name, strs[s]); lo++) {
+            key = &dbase.keys[lo];
+            if (key->entry > min_entry && (!best || key->keyno < best->keyno))
+                best = key;
+        }
+    }
+
+    return best;
+}
+
+
+/*
+ * Find the entry for str or alt.  Its names are checked in the order of
+ * data.base; if a name beginning with "~" matches before any other, that
+ * whole entry is skipped.
+ */
+static const struct dbase_key *dbase_lookup(const char *str, const char *alt)
+{
+    const struct dbase_key *key;
+    int min_entry = -1;
+
+    while ((key = dbase_first_match(str, alt, min_entry)) && key->skip)
+        min_entry = key->entry;
+    return key;
+}
+
+
 /*
  * Look in the "data" file for more info.  Called if the user typed in the
  * whole name (user_typed_name == TRUE), or we've found a possible match
@@ -893,18 +1031,13 @@ static void checkfile(const char *inp, struct permonst *pm, boolean user_typed_n
     dlb *fp;
     char buf[BUFSZ], newstr[BUFSZ];
     char *ep, *dbase_str;
-    long txt_offset;
-    int chk_skip;
-    boolean found_in_file = FALSE, skipping_entry = FALSE;
+    const struct dbase_key *found_in_file = NULL;
     int mntmp;
     char mnname[BUFSZ];
     struct menulist menu;
 
-    fp = dlb_fopen(DATAFILE, "r");
-    if (!fp) {
-        pline("Cannot open data file!");
+    if (!load_dbase())
         return;
-    }
 
     if (user_typed_name)
         pline("Looking up \"%s\"...", inp);
@@ -967,39 +1100,7 @@ static void checkfile(const char *inp, struct permonst *pm, boolean user_typed_n
             if (user_typed_name)
                 lcase(alt);
 
-        /* skip first record; read second */
-        txt_offset = 0L;
-        if (!dlb_fgets(buf, BUFSZ, fp) || !dlb_fgets(buf, BUFSZ, fp)) {
-            impossible("can't read 'data' file");
-            dlb_fclose(fp);
-            return;
-        } else if (sscanf(buf, "%8lx\n", &txt_offset) < 1 || txt_offset <= 0)
-            goto bad_data_file;
-
-        /* look for the appropriate entry */
-        while (dlb_fgets(buf,BUFSZ,fp)) {
-            if (*buf == '.') break;  /* we passed last entry without success */
-
-            if (digit(*buf)) {
-                /* a number indicates the end of current entry */
-                skipping_entry = FALSE;
-            } else if (!skipping_entry) {
-                if (!(ep = strchr(buf, '\n'))) goto bad_data_file;
-                *ep = 0;
-                /* if we match a key that begins with "~", skip this entry */
-                chk_skip = (*buf == '~') ? 1 : 0;
-                if (pmatch(&buf[chk_skip], dbase_str) ||
-                    (alt && pmatch(&buf[chk_skip], alt))) {
-                    if (chk_skip) {
-                        skipping_entry = TRUE;
-                        continue;
-                    } else {
-                        found_in_file = TRUE;
-                        break;
-                    }
-                }
-            }
-        }
+        found_in_file = dbase_lookup(dbase_str, alt);
     }
 
     init_menulist(&menu);
@@ -1015,26 +1116,17 @@ static void checkfile(const char *inp, struct permonst *pm, boolean user_typed_n
     }
 
     if (found_in_file) {
-        long entry_offset;
-        int  entry_count;
-        int  i;
-
-        /* skip over other possible matches for the info */
-        do {
-            if (!dlb_fgets(buf, BUFSZ, fp))
-                goto bad_data_file;
-        } while (!digit(*buf));
-
-        if (sscanf(buf, "%ld,%d\n", &entry_offset, &entry_count) < 2) {
-        bad_data_file:  impossible("'data' file in wrong format");
-            free(menu.items);
-            dlb_fclose(fp);
-            return;
-        }
+        int i;
 
         if (user_typed_name || without_asking || yn("More info?") == 'y') {
-
-            if (dlb_fseek(fp, txt_offset + entry_offset, SEEK_SET) < 0) {
+            fp = dlb_fopen(DATAFILE, "r");
+            if (!fp) {
+                pline("Cannot open data file!");
+                free(menu.items);
+                return;
+            }
+            if (dlb_fseek(fp, dbase.txt_offset + found_in_file->offset,
+                          SEEK_SET) < 0) {
                 pline("? Seek error on 'data' file!");
                 free(menu.items);
                 dlb_fclose(fp);
@@ -1044,15 +1136,20 @@ static void checkfile(const char *inp, struct permonst *pm, boolean user_typed_n
             if (menu.icount)
                 add_menutext(&menu, "");
 
-            for (i = 0; i < entry_count; i++) {
-                if (!dlb_fgets(buf, BUFSZ, fp))
-                    goto bad_data_file;
+            for (i = 0; i < found_in_file->count; i++) {
+                if (!dlb_fgets(buf, BUFSZ, fp)) {
+                    impossible("'data' file in wrong format");
+                    free(menu.items);
+                    dlb_fclose(fp);
+                    return;
+                }
                 if ((ep = strchr(buf, '\n')) != 0)
                     *ep = 0;
                 if (strchr(buf+1, '\t') != 0)
                     tabexpand(buf+1);
                 add_menutext(&menu, buf+1);
             }
+            dlb_fclose(fp);
         }
     } else if (user_typed_name && !menu.icount) {
         pline("I don't have any information on those things.");
@@ -1061,8 +1158,6 @@ static void checkfile(const char *inp, struct permonst *pm, boolean user_typed_n
     if (menu.icount)
         display_menu(menu.items, menu.icount, upstart(dbase_str), FALSE, NULL);
     free(menu.items);
-
-    dlb_fclose(fp);
 }
 
 /*
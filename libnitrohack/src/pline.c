@@ -121,6 +121,7 @@ static void vpline(const char *line, va_list the_args)
         vision_recalc(0);
     if (u.ux)
         flush_screen();
+    anim_flush();   /* the message must not overtake an animation */
 
     if (repeated) {
         toplines_count[lastline]++;
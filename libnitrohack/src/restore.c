@@ -482,6 +482,7 @@ static void restgamestate(struct memfile *mf)
     restore_timers(mf, lev, RANGE_GLOBAL, FALSE, 0L);
     restore_light_sources(mf, lev);
     invent = restobjchn(mf, lev, FALSE, FALSE);
+    reset_inv_props(&youmonst);
     magic_chest_objs = restobjchn(mf, lev, FALSE, FALSE);
     migrating_mons = restmonchn(mf, lev, FALSE);
     restore_mvitals(mf);
@@ -843,6 +844,7 @@ struct level *getlev(struct memfile *mf, xchar levnum, boolean ghostly)
     for (x = 0; x < COLNO; x++)
         for (y = 0; y < ROWNO; y++)
             restore_location(mf, &lev->locations[x][y]);
+    prime_bg_memo(lev);
 
     lev->lastmoves = mread32(mf);
     mread(mf, &lev->upstair, sizeof(stairway));
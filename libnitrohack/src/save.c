@@ -770,6 +770,9 @@ void freedynamicdata(void)
     free_waterlevel();
     free_dungeon();
     free_history();
+    free_rndmonst_tables();
+    free_object_tables();
+    reset_travel_cache();
 
     if (iflags.ap_rules) {
         free(iflags.ap_rules->rules);
@@ -1198,9 +1198,9 @@ void do_storms(void)
  *      Start a timer of kind 'kind' that will expire at time
  *      moves+'timeout'.  Call the function at 'func_index'
  *      in the timeout table using argument 'arg'.  Return TRUE if
- *      a timer was started.  This places the timer on a list ordered
- *      "sooner" to "later".  If an object, increment the object's
- *      timer count.
+ *      a timer was started.  This places the timer in the level's
+ *      queue, which is ordered "sooner" to "later".  If an object,
+ *      increment the object's timer count.
  *
  *  long stop_timer(struct level *lev, short func_index, void * arg)
  *      Stop a timer specified by the (func_index, arg) pair.  This
@@ -1245,17 +1245,30 @@ void do_storms(void)
  */
 
 static const char *kind_name(short);
-static void print_queue(struct menulist *menu, timer_element *);
+static void print_queue(struct menulist *menu, struct timer_queue *);
+static boolean timer_before(const timer_element *, const timer_element *);
+static void heap_set(struct timer_queue *, int, timer_element *);
+static void heap_sift_up(struct timer_queue *, int);
+static void heap_sift_down(struct timer_queue *, int);
+static int hash_index(const struct timer_queue *, const void *);
+static void hash_add(struct timer_queue *, timer_element *);
+static void hash_remove(struct timer_queue *, timer_element *);
 static void insert_timer(struct level *lev, timer_element *gnu);
-static timer_element *remove_timer(timer_element **, short,void *);
-static const timer_element *peek_timer(const timer_element *, short, const void *);
+static void unlink_timer(struct timer_queue *, timer_element *);
+static timer_element *remove_timer(struct timer_queue *, short,void *);
+static timer_element *peek_timer(const struct timer_queue *, short, const void *);
+static int obj_timers(struct obj *, timer_element ***);
+static timer_element **sorted_timers(struct timer_queue *);
 static void write_timer(struct memfile *mf, timer_element *);
 static boolean mon_is_local(struct monst *);
 static boolean timer_is_local(timer_element *);
 static int maybe_write_timer(struct memfile *mf, struct level *lev, int range, boolean write_it);
 
-/* ordered timer list */
 static unsigned int timer_id;
+/* Insertion counter for breaking ties between timers with the same timeout.
+ * Only the relative order of timers on one level matters, so it doesn't need
+ * to be saved: restore_timers() inserts the saved timers in order. */
+static unsigned long timer_seq;
 
 
 void init_timeout(void)
@@ -1300,21 +1313,25 @@ static const char *kind_name(short kind)
     return "unknown";
 }
 
-static void print_queue(struct menulist *menu, timer_element *base)
+static void print_queue(struct menulist *menu, struct timer_queue *tq)
 {
-    timer_element *curr;
+    timer_element **sorted;
     char buf[BUFSZ];
+    int i;
 
-    if (!base) {
+    if (!tq->count) {
         add_menutext(menu,  "<empty>");
     } else {
         add_menutext(menu,  "timeout  id   kind   call");
-        for (curr = base; curr; curr = curr->next) {
+        sorted = sorted_timers(tq);
+        for (i = 0; i < tq->count; i++) {
             sprintf(buf,    " %4u  %4u   %-6s #%d %s (%p)",
-                    curr->timeout, curr->tid, kind_name(curr->kind),
-                    curr->func_index, timeout_funcs[curr->func_index].name, curr->arg);
+                    sorted[i]->timeout, sorted[i]->tid, kind_name(sorted[i]->kind),
+                    sorted[i]->func_index,
+                    timeout_funcs[sorted[i]->func_index].name, sorted[i]->arg);
             add_menutext(menu, buf);
         }
+        free(sorted);
     }
 }
 
@@ -1330,7 +1347,7 @@ int wiz_timeout_queue(void)
     add_menutext(&menu, "");
     add_menutext(&menu, "Active timeout queue:");
     add_menutext(&menu, "");
-    print_queue(&menu, level->lev_timers);
+    print_queue(&menu, &level->lev_timers);
 
     display_menu(menu.items, menu.icount, NULL, PICK_NONE, NULL);
     free(menu.items);
@@ -1346,15 +1363,16 @@ int wiz_timeout_queue(void)
 void run_timers(void)
 {
     timer_element *curr;
+    struct timer_queue *tq = &level->lev_timers;
 
     /*
      * Always use the first element.  Elements may be added or deleted at
-     * any time.  The list is ordered, we are done when the first element
+     * any time.  The queue is ordered, we are done when the first element
      * is in the future.
      */
-    while (level->lev_timers && level->lev_timers->timeout <= moves) {
-        curr = level->lev_timers;
-        level->lev_timers = curr->next;
+    while (tq->count && tq->heap[0]->timeout <= moves) {
+        curr = tq->heap[0];
+        unlink_timer(tq, curr);
 
         if (curr->kind == TIMER_OBJECT) ((struct obj *)(curr->arg))->timed--;
         (*timeout_funcs[curr->func_index].f)(curr->arg, curr->timeout);
@@ -1375,7 +1393,6 @@ boolean start_timer(struct level *lev, long when, short kind, short func_index,v
 
     gnu = malloc(sizeof(timer_element));
     memset(gnu, 0, sizeof(timer_element));
-    gnu->next = NULL;
     gnu->tid = timer_id++;
     gnu->timeout = moves + when;
     gnu->kind = kind;
@@ -1424,7 +1441,7 @@ long report_timer(struct level *lev, short func_index, const void *arg)
 {
     const timer_element *checking;
 
-    checking = peek_timer(lev->lev_timers, func_index, arg);
+    checking = peek_timer(&lev->lev_timers, func_index, arg);
 
     if (checking)
         return checking->timeout;
@@ -1438,15 +1455,29 @@ long report_timer(struct level *lev, short func_index, const void *arg)
  */
 void obj_move_timers(struct obj *src, struct obj *dest)
 {
-    int count;
-    timer_element *curr;
+    struct timer_queue *tq = &src->olev->lev_timers;
+    struct level *right_lev;
+    timer_element **found;
+    int count, i;
+
+    /* only the arg changes, so the order of the timers stays the same */
+    count = obj_timers(src, &found);
+    for (i = 0; i < count; i++) {
+        hash_remove(tq, found[i]);
+        found[i]->arg = dest;
+        hash_add(tq, found[i]);
+        dest->timed++;
+    }
 
-    for (count = 0, curr = src->olev->lev_timers; curr; curr = curr->next)
-        if (curr->kind == TIMER_OBJECT && curr->arg == src) {
-            curr->arg = dest;
-            dest->timed++;
-            count++;
+    /* keep the timers with dest if it lives somewhere else */
+    right_lev = obj_is_local(dest) ? dest->olev : level;
+    if (count && right_lev != src->olev) {
+        for (i = 0; i < count; i++) {
+            unlink_timer(tq, found[i]);
+            insert_timer(right_lev, found[i]);
         }
+    }
+    free(found);
     if (count != src->timed)
         panic("obj_move_timers");
     src->timed = 0;
@@ -1458,15 +1489,13 @@ void obj_move_timers(struct obj *src, struct obj *dest)
  */
 void obj_split_timers(struct obj *src, struct obj *dest)
 {
-    timer_element *curr, *next_timer=0;
+    timer_element **found;
+    int count, i;
 
-    for (curr = src->olev->lev_timers; curr; curr = next_timer) {
-        next_timer = curr->next;    /* things may be inserted */
-        if (curr->kind == TIMER_OBJECT && curr->arg == src) {
-            start_timer(dest->olev, curr->timeout-moves, TIMER_OBJECT,
-                        curr->func_index, dest);
-        }
-    }
+    for (count = obj_timers(src, &found), i = 0; i < count; i++)
+        start_timer(dest->olev, found[i]->timeout-moves, TIMER_OBJECT,
+                    found[i]->func_index, dest);
+    free(found);
 }
 
 
@@ -1476,70 +1505,242 @@ void obj_split_timers(struct obj *src, struct obj *dest)
  */
 void obj_stop_timers(struct obj *obj)
 {
-    timer_element *curr, *prev, *next_timer=0;
-
-    for (prev = 0, curr = obj->olev->lev_timers; curr; curr = next_timer) {
-        next_timer = curr->next;
-        if (curr->kind == TIMER_OBJECT && curr->arg == obj) {
-            if (prev)
-                prev->next = curr->next;
-            else
-                obj->olev->lev_timers = curr->next;
-            if (timeout_funcs[curr->func_index].cleanup)
-                (*timeout_funcs[curr->func_index].cleanup)(curr->arg, curr->timeout);
-            free(curr);
-        } else {
-            prev = curr;
-        }
+    timer_element **found;
+    int count, i;
+
+    count = obj_timers(obj, &found);
+    for (i = 0; i < count; i++) {
+        unlink_timer(&obj->olev->lev_timers, found[i]);
+        if (timeout_funcs[found[i]->func_index].cleanup)
+            (*timeout_funcs[found[i]->func_index].cleanup)(found[i]->arg,
+                                                          found[i]->timeout);
+        free(found[i]);
     }
+    free(found);
     obj->timed = 0;
 }
 
 
-/* Insert timer into the global queue */
+/*
+ * Timer queue implementation.
+ *
+ * The order of the timers is exactly that of the sorted list that was used
+ * before: by timeout, and among timers with the same timeout the one inserted
+ * last comes first.  This keeps the order in which timers run, and the order
+ * in which they are saved, unchanged.
+ */
+static boolean timer_before(const timer_element *a, const timer_element *b)
+{
+    if (a->timeout != b->timeout)
+        return a->timeout < b->timeout;
+    return a->seq > b->seq;
+}
+
+
+static void heap_set(struct timer_queue *tq, int pos, timer_element *timer)
+{
+    tq->heap[pos] = timer;
+    timer->heappos = pos;
+}
+
+
+static void heap_sift_up(struct timer_queue *tq, int pos)
+{
+    timer_element *timer = tq->heap[pos];
+
+    while (pos > 0 && timer_before(timer, tq->heap[(pos - 1) / 2])) {
+        heap_set(tq, pos, tq->heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    heap_set(tq, pos, timer);
+}
+
+
+static void heap_sift_down(struct timer_queue *tq, int pos)
+{
+    timer_element *timer = tq->heap[pos];
+    int child;
+
+    while ((child = 2 * pos + 1) < tq->count) {
+        if (child + 1 < tq->count &&
+            timer_before(tq->heap[child + 1], tq->heap[child]))
+            child++;
+        if (!timer_before(tq->heap[child], timer))
+            break;
+        heap_set(tq, pos, tq->heap[child]);
+        pos = child;
+    }
+    heap_set(tq, pos, timer);
+}
+
+
+static int hash_index(const struct timer_queue *tq, const void *arg)
+{
+    unsigned long h = (unsigned long)arg;
+
+    h ^= h >> 16;
+    h *= 0x45d9f3bUL;
+    h ^= h >> 16;
+    return h & (tq->hashsize - 1);
+}
+
+
+static void hash_add(struct timer_queue *tq, timer_element *timer)
+{
+    int i;
+
+    timer->hnext = tq->hash[hash_index(tq, timer->arg)];
+    tq->hash[hash_index(tq, timer->arg)] = timer;
+
+    /* keep the average chain length below 1 */
+    if (tq->count > tq->hashsize) {
+        timer_element **old = tq->hash, *curr, *next;
+        int oldsize = tq->hashsize;
+
+        tq->hashsize *= 2;
+        tq->hash = malloc(tq->hashsize * sizeof(timer_element *));
+        memset(tq->hash, 0, tq->hashsize * sizeof(timer_element *));
+        for (i = 0; i < oldsize; i++)
+            for (curr = old[i]; curr; curr = next) {
+                next = curr->hnext;
+                curr->hnext = tq->hash[hash_index(tq, curr->arg)];
+                tq->hash[hash_index(tq, curr->arg)] = curr;
+            }
+        free(old);
+    }
+}
+
+
+static void hash_remove(struct timer_queue *tq, timer_element *timer)
+{
+    timer_element **link = &tq->hash[hash_index(tq, timer->arg)];
+
+    while (*link != timer)
+        link = &(*link)->hnext;
+    *link = timer->hnext;
+    timer->hnext = NULL;
+}
+
+
+/* Insert timer into the level's queue */
 static void insert_timer(struct level *lev, timer_element *gnu)
 {
-    timer_element *curr, *prev;
+    struct timer_queue *tq = &lev->lev_timers;
+
+    if (tq->count == tq->heapsize) {
+        tq->heapsize = tq->heapsize ? tq->heapsize * 2 : 16;
+        tq->heap = realloc(tq->heap, tq->heapsize * sizeof(timer_element *));
+    }
+    if (!tq->hashsize) {
+        tq->hashsize = 16;
+        tq->hash = malloc(tq->hashsize * sizeof(timer_element *));
+        memset(tq->hash, 0, tq->hashsize * sizeof(timer_element *));
+    }
 
-    for (prev = 0, curr = lev->lev_timers; curr; prev = curr, curr = curr->next)
-        if (curr->timeout >= gnu->timeout) break;
+    gnu->seq = ++timer_seq;
+    heap_set(tq, tq->count++, gnu);
+    heap_sift_up(tq, gnu->heappos);
+    hash_add(tq, gnu);
+}
+
+
+/* Take a timer out of the queue without freeing it */
+static void unlink_timer(struct timer_queue *tq, timer_element *timer)
+{
+    int pos = timer->heappos;
 
-    gnu->next = curr;
-    if (prev)
-        prev->next = gnu;
+    hash_remove(tq, timer);
+    tq->count--;
+    if (pos == tq->count)
+        return;
+
+    heap_set(tq, pos, tq->heap[tq->count]);
+    if (pos > 0 && timer_before(tq->heap[pos], tq->heap[(pos - 1) / 2]))
+        heap_sift_up(tq, pos);
     else
-        lev->lev_timers = gnu;
+        heap_sift_down(tq, pos);
 }
 
 
-static timer_element *remove_timer(timer_element **base, short func_index,
+static timer_element *remove_timer(struct timer_queue *tq, short func_index,
                                    void * arg)
 {
-    timer_element *prev, *curr;
+    timer_element *curr = peek_timer(tq, func_index, arg);
 
-    for (prev = 0, curr = *base; curr; prev = curr, curr = curr->next)
-        if (curr->func_index == func_index && curr->arg == arg) break;
-
-    if (curr) {
-        if (prev)
-            prev->next = curr->next;
-        else
-            *base = curr->next;
-    }
+    if (curr)
+        unlink_timer(tq, curr);
 
     return curr;
 }
 
 
-static const timer_element *peek_timer(const timer_element *base,
-                                       short func_index, const void *arg)
+/*
+ * Find the timer for (func_index, arg).  If there are several, return the
+ * one that is first in timer order.
+ */
+static timer_element *peek_timer(const struct timer_queue *tq,
+                                 short func_index, const void *arg)
 {
-    const timer_element *curr;
+    timer_element *curr, *found = NULL;
 
-    for (curr = base; curr; curr = curr->next)
-        if (curr->func_index == func_index && curr->arg == arg) break;
+    if (!tq->count)
+        return NULL;
 
-    return curr;
+    for (curr = tq->hash[hash_index(tq, arg)]; curr; curr = curr->hnext)
+        if (curr->func_index == func_index && curr->arg == arg &&
+            (!found || timer_before(curr, found)))
+            found = curr;
+
+    return found;
+}
+
+
+static int timer_compare(const void *a, const void *b)
+{
+    const timer_element *ta = *(const timer_element * const *)a;
+    const timer_element *tb = *(const timer_element * const *)b;
+
+    return timer_before(ta, tb) ? -1 : timer_before(tb, ta) ? 1 : 0;
+}
+
+
+/*
+ * Collect the object timers of obj in timer order.  The array is returned via
+ * found and must be freed by the caller.
+ */
+static int obj_timers(struct obj *obj, timer_element ***found)
+{
+    struct timer_queue *tq = &obj->olev->lev_timers;
+    timer_element *curr;
+    int count = 0, size = 4;
+
+    *found = malloc(size * sizeof(timer_element *));
+    if (!tq->count)
+        return 0;
+
+    for (curr = tq->hash[hash_index(tq, obj)]; curr; curr = curr->hnext) {
+        if (curr->kind != TIMER_OBJECT || curr->arg != obj)
+            continue;
+        if (count == size) {
+            size *= 2;
+            *found = realloc(*found, size * sizeof(timer_element *));
+        }
+        (*found)[count++] = curr;
+    }
+    qsort(*found, count, sizeof(timer_element *), timer_compare);
+    return count;
+}
+
+
+/* Return all timers of the queue in timer order.  Free the result. */
+static timer_element **sorted_timers(struct timer_queue *tq)
+{
+    timer_element **sorted = malloc((tq->count + 1) * sizeof(timer_element *));
+
+    if (tq->count)
+        memcpy(sorted, tq->heap, tq->count * sizeof(timer_element *));
+    qsort(sorted, tq->count, sizeof(timer_element *), timer_compare);
+    return sorted;
 }
 
 
@@ -1632,16 +1833,20 @@ static boolean timer_is_local(timer_element *timer)
 }
 
 
+
 /*
  * Part of the save routine.  Count up the number of timers that would
  * be written.  If write_it is true, actually write the timer.
  */
 static int maybe_write_timer(struct memfile *mf, struct level *lev, int range, boolean write_it)
 {
-    int count = 0;
-    timer_element *curr;
+    int count = 0, i;
+    timer_element **sorted, *curr;
 
-    for (curr = lev->lev_timers; curr; curr = curr->next) {
+    /* timers are written in timer order, exactly as the list used to be */
+    sorted = sorted_timers(&lev->lev_timers);
+    for (i = 0; i < lev->lev_timers.count; i++) {
+        curr = sorted[i];
         if (range == RANGE_GLOBAL) {
             /* global timers */
 
@@ -1660,6 +1865,7 @@ static int maybe_write_timer(struct memfile *mf, struct level *lev, int range, b
 
         }
     }
+    free(sorted);
 
     return count;
 }
@@ -1667,115 +1873,113 @@ static int maybe_write_timer(struct memfile *mf, struct level *lev, int range, b
 
 void transfer_timers(struct level *oldlev, struct level *newlev, unsigned int obj_id)
 {
-    timer_element *curr, *prev = NULL, *next_timer = NULL;
+    struct timer_queue *tq = &oldlev->lev_timers;
+    timer_element **moving, *curr;
+    int i, count = 0;
 
-    if (newlev == oldlev)
+    if (newlev == oldlev || !tq->count)
         return;
 
-    for (curr = oldlev->lev_timers; curr; curr = next_timer) {
-        next_timer = curr->next;    /* in case curr is removed */
-
+    moving = malloc(tq->count * sizeof(timer_element *));
+    for (i = 0; i < tq->count; i++) {
+        curr = tq->heap[i];
         /* transfer global timers or timers of requested object */
         if ((!obj_id && !timer_is_local(curr)) ||
             (obj_id && curr->kind == TIMER_OBJECT &&
-             ((struct obj *)curr->arg)->o_id == obj_id)) {
-            if (prev)
-                prev->next = curr->next;
-            else
-                oldlev->lev_timers = curr->next;
+             ((struct obj *)curr->arg)->o_id == obj_id))
+            moving[count++] = curr;
+    }
 
-            insert_timer(newlev, curr);
-            /* prev stays the same */
-        } else {
-            prev = curr;
-        }
+    /* insert them in timer order, so that ties come out as before */
+    qsort(moving, count, sizeof(timer_element *), timer_compare);
+    for (i = 0; i < count; i++) {
+        unlink_timer(tq, moving[i]);
+        insert_timer(newlev, moving[i]);
     }
+    free(moving);
 }
 
 
-/*
- * Verify that the timer chains of all levels are as they should be, and if
- * not, fix them.
- */
-void validate_timers(void)
+/* Remove a broken timer found by validate_timers. */
+static void discard_timer(struct level *lev, timer_element *timer)
 {
-    int i;
+    unlink_timer(&lev->lev_timers, timer);
+    if (timer->kind == TIMER_OBJECT && timer->arg)
+        ((struct obj *)timer->arg)->timed--;
+    if (timeout_funcs[timer->func_index].cleanup)
+        (*timeout_funcs[timer->func_index].cleanup)(timer->arg, timer->timeout);
+    free(timer);
+}
 
-    for (i = 0; i <= maxledgerno(); i++) {
-        timer_element *curr;
-        timer_element *next;
-        timer_element *move_me;
-        unsigned int curr_timeout;
-        unsigned int last_timeout = 0;
-        struct level *lev = levels[i];
 
-        if (!lev)
-            continue;
-
-        for (curr = lev->lev_timers; curr; curr = next, last_timeout = curr_timeout) {
-            struct level *right_lev;
+/*
+ * Return the level an object timer belongs on, or NULL if the timer is broken.
+ *
+ *  - local object timers should be on the same level as their object
+ *  - global object timers should be on the player's current level
+ */
+static struct level *object_timer_level(timer_element *timer)
+{
+    struct obj *o_arg = (struct obj *)timer->arg;
+    struct level *right_lev;
 
-            next = curr->next;        /* in case curr is moved */
-            curr_timeout = curr->timeout; /* ditto */
+    if (!o_arg || !o_arg->timed)
+        return NULL;
 
-            if (curr->kind == TIMER_OBJECT) {
-                struct obj *o_arg = (struct obj *)curr->arg;
+    right_lev = timer_is_local(timer) ? o_arg->olev : level;
+    if (!right_lev)
+        panic("validate_timers: right_lev is null");
+    return right_lev;
+}
 
-                /* sanity check */
-                if (!o_arg) {
-                    warning("validate_timers: object timer with null object, removing");
-                    stop_timer(lev, curr->func_index, curr->arg);
-                    continue;
-                }
 
-                /* check if object should be timed */
-                if (!o_arg->timed) {
-                    /* If the timer and the object's timed flag disagree, the
-                     * timer is probably in the wrong, so delete it. */
-                    warning("validate_timers: timer attached to untimed object, removing");
-                    stop_timer(lev, curr->func_index, curr->arg);
-                    continue;
-                }
+/*
+ * Verify that the timer queues of all levels are as they should be, and if
+ * not, fix them.  The heap can't be out of order, so only the object timers
+ * need to be checked.
+ */
+void validate_timers(void)
+{
+    int i, j, count;
+    timer_element **sorted, *curr;
+    struct level *lev, *right_lev;
 
-                /*
-                 * Check that the timer is on the right level:
-                 *
-                 *  - local object timers should be on the same level as their object
-                 *  - global object timers should be on the player's current level
-                 */
-                right_lev = timer_is_local(curr) ? o_arg->olev : level;
-                if (!right_lev) {
-                    panic("validate_timers: right_lev is null");
-                } else if (lev != right_lev) {
-                    warning("validate_timers: timer found on wrong level, fixing");
-                    move_me = remove_timer(&lev->lev_timers, curr->func_index, curr->arg);
-                    if (!move_me)
-                        panic("validate_timers: what the hell?");
-                    insert_timer(right_lev, move_me);
-                    continue;
-                }
-            }
+    for (i = 0; i <= maxledgerno(); i++) {
+        lev = levels[i];
+        if (!lev)
+            continue;
 
-            /* make sure timers are in ascending order */
-            if (timer_is_local(curr)) {
-                right_lev = (curr->kind == TIMER_OBJECT) ?
-                    ((struct obj *)curr->arg)->olev :
-                    lev;
-            } else {
-                right_lev = level;
-            }
-            if (!right_lev)
-                panic("validate_timers: right_lev is null");
-            if (curr->timeout < last_timeout) {
-                /* insertion sort */
-                warning("validate_timers: timer found out of order, reordering");
-                move_me = remove_timer(&lev->lev_timers, curr->func_index, curr->arg);
-                if (!move_me)
-                    panic("validate_timers: what the hell?");
-                insert_timer(right_lev, move_me);
+        for (j = 0; j < lev->lev_timers.count; j++) {
+            curr = lev->lev_timers.heap[j];
+            if (curr->kind == TIMER_OBJECT && object_timer_level(curr) != lev)
+                break;
+        }
+        if (j == lev->lev_timers.count)
+            continue; /* all good */
+
+        /* something is wrong; fix it, going through the timers in order */
+        count = lev->lev_timers.count;
+        sorted = sorted_timers(&lev->lev_timers);
+        for (j = 0; j < count; j++) {
+            curr = sorted[j];
+            if (curr->kind != TIMER_OBJECT)
                 continue;
+
+            if (!curr->arg) {
+                warning("validate_timers: object timer with null object, removing");
+                discard_timer(lev, curr);
+            } else if (!((struct obj *)curr->arg)->timed) {
+                /* If the timer and the object's timed flag disagree, the
+                 * timer is probably in the wrong, so delete it. */
+                warning("validate_timers: timer attached to untimed object, removing");
+                discard_timer(lev, curr);
+            } else if ((right_lev = object_timer_level(curr)) != lev) {
+                warning("validate_timers: timer found on wrong level, fixing");
+                unlink_timer(&lev->lev_timers, curr);
+                insert_timer(right_lev, curr);
             }
         }
+        free(sorted);
     }
 }
 
@@ -1809,13 +2013,14 @@ void save_timers(struct memfile *mf, struct level *lev, int range)
 
 void free_timers(struct level *lev)
 {
-    timer_element *curr, *next = NULL;
+    struct timer_queue *tq = &lev->lev_timers;
+    int i;
 
-    for (curr = lev->lev_timers; curr; curr = next) {
-        next = curr->next;
-        free(curr);
-    }
-    lev->lev_timers = NULL;
+    for (i = 0; i < tq->count; i++)
+        free(tq->heap[i]);
+    free(tq->heap);
+    free(tq->hash);
+    memset(tq, 0, sizeof(struct timer_queue));
 }
 
 
@@ -1838,6 +2043,7 @@ void restore_timers(struct memfile *mf, struct level *lev, int range,
     count = mread32(mf);
     while (count-- > 0) {
         curr = malloc(sizeof(timer_element));
+        memset(curr, 0, sizeof(timer_element));
 
         curr->tid = mread32(mf);
         curr->timeout = mread32(mf);
@@ -1857,10 +2063,13 @@ void restore_timers(struct memfile *mf, struct level *lev, int range,
 /* reset all timers that are marked for reseting */
 void relink_timers(boolean ghostly, struct level *lev)
 {
+    struct timer_queue *tq = &lev->lev_timers;
     timer_element *curr;
     unsigned nid;
+    int i;
 
-    for (curr = lev->lev_timers; curr; curr = curr->next) {
+    for (i = 0; i < tq->count; i++) {
+        curr = tq->heap[i];
         if (curr->needs_fixup) {
             if (curr->kind == TIMER_OBJECT) {
                 if (ghostly) {
@@ -1868,8 +2077,11 @@ void relink_timers(boolean ghostly, struct level *lev)
                         panic("relink_timers 1");
                 } else
                     nid = (long) curr->arg;
+                /* the hash is keyed on arg */
+                hash_remove(tq, curr);
                 curr->arg = find_oid(lev, nid);
                 if (!curr->arg) panic("cant find o_id %d", nid);
+                hash_add(tq, curr);
                 curr->needs_fixup = 0;
             } else
                 panic("relink_timers 2");
@@ -127,24 +127,53 @@ void vision_init(void)
 }
 
 /*
- * does_block()
+ * loc_sync()
  *
- * Returns true if the level feature, object, or monster at (x,y) blocks
- * sight.
+ * Copy the location (x,y) into the row-major planes of its level.
  */
-boolean does_block(struct level *lev, int x, int y, const struct monst *excludemon)
+void loc_sync(struct level *lev, int x, int y)
+{
+    struct rm *loc = &lev->locations[x][y];
+
+    plane_typ(lev, x, y) = loc->typ;
+    plane_lit(lev, x, y) = loc->lit;
+    plane_flags(lev, x, y) = loc->flags;
+}
+
+/*
+ * loc_sync_level()
+ *
+ * Copy the whole level into its planes.  Reading locations in storage
+ * order keeps this one sequential pass.
+ */
+void loc_sync_level(struct level *lev)
+{
+    int x, y;
+
+    for (x = 0; x < COLNO; x++)
+        for (y = 0; y < ROWNO; y++)
+            loc_sync(lev, x, y);
+}
+
+/*
+ * plane_blocks()
+ *
+ * does_block() for a location whose planes are up to date.
+ */
+static boolean plane_blocks(struct level *lev, int x, int y,
+                            const struct monst *excludemon)
 {
     struct obj   *obj;
     struct monst *mon;
-    struct rm *loc = &lev->locations[x][y];
+    schar typ = plane_typ(lev, x, y);
 
     /* Features that block . . */
-    if (IS_ROCK(loc->typ) || loc->typ == TREE || (IS_DOOR(loc->typ) &&
-                                                  (loc->doormask & (D_CLOSED|D_LOCKED|D_TRAPPED) )))
+    if (IS_ROCK(typ) || typ == TREE || (IS_DOOR(typ) &&
+                                        (plane_doormask(lev, x, y) & (D_CLOSED|D_LOCKED|D_TRAPPED) )))
         return 1;
 
-    if (loc->typ == CLOUD || loc->typ == WATER ||
-        (loc->typ == MOAT && Underwater))
+    if (typ == CLOUD || typ == WATER ||
+        (typ == MOAT && Underwater))
         return 1;
 
     /* Boulders block light. */
@@ -163,6 +192,19 @@ boolean does_block(struct level *lev, int x, int y, const struct monst *excludem
     return 0;
 }
 
+/*
+ * does_block()
+ *
+ * Returns true if the level feature, object, or monster at (x,y) blocks
+ * sight.
+ */
+boolean does_block(struct level *lev, int x, int y, const struct monst *excludemon)
+{
+    /* the caller may just have changed the terrain here */
+    loc_sync(lev, x, y);
+    return plane_blocks(lev, x, y, excludemon);
+}
+
 /*
  * vision_reset()
  *
@@ -173,7 +215,7 @@ void vision_reset(void)
 {
     int y;
     int x, i, dig_left, block;
-    struct rm *loc;
+    schar *typ_row;
 
     /* Start out with cs0 as our current array */
     viz_array = cs_rows0;
@@ -185,13 +227,14 @@ void vision_reset(void)
     /* Reset the pointers and clear so that we have a "full" dungeon. */
     memset(viz_clear,        0, sizeof(viz_clear));
 
-    /* Dig the level */
+    /* Dig the level, a row of the planes at a time */
+    loc_sync_level(level);
     for (y = 0; y < ROWNO; y++) {
         dig_left = 0;
         block = TRUE;   /* location (0,y) is always stone; it's !isok() */
-        loc = &level->locations[1][y];
-        for (x = 1; x < COLNO; x++, loc += ROWNO)
-            if (block != (IS_ROCK(loc->typ) || does_block(level, x, y, NULL))) {
+        typ_row = level->planes.typ[y];
+        for (x = 1; x < COLNO; x++)
+            if (block != (IS_ROCK(typ_row[x]) || plane_blocks(level, x, y, NULL))) {
                 if (block) {
                     for (i=dig_left; i<x; i++) {
                         left_ptrs [y][i] = dig_left;
@@ -774,6 +817,7 @@ void vision_recalc(int control)
  */
 void block_point(int x, int y)
 {
+    loc_sync(level, x, y);
     fill_point(y,x);
 
     /* recalc light sources here? */
@@ -795,6 +839,7 @@ void block_point(int x, int y)
  */
 void unblock_point(int x, int y)
 {
+    loc_sync(level, x, y);
     dig_point(y,x);
 
     /* recalc light sources here? */
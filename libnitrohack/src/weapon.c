@@ -693,6 +693,7 @@ int mon_wield_item(struct monst *mon)
                       s_suffix(mon_nam(mon)), mbodypart(mon,HAND));
         }
         obj->owornmask = W_WEP;
+        reset_inv_props(mon);
         return 1;
     }
     mon->weapon_check = NEED_WEAPON;
@@ -1527,6 +1528,7 @@ void setmnotwielded(struct monst *mon, struct obj *obj)
                   otense(obj, "stop"));
     }
     obj->owornmask &= ~W_WEP;
+    reset_inv_props(mon);
 }
 
 xchar mon_skill_level(int skill, const struct monst *mtmp)
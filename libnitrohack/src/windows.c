@@ -13,6 +13,7 @@ int getpos(coord *cc, boolean force, const char *goal)
     y = cc->y;
 
     flush_screen();
+    anim_flush();
 
     do {
         rv = (*windowprocs.win_getpos)(&x, &y, force, goal);
@@ -41,7 +42,10 @@ int getdir(const char *s, schar *dx, schar *dy, schar *dz)
     };
     const char *query = s ? s : "In what direction?";
     boolean restricted = u.umonnum == PM_GRID_BUG;
-    enum nh_direction dir = (*windowprocs.win_getdir)(query, restricted);
+    enum nh_direction dir;
+
+    anim_flush();
+    dir = (*windowprocs.win_getdir)(query, restricted);
     log_getdir(dir);
     pline("<%s: %s>", query, dirnames[dir + 1]);
     suppress_more();
@@ -65,6 +69,7 @@ int getdir(const char *s, schar *dx, schar *dy, schar *dz)
 char query_key(const char *query, int *count)
 {
     char key;
+    anim_flush();
     key = (*windowprocs.win_query_key)(query, count);
     log_query_key(key, count);
 
@@ -80,6 +85,7 @@ char query_key(const char *query, int *count)
 
 void getlin(const char *query, char *bufp)
 {
+    anim_flush();
     (*windowprocs.win_getlin)(query, bufp);
     log_getlin(bufp);
     pline("<%s: %s>", query, bufp[0] == '\033' ? "(escaped)" : bufp);
@@ -110,6 +116,7 @@ char yn_function(const char *query,const char *resp, char def)
     } else
         strcpy(qbuf, query);
 
+    anim_flush();
     key = (*windowprocs.win_yn_function)(qbuf, resp, def);
     log_yn_function(key);
     pline("<%s [%s]: %c>", qbuf, resp, key);
@@ -146,6 +153,7 @@ int display_menu(struct nh_menuitem *items, int icount, const char *title,
         warning("display_menu: invalid how argument (%d)", how);
         how = PICK_NONE;
     }
+    anim_flush();
     n = (*windowprocs.win_display_menu)(items, icount, title, how, results);
     if (how != PICK_NONE) {
         char buf[BUFSZ] = "(none selected)";
@@ -168,6 +176,7 @@ int display_objects(struct nh_objitem *items, int icount, const char *title,
                     int how, struct nh_objresult *pick_list)
 {
     int n, j;
+    anim_flush();
     n = (*windowprocs.win_display_objects)(items, icount, title, how, pick_list);
     if (how != PICK_NONE && how != PICK_INVACTION) {
         char buf[BUFSZ] = "(none selected)";
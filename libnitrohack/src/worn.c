@@ -107,6 +107,7 @@ void setworn_core(struct obj *obj, long mask, boolean side_effects)
                 }
             }
     }
+    reset_inv_props(&youmonst);
     update_inventory();
 }
 
@@ -139,6 +140,7 @@ void setnotworn(struct obj *obj)
                     u.uprops[CLAIRVOYANT].blocked &= ~wp->w_mask;
             }
         }
+    reset_inv_props(&youmonst);
     update_inventory();
 }
 
@@ -269,6 +271,7 @@ void update_mon_intrinsics(struct level *lev, struct monst *mon, struct obj *obj
     int p = 0;
     boolean is_weapon = (obj->oclass == WEAPON_CLASS || is_weptool(obj));
 
+    reset_inv_props(mon);
     unseen = !canseemon(lev, mon);
 
     if (Is_gold_dragon_armor(obj->otyp)) {
@@ -416,6 +419,67 @@ void update_mon_intrinsics(struct level *lev, struct monst *mon, struct obj *obj
         newsym(mon->mx, mon->my);
 }
 
+/*
+ * Properties granted by the inventory of a monster (or of the hero), which
+ * resists_magm(), resists_blnd(), can_blnd() and mon_reflects() would
+ * otherwise have to search the whole inventory for on every call.  They are
+ * kept in mon->invprops until an item is added, removed, put on, taken off or
+ * wielded, which calls reset_inv_props() or obj_inv_props_changed().
+ */
+unsigned int inv_props(struct monst *mon)
+{
+    boolean is_you = (mon == &youmonst);
+    struct obj *wep, *o;
+    const char *s;
+    uchar props = INVP_KNOWN;
+
+    if (mon->invprops & INVP_KNOWN)
+        return mon->invprops;
+
+    wep = is_you ? uwep : MON_WEP(mon);
+    if (wep && wep->oartifact && defends(AD_MAGM, wep))
+        props |= INVP_ANTIMAGIC;
+    if (wep && wep->oartifact && defends(AD_BLND, wep))
+        props |= INVP_BLND_RES;
+    /* mon_reflects() is for monsters only; the hero has ureflects() */
+    if (is_you || (wep && (arti_reflects(wep) ||
+                           (wep->oprops & ITEM_REFLECTION))))
+        props |= INVP_REFLECT;
+
+    for (o = is_you ? invent : mon->minvent; o; o = o->nobj) {
+        if ((o->owornmask && objects[o->otyp].oc_oprop == ANTIMAGIC) ||
+            (o->oartifact && protects(AD_MAGM, o)))
+            props |= INVP_ANTIMAGIC;
+        if (o->oartifact && protects(AD_BLND, o))
+            props |= INVP_BLND_RES;
+        if ((o->owornmask & W_ARMH) &&
+            (s = OBJ_DESCR(objects[o->otyp])) != NULL &&
+            !strcmp(s, "visored helmet"))
+            props |= INVP_VISOR;
+        if ((o->owornmask & (W_ARMS | W_AMUL | W_ARMC | W_ARM | W_ARMU)) &&
+            ((o->oprops & ITEM_REFLECTION) ||
+             o->otyp == SHIELD_OF_REFLECTION ||
+             o->otyp == AMULET_OF_REFLECTION ||
+             o->otyp == SILVER_DRAGON_SCALES ||
+             o->otyp == SILVER_DRAGON_SCALE_MAIL ||
+             o->otyp == CHROMATIC_DRAGON_SCALES ||
+             o->otyp == CHROMATIC_DRAGON_SCALE_MAIL))
+            props |= INVP_REFLECT;
+    }
+
+    mon->invprops = props;
+    return props;
+}
+
+/* obj changed in a way inv_props() cares about; forget them for its owner */
+void obj_inv_props_changed(struct obj *obj)
+{
+    if (obj->where == OBJ_INVENT)
+        reset_inv_props(&youmonst);
+    else if (obj->where == OBJ_MINVENT)
+        reset_inv_props(obj->ocarry);
+}
+
 int find_mac(const struct monst *mon)
 {
     const struct obj *obj;
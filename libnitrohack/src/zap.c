@@ -484,6 +484,7 @@ struct monst *montraits(struct obj *obj, coord *cc)
         mtmp2->mux  = mtmp->mux;
         mtmp2->muy  = mtmp->muy;
         mtmp2->mw   = mtmp->mw;
+        reset_inv_props(mtmp2);
         mtmp2->wormno = mtmp->wormno;
         mtmp2->misc_worn_check = mtmp->misc_worn_check;
         mtmp2->weapon_check = mtmp->weapon_check;
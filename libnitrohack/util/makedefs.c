@@ -382,32 +382,60 @@ static boolean d_filter(char *line)
 
    /*
     *
-	New format (v3.1) of 'data' file which allows much faster lookups [pr]
+	Indexed format of the 'data' file, so that lookups don't have to
+	read through all the names in it:
 "do not edit"		first record is a comment line
 01234567		hexadecimal formatted offset to text area
-name-a			first name of interest
-123,4			offset to name's text, and number of lines for it
-name-b			next name of interest
-name-c			multiple names which share same description also
-456,7			share a single offset,count line
-.			sentinel to mark end of names
-789,0			dummy record containing offset, count of EOF
-text-a			4 lines of descriptive text for name-a
+646,41			number of names, number of them with wildcards
+*corpse	0,0,123,4	the names with a wildcard ('*' or '?') in the
+			order of data.base; after a tab follows the
+			position of the name in data.base, the entry it
+			belongs to and the offset and number of lines of
+			the entry's text
+acid blob	2,1,456,7	all other names, sorted by strcmp() so they can
+~name-c	5,3,789,2		be found with a binary search; a leading '~' is
+			ignored for sorting
+text-a			4 lines of descriptive text for the first entry
 text-a			at file position 0x01234567L + 123L
 text-a
 text-a
-text-b/text-c		7 lines of text for names-b and -c
-text-b/text-c		at fseek(0x01234567L + 456L)
+text-b/text-c		7 lines of text for the next entry
 ...
     *
     */
 
+struct data_key {
+	char	*name;
+	int	keyno, entry;
+	long	offset;
+	int	count;
+};
+
+static boolean d_wildcard(const char *name)
+{
+	return strchr(name, '*') || strchr(name, '?');
+}
+
+static int d_keycmp(const void *a, const void *b)
+{
+	const struct data_key *ka = a, *kb = b;
+	const char *na = ka->name, *nb = kb->name;
+	int cmp;
+
+	if (*na == '~') na++;
+	if (*nb == '~') nb++;
+	cmp = strcmp(na, nb);
+	return cmp ? cmp : ka->keyno - kb->keyno;
+}
+
 void do_data(const char *infile, const char *outfile)
 {
-	char	tempfile[256];
+	char	tempfile[256], *p;
 	boolean ok;
 	long	txt_offset;
-	int	entry_cnt, line_cnt;
+	int	i, key_cnt, wild_cnt, entry_cnt, line_cnt, entry_start;
+	struct data_key *keys = NULL;
+	int	max_keys = 0;
 
 	sprintf(tempfile, "%s.%s", outfile, "tmp");
 
@@ -428,33 +456,81 @@ void do_data(const char *infile, const char *outfile)
 		exit(EXIT_FAILURE);
 	}
 
-	/* output a dummy header record; we'll rewind and overwrite it later */
-	fprintf(ofp, "%s%08lx\n", Dont_Edit_Data, 0L);
-
-	entry_cnt = line_cnt = 0;
-	/* read through the input file and split it into two sections */
+	key_cnt = wild_cnt = entry_cnt = line_cnt = entry_start = 0;
+	/* read through the input file, collecting the names and saving the
+	 * text in the scratch file */
 	while (fgets(in_line, sizeof in_line, ifp)) {
 	    if (d_filter(in_line)) continue;
 	    if (*in_line > ' ') {	/* got an entry name */
 		/* first finish previous entry */
-		if (line_cnt)  fprintf(ofp, "%d\n", line_cnt),  line_cnt = 0;
-		/* output the entry name */
-		fputs(in_line, ofp);
-		entry_cnt++;		/* update number of entries */
-	    } else if (entry_cnt) {	/* got some descriptive text */
-		/* update previous entry with current text offset */
-		if (!line_cnt)  fprintf(ofp, "%ld,", ftell(tfp));
+		if (line_cnt) {
+		    for (i = entry_start; i < key_cnt; i++)
+			keys[i].count = line_cnt;
+		    entry_start = key_cnt;
+		    entry_cnt++;
+		    line_cnt = 0;
+		}
+		if ((p = strchr(in_line, '\n')) != 0) *p = '\0';
+		if (strchr(in_line, '\t')) {
+		    fprintf(stderr, "%s: tab in name \"%s\"\n", infile, in_line);
+		    exit(EXIT_FAILURE);
+		}
+		if (key_cnt == max_keys) {
+		    max_keys = max_keys ? max_keys * 2 : 512;
+		    keys = realloc(keys, max_keys * sizeof(struct data_key));
+		}
+		keys[key_cnt].name = strdup(in_line);
+		keys[key_cnt].keyno = key_cnt;
+		keys[key_cnt].entry = entry_cnt;
+		keys[key_cnt].offset = 0L;
+		keys[key_cnt].count = 0;
+		if (d_wildcard(in_line)) wild_cnt++;
+		key_cnt++;
+	    } else if (key_cnt) {	/* got some descriptive text */
+		/* update the entry's names with the current text offset */
+		if (!line_cnt)
+		    for (i = entry_start; i < key_cnt; i++)
+			keys[i].offset = ftell(tfp);
 		/* save the text line in the scratch file */
 		fputs(in_line, tfp);
 		line_cnt++;		/* update line counter */
 	    }
 	}
-	/* output an end marker and then record the current position */
-	if (line_cnt)  fprintf(ofp, "%d\n", line_cnt);
-	fprintf(ofp, ".\n%ld,%d\n", ftell(tfp), 0);
-	txt_offset = ftell(ofp);
+	/* names at the very end without any text point to the end of file */
+	if (!line_cnt)
+	    for (i = entry_start; i < key_cnt; i++)
+		keys[i].offset = ftell(tfp);
+	for (i = entry_start; i < key_cnt; i++)
+	    keys[i].count = line_cnt;
 	fclose(ifp);		/* all done with original input file */
 
+	/* wildcard names first, in their original order, then the rest
+	 * sorted; a stable partition keeps the wildcard order */
+	{
+	    struct data_key *sorted = malloc(key_cnt * sizeof(struct data_key));
+	    int nw = 0, nl = wild_cnt;
+
+	    for (i = 0; i < key_cnt; i++) {
+		if (d_wildcard(keys[i].name)) sorted[nw++] = keys[i];
+		else sorted[nl++] = keys[i];
+	    }
+	    qsort(&sorted[wild_cnt], key_cnt - wild_cnt,
+		  sizeof(struct data_key), d_keycmp);
+	    free(keys);
+	    keys = sorted;
+	}
+
+	/* output a dummy header record; we'll rewind and overwrite it later */
+	fprintf(ofp, "%s%08lx\n", Dont_Edit_Data, 0L);
+	fprintf(ofp, "%d,%d\n", key_cnt, wild_cnt);
+	for (i = 0; i < key_cnt; i++) {
+	    fprintf(ofp, "%s\t%d,%d,%ld,%d\n", keys[i].name, keys[i].keyno,
+		    keys[i].entry, keys[i].offset, keys[i].count);
+	    free(keys[i].name);
+	}
+	free(keys);
+	txt_offset = ftell(ofp);
+
 	/* reprocess the scratch file; 1st format an error msg, just in case */
 	sprintf(in_line, "rewind of \"%s\"", tempfile);
 	if (rewind(tfp) != 0)  goto dead_data;
@@ -796,6 +872,34 @@ void do_monstr(const char *outfile)
     /* might want to insert a final 0 entry here instead of just newline */
     fprintf(ofp,"%s};\n", (j & 15) ? "\n" : "");
 
+    /* attack and damage types of each monster, so that attacktype() and
+     * dmgtype() don't have to look at every attack.  Unused attack slots
+     * count as AT_NONE/AD_PHYS, just like they do there. */
+    fprintf(ofp,"\nconst unsigned int monattk_at[] = {\n");
+    for (ptr = &mons[0], j = 0; ptr->mlet; ptr++) {
+	unsigned int mask = 0;
+	for (i = 0; i < NATTK; i++) {
+	    int at = ptr->mattk[i].aatyp, ad = ptr->mattk[i].adtyp;
+	    if (!AT_HAS_BIT(at) || !AD_HAS_BIT(ad)) {
+		fprintf(stderr, "%s: attack %d/%d doesn't fit monattk_at/_ad\n",
+			ptr->mname, at, ad);
+		exit(EXIT_FAILURE);
+	    }
+	    mask |= AT_BIT(at);
+	}
+	fprintf(ofp,"0x%08xU,%c", mask, (++j & 7) ? ' ' : '\n');
+    }
+    fprintf(ofp,"%s};\n", (j & 7) ? "\n" : "");
+
+    fprintf(ofp,"\nconst unsigned long long monattk_ad[] = {\n");
+    for (ptr = &mons[0], j = 0; ptr->mlet; ptr++) {
+	unsigned long long mask = 0;
+	for (i = 0; i < NATTK; i++)
+	    mask |= AD_BIT(ptr->mattk[i].adtyp);
+	fprintf(ofp,"0x%016llxULL,%c", mask, (++j & 3) ? ' ' : '\n');
+    }
+    fprintf(ofp,"%s};\n", (j & 3) ? "\n" : "");
+
     fprintf(ofp,"\n/*monstr.c*/\n");
 
     fclose(ofp);
@@ -11,6 +11,10 @@ struct nhnet_server_version nhnet_server_ver;
 static int sockfd = -1;
 static int connection_id;
 static int net_active;
+static struct nhnet_zstream zstream; /* state for NHNET_CAP_COMPRESSION */
+/* bytes that arrived after the end of the last compressed frame */
+static char *pending;
+static int pending_len;
 int conn_err, error_retry_ok;
 
 /* Prevent automatic retries during connection setup or teardown.
@@ -99,8 +103,8 @@ static int send_json_msg(json_t *jmsg)
  *          - the parsed response from the server */
 static json_t *receive_json_msg(void)
 {
-    char *rbuf, *bp;
-    int datalen, ret, rbufsize;
+    char *rbuf, *bp, *msgstr;
+    int datalen, ret, rbufsize, framelen, have_data;
     json_t *recv_msg;
     json_error_t err;
     fd_set rfds;
@@ -110,45 +114,85 @@ static json_t *receive_json_msg(void)
     FD_SET(sockfd, &rfds);
     
     rbufsize = 1024 * 1024; /* initial size: 1MB */
+    while (rbufsize <= pending_len)
+	rbufsize *= 2;
     rbuf = malloc(rbufsize);
     memset(rbuf, 0, rbufsize);
     recv_msg = NULL;
     datalen = 0;
+    /* the previous read may already have received (part of) this message */
+    if (pending_len) {
+	memcpy(rbuf, pending, pending_len);
+	datalen = pending_len;
+	pending_len = 0;
+    }
+    have_data = datalen > 0;
     while (!recv_msg) {
-	/* select before reading so that we get a timeout. Otherwise the
-	 * program might hang indefinitely in read if the connection has failed */
-	tv.tv_sec = 10; /* 10s * 3 retries results in a long wait on failed connections... */
-	tv.tv_usec = 0;
-	ret = select(sockfd + 1, &rfds, NULL, NULL, &tv);
-	if (ret <= 0) {
-	    /* we aren't expecting any signals, so it seems ok to abort even if
-	     * ret == -1 && errno == EINTR */
-	    free(rbuf);
-	    return NULL;
-	}
-	
-	/* leave the last byte in the buffer free for the '\0' */
-	ret = recv(sockfd, &rbuf[datalen], rbufsize - datalen - 1, 0);
-	if (ret == -1 && errno == EINTR)
-	    continue;
-	else if (ret <= 0) {
-	    free(rbuf);
-	    return NULL;
+	if (!have_data) {
+	    /* select before reading so that we get a timeout. Otherwise the
+	     * program might hang indefinitely in read if the connection has
+	     * failed */
+	    tv.tv_sec = 10; /* 10s * 3 retries results in a long wait on failed connections... */
+	    tv.tv_usec = 0;
+	    ret = select(sockfd + 1, &rfds, NULL, NULL, &tv);
+	    if (ret <= 0) {
+		/* we aren't expecting any signals, so it seems ok to abort
+		 * even if ret == -1 && errno == EINTR */
+		free(rbuf);
+		return NULL;
+	    }
+	    
+	    /* leave the last byte in the buffer free for the '\0' */
+	    ret = recv(sockfd, &rbuf[datalen], rbufsize - datalen - 1, 0);
+	    if (ret == -1 && errno == EINTR)
+		continue;
+	    else if (ret <= 0) {
+		free(rbuf);
+		return NULL;
+	    }
+	    datalen += ret;
 	}
-	datalen += ret;
+	have_data = FALSE;
 	
-	rbuf[datalen] = '\0'; /* terminate the string */
-	bp = &rbuf[datalen - 1];
-	while (isspace((unsigned char)*bp))
-	    bp--;
-
-	recv_msg = NULL;
-	if (*bp == '}') { /* possibly the end of the json object */
-	    recv_msg = json_loads(rbuf, JSON_REJECT_DUPLICATES, &err);
-	    if (!recv_msg && err.position < datalen) {
-		print_error("Broken response received from server.");
+	/* compressed messages are binary frames; the end of the frame is known
+	 * from its header rather than from the json content */
+	if ((unsigned char)rbuf[0] == NHNET_FRAME_MARKER) {
+	    framelen = nhnet_frame_length((unsigned char*)rbuf, datalen);
+	    if (framelen && datalen >= framelen) {
+		msgstr = nhnet_decompress(&zstream, (unsigned char*)rbuf, framelen);
+		/* keep anything after the frame for the next call */
+		if (datalen > framelen) {
+		    pending_len = datalen - framelen;
+		    pending = realloc(pending, pending_len);
+		    memcpy(pending, &rbuf[framelen], pending_len);
+		}
 		free(rbuf);
-		return json_object();
+		if (!msgstr) {
+		    print_error("Broken compressed data received from server.");
+		    return json_object();
+		}
+		recv_msg = json_loads(msgstr, JSON_REJECT_DUPLICATES, &err);
+		free(msgstr);
+		if (!recv_msg) {
+		    print_error("Broken response received from server.");
+		    return json_object();
+		}
+		return recv_msg;
+	    }
+	} else {
+	    rbuf[datalen] = '\0'; /* terminate the string */
+	    bp = &rbuf[datalen - 1];
+	    while (isspace((unsigned char)*bp))
+		bp--;
+
+	    recv_msg = NULL;
+	    if (*bp == '}') { /* possibly the end of the json object */
+		recv_msg = json_loads(rbuf, JSON_REJECT_DUPLICATES, &err);
+		if (!recv_msg && err.position < datalen) {
+		    print_error("Broken response received from server.");
+		    free(rbuf);
+		    return json_object();
+		}
 	    }
 	}
 	
@@ -347,7 +391,7 @@ static int connect_server(const char *host, int port, int want_v4, char *errmsg,
 static int do_connect(const char *host, int port, const char *user, const char *pass,
 		      const char *email, int reg_user, int connid)
 {
-    int fd = -1, authresult;
+    int fd = -1, authresult, caps;
     char ipv6_error[120], ipv4_error[120], errmsg[256];
     json_t *jmsg, *jarr;
     
@@ -400,6 +444,9 @@ static int do_connect(const char *host, int port, const char *user, const char *
     
     in_connect_disconnect = TRUE;
     sockfd = fd;
+    /* the server starts a new compression history for every connection */
+    nhnet_zstream_reset(&zstream);
+    pending_len = 0;
     jmsg = json_pack("{ss,ss}", "username", user, "password", pass);
     if (reg_user) {
 	if (email)
@@ -408,6 +455,10 @@ static int do_connect(const char *host, int port, const char *user, const char *
     } else {
 	if (connid)
 	    json_object_set_new(jmsg, "reconnect", json_integer(connid));
+	caps = NHNET_CAP_BINARY_DISPLAY | NHNET_CAP_COMPRESSION;
+	if (windowprocs.win_play_animation)
+	    caps |= NHNET_CAP_ANIMATION;
+	json_object_set_new(jmsg, "caps", json_integer(caps));
 	jmsg = send_receive_msg("auth", jmsg);
     }
     in_connect_disconnect = FALSE;
@@ -19,6 +19,7 @@ static json_t *cmd_print_message(json_t *params, int display_only);
 static json_t *cmd_print_message_nonblocking(json_t *params, int display_only);
 static json_t *cmd_update_screen(json_t *params, int display_only);
 static json_t *cmd_delay_output(json_t *params, int display_only);
+static json_t *cmd_play_animation(json_t *params, int display_only);
 static json_t *cmd_level_changed(json_t *params, int display_only);
 static json_t *cmd_outrip(json_t *params, int display_only);
 static json_t *cmd_display_menu(json_t *params, int display_only);
@@ -43,6 +44,7 @@ struct netcmd netcmd_list[] = {
     {"print_message", cmd_print_message},
     {"update_screen", cmd_update_screen},
     {"delay_output", cmd_delay_output},
+    {"play_animation", cmd_play_animation},
     {"level_changed", cmd_level_changed},
     {"outrip", cmd_outrip},
     {"display_menu", cmd_display_menu},
@@ -301,6 +303,138 @@ static json_t *cmd_print_message_nonblocking(json_t *params, int display_only)
 }
 
 
+/*
+ * Decoding for binary display data (protocol extension 2). The server only
+ * sends it to clients that announce NHNET_CAP_BINARY_DISPLAY.
+ */
+#define DBUF_FORMAT	1
+#define DBUF_RUN_SAME	0
+#define DBUF_RUN_ZERO	1
+#define DBUF_RUN_CELLS	2
+#define DBUF_FIELDS	10
+
+static int b64value(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+
+/* returns the decoded length or -1 if the input is not valid base64 */
+static int base64_decode(const char *in, unsigned char *out)
+{
+    int i, len = 0, a, b, c, d;
+    
+    for (i = 0; in[i]; i += 4) {
+	if (!in[i+1] || !in[i+2] || !in[i+3])
+	    return -1;
+	a = b64value(in[i]);
+	b = b64value(in[i+1]);
+	c = in[i+2] == '=' ? 0 : b64value(in[i+2]);
+	d = in[i+3] == '=' ? 0 : b64value(in[i+3]);
+	if (a < 0 || b < 0 || c < 0 || d < 0)
+	    return -1;
+	out[len++] = (a << 2) | (b >> 4);
+	if (in[i+2] != '=')
+	    out[len++] = ((b & 15) << 4) | (c >> 2);
+	if (in[i+3] != '=')
+	    out[len++] = ((c & 3) << 6) | d;
+    }
+    return len;
+}
+
+
+static int get_varint(const unsigned char **pos, const unsigned char *end,
+		      unsigned int *val)
+{
+    int shift = 0;
+    
+    *val = 0;
+    while (*pos < end && shift < 32) {
+	*val |= (unsigned int)(**pos & 0x7f) << shift;
+	if (!(*(*pos)++ & 0x80))
+	    return TRUE;
+	shift += 7;
+    }
+    return FALSE;
+}
+
+
+static int get_dbe(const unsigned char **pos, const unsigned char *end,
+		   struct nh_dbuf_entry *dbe)
+{
+    int fields[DBUF_FIELDS];
+    unsigned int mask, val;
+    int i;
+    
+    if (!get_varint(pos, end, &mask))
+	return FALSE;
+    for (i = 0; i < DBUF_FIELDS; i++) {
+	fields[i] = 0;
+	if (mask & (1 << i)) {
+	    if (!get_varint(pos, end, &val))
+		return FALSE;
+	    fields[i] = (int)(val >> 1) ^ -(int)(val & 1); /* undo zigzag */
+	}
+    }
+    
+    dbe->effect = fields[0];
+    dbe->bg = fields[1];
+    dbe->trap = fields[2];
+    dbe->obj = fields[3];
+    dbe->obj_mn = fields[4];
+    dbe->objflags = fields[5];
+    dbe->mon = fields[6];
+    dbe->monflags = fields[7];
+    dbe->invis = fields[8];
+    dbe->dgnflags = fields[9];
+    return TRUE;
+}
+
+
+static int decode_dbuf(const char *str, struct nh_dbuf_entry dbuf[ROWNO][COLNO])
+{
+    unsigned char *bin = malloc(strlen(str) / 4 * 3 + 3);
+    const unsigned char *pos, *end;
+    unsigned int header, count, kind;
+    int len, i = 0;
+    
+    len = base64_decode(str, bin);
+    if (len < 1 || bin[0] != DBUF_FORMAT) {
+	free(bin);
+	return FALSE;
+    }
+    
+    pos = bin + 1;
+    end = bin + len;
+    while (pos < end && i < ROWNO * COLNO) {
+	if (!get_varint(&pos, end, &header))
+	    break;
+	count = header >> 2;
+	kind = header & 3;
+	if (count > ROWNO * COLNO - i)
+	    break;
+	
+	for (; count > 0; count--, i++) {
+	    if (kind == DBUF_RUN_ZERO)
+		memset(&dbuf[i % ROWNO][i / ROWNO], 0, sizeof(struct nh_dbuf_entry));
+	    else if (kind == DBUF_RUN_CELLS &&
+		     !get_dbe(&pos, end, &dbuf[i % ROWNO][i / ROWNO]))
+		break;
+	}
+	if (count > 0)
+	    break;
+    }
+    
+    free(bin);
+    return i == ROWNO * COLNO && pos == end;
+}
+
+
 static json_t *cmd_update_screen(json_t *params, int display_only)
 {
     static struct nh_dbuf_entry dbuf[ROWNO][COLNO];
@@ -323,6 +457,14 @@ static json_t *cmd_update_screen(json_t *params, int display_only)
 	return NULL;
     }
     
+    if (json_is_string(jdbuf)) {
+	if (decode_dbuf(json_string_value(jdbuf), dbuf))
+	    cur_wndprocs.win_update_screen(dbuf, ux, uy);
+	else
+	    print_error("Bad binary data in cmd_update_screen");
+	return NULL;
+    }
+    
     if (!json_is_array(jdbuf)) {
 	print_error("Incorrect parameter in cmd_update_screen");
 	return NULL;
@@ -386,6 +528,76 @@ static json_t *cmd_delay_output(json_t *params, int display_only)
 }
 
 
+static json_t *cmd_play_animation(json_t *params, int display_only)
+{
+    struct nh_anim_frame *frames;
+    struct nh_anim_cell *cells, *cell;
+    int ux, uy, i, j, nframes, ncells, cellcount, x, y;
+    int effect, bg, trap, obj, obj_mn, objflags, mon, monflags, invis, dgnflags;
+    json_t *jframes, *jframe;
+    
+    if (json_unpack(params, "{si,si,so!}", "ux", &ux, "uy", &uy,
+		    "frames", &jframes) == -1 || !json_is_array(jframes)) {
+	print_error("Incorrect parameters in cmd_play_animation");
+	return NULL;
+    }
+    
+    nframes = json_array_size(jframes);
+    ncells = 0;
+    for (i = 0; i < nframes; i++) {
+	jframe = json_array_get(jframes, i);
+	if (!json_is_array(jframe) || json_array_size(jframe) < 1) {
+	    print_error("Incorrect frame data in cmd_play_animation");
+	    return NULL;
+	}
+	ncells += json_array_size(jframe) - 1;
+    }
+    
+    frames = malloc(nframes * sizeof(struct nh_anim_frame) + 1);
+    cells = malloc(ncells * sizeof(struct nh_anim_cell) + 1);
+    ncells = 0;
+    for (i = 0; i < nframes; i++) {
+	jframe = json_array_get(jframes, i);
+	frames[i].delay = json_integer_value(json_array_get(jframe, 0));
+	frames[i].first_cell = ncells;
+	cellcount = json_array_size(jframe) - 1;
+	for (j = 0; j < cellcount; j++) {
+	    if (json_unpack(json_array_get(jframe, j + 1),
+			    "[i,i,i,i,i,i,i,i,i,i,i,i!]", &x, &y, &effect, &bg,
+			    &trap, &obj, &obj_mn, &objflags, &mon, &monflags,
+			    &invis, &dgnflags) == -1 ||
+		x < 0 || x >= COLNO || y < 0 || y >= ROWNO) {
+		print_error("Strange cell data in cmd_play_animation");
+		continue;
+	    }
+	    cell = &cells[ncells++];
+	    cell->x = x;
+	    cell->y = y;
+	    cell->dbe.effect = effect;
+	    cell->dbe.bg = bg;
+	    cell->dbe.trap = trap;
+	    cell->dbe.obj = obj;
+	    cell->dbe.obj_mn = obj_mn;
+	    cell->dbe.objflags = objflags;
+	    cell->dbe.mon = mon;
+	    cell->dbe.monflags = monflags;
+	    cell->dbe.invis = invis;
+	    cell->dbe.dgnflags = dgnflags;
+	}
+	frames[i].cell_count = ncells - frames[i].first_cell;
+    }
+    
+    /* the server follows up with update_screen, so there is nothing to do
+     * here for window procs that can't animate */
+    if (cur_wndprocs.win_play_animation)
+	cur_wndprocs.win_play_animation(frames, nframes, cells, ux, uy);
+    
+    free(frames);
+    free(cells);
+    return NULL;
+}
+
+
 static json_t *cmd_level_changed(json_t *params, int display_only)
 {
     if (!json_is_integer(params)) {
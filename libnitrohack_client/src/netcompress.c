@@ -0,0 +1,326 @@
+/* The DynaHack client lib may be freely redistributed under the terms of either:
+ *  - the NetHack license
+ *  - the GNU General Public license v2 or later
+ */
+
+/*
+ * Stream compression for server messages (protocol extension 4).
+ *
+ * This is a plain LZ77 coder. Matches may refer back into everything the
+ * connection has sent so far (up to NHNET_Z_HISTORY bytes), so the keys and
+ * item lists that make up most messages compress to a few bytes after their
+ * first appearance. The history of a new connection starts out as a fixed
+ * dictionary of common message fragments so that even the first messages
+ * benefit.
+ *
+ * The compressor keeps its hash chains from one message to the next and only
+ * adds the new bytes to them, so a message costs time in proportion to its
+ * own length rather than to the size of the history.
+ *
+ * This file is shared between the client library and the server.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nitrohack_client.h"
+
+#define MIN_MATCH	4
+#define HASH_BITS	14
+#define MAX_CHAIN	16
+
+/* Both sides must use exactly the same dictionary. Changing it requires a
+ * new capability bit. */
+static const char z_dictionary[] =
+    "{\"display\":[{\"update_screen\":{\"ux\":0,\"uy\":0,\"dbuf\":[1,1,1,1,"
+    "[0,0,0,0,0,0,0,0,0,0],0,0,0,0]}},{\"print_message\":{\"turn\":1,\"msg\":\""
+    "\"}},{\"update_status\":{\"plname\":\"\",\"coinsym\":36,\"race_adj\":\"\","
+    "\"max_rank_sz\":0,\"rank\":\"\",\"levdesc_dlvl\":\"Dlvl:1\","
+    "\"levdesc_short\":\"\",\"levdesc_full\":\"\",\"x\":1,\"y\":1,\"z\":1,"
+    "\"score\":0,\"xp\":1,\"xp_next\":20,\"gold\":0,\"moves\":1,\"wt\":0,"
+    "\"wtcap\":0,\"invslots\":0,\"st\":18,\"st_extra\":0,\"dx\":18,\"co\":18,"
+    "\"in\":18,\"wi\":18,\"ch\":18,\"align\":0,\"hp\":16,\"hpmax\":16,\"en\":5,"
+    "\"enmax\":5,\"ac\":10,\"level\":1,\"monnum\":0,\"cur_monnum\":0,"
+    "\"can_enhance\":0,\"statusitems\":[]}},{\"list_items\":{\"items\":["
+    "[\"\",0,0,1,0,0,0,0,0,0,0,0]],\"icount\":0,\"invent\":true}},"
+    "{\"display_objects\":{\"items\":[],\"icount\":0,\"how\":0,\"title\":\"\"}},"
+    "{\"display_menu\":{\"items\":[{\"caption\":\"\",\"id\":0,\"role\":0,"
+    "\"accel\":0,\"group_accel\":0,\"selected\":false}],\"icount\":0,"
+    "\"how\":0,\"title\":\"\"}},{\"display_buffer\":{\"buf\":\"\",\"trymove\":0}},"
+    "{\"delay_output\":{}},{\"level_changed\":0},{\"play_animation\":"
+    "{\"frames\":[]}},{\"print_message_nonblocking\":{\"turn\":1,\"msg\":\"\"}}],"
+    "\"game_command\":{\"return\":0}}{\"query_key\":{\"query\":\"\","
+    "\"allow_count\":false}}{\"getpos\":{\"goal\":\"\",\"force\":0,\"x\":0,"
+    "\"y\":0}}{\"getdir\":{\"query\":\"\",\"restricted\":0}}{\"yn\":{\"query\":"
+    "\"\",\"set\":\"ynq\",\"def\":110}}{\"getline\":{\"query\":\"\"}}"
+    "{\"get_drawing_info\":{\"bgelements\":[],\"traps\":[],\"objects\":[],"
+    "\"monsters\":[],\"warnings\":[],\"invis\":[],\"effects\":[],\"expltypes\":"
+    "[],\"explsyms\":[],\"zaptypes\":[],\"zapsyms\":[],\"swallowsyms\":[],"
+    "\"feature\":[]}}You see here .  You hit the  The  misses the  hits!";
+
+
+static unsigned int z_hash(const unsigned char *p)
+{
+    unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+static unsigned char *z_put_varint(unsigned char *out, unsigned int val)
+{
+    while (val >= 0x80) {
+	*out++ = (val & 0x7f) | 0x80;
+	val >>= 7;
+    }
+    *out++ = val;
+    return out;
+}
+
+
+static int z_get_varint(const unsigned char **pos, const unsigned char *end,
+			unsigned int *val)
+{
+    int shift = 0;
+
+    *val = 0;
+    while (*pos < end && shift < 32) {
+	*val |= (unsigned int)(**pos & 0x7f) << shift;
+	if (!(*(*pos)++ & 0x80))
+	    return 1;
+	shift += 7;
+    }
+    return 0;
+}
+
+
+/* make room for len more bytes after the history */
+static void z_reserve(struct nhnet_zstream *zs, int len)
+{
+    if (zs->start + zs->histlen + len > zs->bufsize) {
+	zs->bufsize = zs->start + zs->histlen + len;
+	zs->buf = realloc(zs->buf, zs->bufsize);
+    }
+}
+
+
+/* add the positions in buf before upto to the hash chains */
+static void z_insert(struct nhnet_zstream *zs, int upto)
+{
+    unsigned int h;
+
+    for (; zs->hashed < upto; zs->hashed++) {
+	h = z_hash(&zs->buf[zs->hashed]);
+	zs->chain[zs->hashed] = zs->head[h];
+	zs->head[h] = zs->hashed;
+    }
+}
+
+
+/*
+ * Compressor version of z_slide: the history start moves forward without
+ * copying anything. Only once a whole history's worth of dead bytes has
+ * piled up in front of it are the buffer and the chains moved down, so
+ * this costs O(1) per byte of input.
+ */
+static void z_slide_chains(struct nhnet_zstream *zs, int total)
+{
+    int shift, i;
+
+    if (total - zs->start > NHNET_Z_HISTORY)
+	zs->start = total - NHNET_Z_HISTORY;
+    zs->histlen = total - zs->start;
+    if (zs->start < NHNET_Z_HISTORY)
+	return;
+
+    shift = zs->start;
+    memmove(zs->buf, zs->buf + shift, zs->histlen);
+    for (i = 0; i < (1 << HASH_BITS); i++)
+	zs->head[i] = zs->head[i] >= shift ? zs->head[i] - shift : -1;
+    for (i = shift; i < zs->hashed; i++)
+	zs->chain[i - shift] = zs->chain[i] >= shift ? zs->chain[i] - shift : -1;
+    zs->hashed -= shift;
+    zs->start = 0;
+}
+
+
+/* the last NHNET_Z_HISTORY bytes of the stream become the new history */
+static void z_slide(struct nhnet_zstream *zs, int total)
+{
+    if (total > NHNET_Z_HISTORY) {
+	memmove(zs->buf, zs->buf + total - NHNET_Z_HISTORY, NHNET_Z_HISTORY);
+	total = NHNET_Z_HISTORY;
+    }
+    zs->histlen = total;
+}
+
+
+void nhnet_zstream_reset(struct nhnet_zstream *zs)
+{
+    int i;
+
+    zs->histlen = zs->start = zs->hashed = 0;
+    z_reserve(zs, sizeof(z_dictionary) - 1);
+    memcpy(zs->buf, z_dictionary, sizeof(z_dictionary) - 1);
+    zs->histlen = sizeof(z_dictionary) - 1;
+    if (zs->head)
+	for (i = 0; i < (1 << HASH_BITS); i++)
+	    zs->head[i] = -1;
+}
+
+
+void nhnet_zstream_free(struct nhnet_zstream *zs)
+{
+    free(zs->buf);
+    free(zs->head);
+    free(zs->chain);
+    memset(zs, 0, sizeof(struct nhnet_zstream));
+}
+
+
+/*
+ * Compress len bytes of data into a complete frame (header included).
+ * The returned buffer must be freed by the caller.
+ */
+unsigned char *nhnet_compress(struct nhnet_zstream *zs, const char *data,
+			      int len, int *framelen)
+{
+    unsigned char *frame, *out, *buf;
+    int pos, lit_start, total, cand, depth, l, best_len, best_dist, i, paylen;
+    int hashlim;
+
+    z_reserve(zs, len);
+    buf = zs->buf;
+    pos = zs->start + zs->histlen;
+    memcpy(buf + pos, data, len);
+    total = pos + len;
+
+    if (zs->chainsize < zs->bufsize) {
+	zs->chainsize = zs->bufsize;
+	zs->chain = realloc(zs->chain, zs->chainsize * sizeof(int));
+    }
+    if (!zs->head) {
+	zs->head = malloc((1 << HASH_BITS) * sizeof(int));
+	for (i = 0; i < (1 << HASH_BITS); i++)
+	    zs->head[i] = -1;
+    }
+    /* the chains already hold the history except for its last few bytes,
+     * which had no successors until now */
+    hashlim = total - MIN_MATCH + 1; /* later positions can't be hashed yet */
+    z_insert(zs, pos < hashlim ? pos : hashlim);
+
+    /* worst case: a far-away 4 byte match costs up to 6 bytes */
+    frame = malloc(NHNET_FRAME_HEADER + 16 + 2 * len);
+    out = frame + NHNET_FRAME_HEADER;
+    out = z_put_varint(out, len);
+
+    lit_start = pos;
+    while (pos + MIN_MATCH <= total) {
+	z_insert(zs, pos);
+	best_len = best_dist = 0;
+	/* the chains may still lead to bytes before the history */
+	for (cand = zs->head[z_hash(&buf[pos])], depth = 0;
+	     cand >= zs->start && depth < MAX_CHAIN;
+	     cand = zs->chain[cand], depth++) {
+	    for (l = 0; pos + l < total && buf[cand + l] == buf[pos + l]; l++)
+		;
+	    if (l > best_len) {
+		best_len = l;
+		best_dist = pos - cand;
+	    }
+	}
+
+	if (best_len < MIN_MATCH) {
+	    pos++;
+	    continue;
+	}
+
+	out = z_put_varint(out, pos - lit_start);
+	memcpy(out, &buf[lit_start], pos - lit_start);
+	out += pos - lit_start;
+	out = z_put_varint(out, best_len - MIN_MATCH);
+	out = z_put_varint(out, best_dist);
+	pos += best_len;
+	lit_start = pos;
+    }
+    if (lit_start < total) {
+	out = z_put_varint(out, total - lit_start);
+	memcpy(out, &buf[lit_start], total - lit_start);
+	out += total - lit_start;
+    }
+
+    z_insert(zs, hashlim);
+    z_slide_chains(zs, total);
+
+    paylen = out - frame - NHNET_FRAME_HEADER;
+    frame[0] = NHNET_FRAME_MARKER;
+    frame[1] = (paylen >> 24) & 0xff;
+    frame[2] = (paylen >> 16) & 0xff;
+    frame[3] = (paylen >> 8) & 0xff;
+    frame[4] = paylen & 0xff;
+    *framelen = out - frame;
+    return frame;
+}
+
+
+/*
+ * Returns the full length of the frame starting at buf, or 0 if not enough
+ * of it has arrived to tell.
+ */
+int nhnet_frame_length(const unsigned char *buf, int len)
+{
+    if (len < NHNET_FRAME_HEADER)
+	return 0;
+    return NHNET_FRAME_HEADER + (int)(((unsigned int)buf[1] << 24) |
+				      (buf[2] << 16) | (buf[3] << 8) | buf[4]);
+}
+
+
+/*
+ * Decompress one complete frame. Returns a nul-terminated string which must
+ * be freed by the caller, or NULL if the data is corrupt.
+ */
+char *nhnet_decompress(struct nhnet_zstream *zs, const unsigned char *frame,
+		       int framelen)
+{
+    const unsigned char *pos = frame + NHNET_FRAME_HEADER,
+			*end = frame + framelen;
+    unsigned char *buf;
+    unsigned int rawlen, lits, mlen, dist;
+    int out, total;
+    char *str;
+
+    if (!z_get_varint(&pos, end, &rawlen) || rawlen > 16 * 1024 * 1024)
+	return NULL;
+
+    z_reserve(zs, rawlen);
+    buf = zs->buf;
+    out = zs->histlen;
+    total = zs->histlen + rawlen;
+    while (out < total) {
+	if (!z_get_varint(&pos, end, &lits) || lits > total - out ||
+	    lits > end - pos)
+	    return NULL;
+	memcpy(&buf[out], pos, lits);
+	pos += lits;
+	out += lits;
+	if (out == total)
+	    break;
+
+	if (!z_get_varint(&pos, end, &mlen) || !z_get_varint(&pos, end, &dist))
+	    return NULL;
+	mlen += MIN_MATCH;
+	if (dist == 0 || dist > out || mlen > total - out)
+	    return NULL;
+	/* byte by byte: the match may overlap the bytes it produces */
+	for (; mlen > 0; mlen--, out++)
+	    buf[out] = buf[out - dist];
+    }
+    if (pos != end)
+	return NULL;
+
+    str = malloc(rawlen + 1);
+    memcpy(str, &buf[zs->histlen], rawlen);
+    str[rawlen] = '\0';
+    z_slide(zs, total);
+    return str;
+}
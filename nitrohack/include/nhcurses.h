@@ -367,6 +367,8 @@ extern const char **get_logo(nh_bool large);
 /* map.c */
 extern int get_map_key(int place_cursor);
 extern void curses_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, int uy);
+extern void curses_play_animation(struct nh_anim_frame *frames, int nframes,
+				  struct nh_anim_cell *cells, int ux, int uy);
 extern int curses_getpos(int *x, int *y, nh_bool force, const char *goal);
 extern void draw_map(int cx, int cy);
 
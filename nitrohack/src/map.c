@@ -9,6 +9,9 @@ struct coord {
 };
 
 static struct nh_dbuf_entry (*display_buffer)[COLNO] = NULL;
+/* the map as it was last shown outside of an animation */
+static struct nh_dbuf_entry shown_buffer[ROWNO][COLNO];
+static struct nh_dbuf_entry anim_buffer[ROWNO][COLNO];
 static const int xdir[DIR_SELF+1] = { -1,-1, 0, 1, 1, 1, 0,-1, 0, 0 };
 static const int ydir[DIR_SELF+1] = {  0,-1,-1,-1, 0, 1, 1, 1, 0, 0 };
 
@@ -38,6 +41,10 @@ int get_map_key(int place_cursor)
 void curses_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, int uy)
 {
     display_buffer = dbuf;
+    /* In local play dbuf is the game's own display buffer, which already
+     * holds the state after an animation by the time it is played. */
+    if (dbuf != anim_buffer)
+	memcpy(shown_buffer, dbuf, sizeof(shown_buffer));
     draw_map(ux, uy);
     
     if (ux > 0) {
@@ -49,6 +56,36 @@ void curses_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, int u
 }
 
 
+/*
+ * Play a batch of animation frames on top of the map as it was shown before
+ * the animation started.  The frames are drawn into a scratch copy of that
+ * map, and the live display buffer is shown again once the animation is over.
+ */
+void curses_play_animation(struct nh_anim_frame *frames, int nframes,
+			   struct nh_anim_cell *cells, int ux, int uy)
+{
+    struct nh_dbuf_entry (*map_buffer)[COLNO] = display_buffer;
+    struct nh_anim_cell *cell;
+    int i, j;
+
+    if (!map_buffer)
+	return;
+
+    memcpy(anim_buffer, shown_buffer, sizeof(anim_buffer));
+    for (i = 0; i < nframes; i++) {
+	for (j = 0; j < frames[i].cell_count; j++) {
+	    cell = &cells[frames[i].first_cell + j];
+	    anim_buffer[cell->y][cell->x] = cell->dbe;
+	}
+	curses_update_screen(anim_buffer, ux, uy);
+	for (j = 0; j < frames[i].delay; j++)
+	    curses_delay_output();
+    }
+
+    curses_update_screen(map_buffer, ux, uy);
+}
+
+
 void draw_map(int cx, int cy)
 {
     int x, y, symcount, cursx, cursy;
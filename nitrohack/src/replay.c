@@ -33,6 +33,7 @@ static struct nh_window_procs curses_replay_windowprocs = {
     curses_notify_level_changed,
     curses_outrip,
     curses_print_message_nonblocking,
+    NULL, /* replays don't animate */
 };
 
 
@@ -131,8 +132,9 @@ static void timetest(int fd, struct nh_replay_info *rinfo)
     draw_msgwin();
     gettime(&t_end);
     ms = clock_delta_ms(&t_start, &t_end);
-    snprintf(buf, BUFSZ, "%d actions replayed with display in %ld ms. (%ld actions/sec)",
-	     rinfo->max_actions, ms, rinfo->max_actions * 1000 / ms);
+    snprintf(buf, BUFSZ, "%d actions (%d turns) replayed with display in %ld ms. "
+	     "(%ld actions/sec, %ld us/turn)", rinfo->max_actions, rinfo->moves,
+	     ms, rinfo->max_actions * 1000 / ms, ms * 1000 / max(rinfo->moves, 1));
     curses_msgwin(buf);
     
     /* reset the entire replay state to delete checkpoints */
@@ -145,8 +147,9 @@ static void timetest(int fd, struct nh_replay_info *rinfo)
     nh_view_replay_step(rinfo, REPLAY_GOTO, mmax);
     gettime(&t_end);
     ms = clock_delta_ms(&t_start, &t_end);
-    snprintf(buf, BUFSZ, "%d actions replayed without display in %ld ms. (%ld actions/sec)",
-	     rinfo->actions, ms, rinfo->actions * 1000 / ms);
+    snprintf(buf, BUFSZ, "%d actions (%d turns) replayed without display in %ld ms. "
+	     "(%ld actions/sec, %ld us/turn)", rinfo->actions, rinfo->moves,
+	     ms, rinfo->actions * 1000 / ms, ms * 1000 / max(rinfo->moves, 1));
     curses_msgwin(buf);
     
     /* run backward */
@@ -42,6 +42,7 @@ struct nh_window_procs curses_windowprocs = {
     curses_notify_level_changed,
     curses_outrip,
     curses_print_message_nonblocking,
+    curses_play_animation,
 };
 
 /*----------------------------------------------------------------------------*/
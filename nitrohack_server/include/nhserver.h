@@ -42,6 +42,18 @@
 # define DEFAULT_CLIENT_TIMEOUT (15 * 60) /* 15 minutes */
 #endif
 
+#if !defined(DEFAULT_SPARE_PROCESSES)
+# define DEFAULT_SPARE_PROCESSES 2
+#endif
+
+#if !defined(DEFAULT_HIBERNATE_TIMEOUT)
+# define DEFAULT_HIBERNATE_TIMEOUT (2 * 60) /* 2 minutes */
+#endif
+
+#if !defined(DEFAULT_DB_FLUSH_INTERVAL)
+# define DEFAULT_DB_FLUSH_INTERVAL 10 /* seconds */
+#endif
+
 
 struct settings {
     char *logfile;
@@ -50,8 +62,12 @@ struct settings {
     struct sockaddr_in  bind_addr_4;
     struct sockaddr_in6 bind_addr_6;
     struct sockaddr_un  bind_addr_unix;
+    struct sockaddr_un  metrics_addr;
     int port;
     int client_timeout;
+    int spare_processes;
+    int hibernate_timeout;
+    int db_flush_interval;
     char nodaemon;
     char disable_ipv4;
     char disable_ipv6;
@@ -73,10 +89,39 @@ struct client_command {
 };
 
 
+/* counters and gauges in the shared metrics region */
+enum metric_counter {
+    MC_CONNECTIONS,
+    MC_GAMES_STARTED,
+    MC_SPARE_HANDOFFS,
+    MC_HIBERNATIONS,
+    MC_RELAY_IN_BYTES,
+    MC_RELAY_OUT_BYTES,
+    MC_RELAY_OUT_BURSTS,
+    MC_CLIENTS_CONNECTED,
+    MC_CLIENTS_DISCONNECTED,
+    MC_COUNT
+};
+
+/* latency histograms; MH_COMMAND + i is the histogram for clientcmd[i] */
+enum metric_hist_id {
+    MH_SAVE,
+    MH_ENCODE,
+    MH_DB,
+    MH_COMMAND
+};
+
+
+/* GAME_STATUS_UNKNOWN: the games table has no cached status for this game */
+#define GAME_STATUS_UNKNOWN (-100)
+
 struct gamefile_info {
     int gid;
     const char *filename;
     const char *username;
+    int status; /* enum nh_log_status or GAME_STATUS_UNKNOWN */
+    int done;
+    struct nh_game_info gi; /* cached in the games table */
 };
 
 
@@ -87,6 +132,7 @@ extern struct user_info user_info;
 extern struct nh_window_procs server_windowprocs, server_alt_windowprocs;
 extern int termination_flag, sigsegv_flag;
 extern int gamefd;
+extern int client_caps;
 extern long gameid;
 extern const struct client_command clientcmd[];
 extern struct nh_player_info player_info;
@@ -94,11 +140,17 @@ extern struct nh_player_info player_info;
 /*---------------------------------------------------------------------------*/
 
 /* auth.c */
-extern int auth_user(char *authbuf, const char *peername, int *is_reg, int *reconnect_id);
+extern int auth_user(char *authbuf, const char *peername, int *is_reg,
+		     int *reconnect_id, int *caps);
 extern void auth_send_result(int sockfd, enum authresult, int is_reg, int connid);
 
+/* clientcmd.c */
+extern int store_game_status(int gid, int fd);
+
 /* clientmain.c */
-extern void client_main(int userid, int infd, int outfd);
+extern void client_main(int userid, int caps, int infd, int outfd);
+extern void spare_main(int sock);
+extern int rebuild_game_metadata(void);
 extern void exit_client(const char *err);
 extern void client_msg(const char *key, json_t *value);
 extern json_t *read_input(void);
@@ -123,13 +175,19 @@ extern long db_add_new_game(int uid, const char *filename, const char *role,
 			    const char *race, const char *gend, const char *align,
 			    int mode, const char *plname, const char *levdesc);
 extern void db_update_game(int gameid, int moves, int depth, const char *levdesc);
+extern void db_flush_updates(void);
+extern int db_flush_delay(void);
 extern int db_get_game_filename(int uid, int gid, char *namebuf, int buflen);
 extern void db_delete_game(int uid, int gid);
+extern void db_set_game_status(int gid, int status, const struct nh_game_info *gi);
 extern struct gamefile_info *db_list_games(int completed, int uid, int limit, int *count);
+extern struct gamefile_info *db_list_all_games(int *count);
 extern void db_set_option(int uid, const char *optname, int type, const char *optval);
 extern void db_restore_options(int uid);
-extern void db_add_topten_entry(int gid, int points, int hp, int maxhp, int deaths,
-			int end_how, const char *death, const char *entrytxt);
+extern void db_add_topten_entry(int gid, const struct nh_topten_entry *tte);
+extern int db_get_topten_rank(int gid, char *plname, int plname_len);
+extern struct nh_topten_entry *db_get_topten(const char *player, int top,
+			int around, int own, int highlight_gid, int *count);
 
 /* kill.c */
 extern int create_pidfile(void);
@@ -144,10 +202,21 @@ extern void end_logging(void);
 extern void report_startup(void);
 extern const char *addr2str(const void *sockaddr);
 
+/* metrics.c */
+extern int init_metrics(void);
+extern void end_metrics(void);
+extern unsigned long long metrics_now(void);
+extern void metrics_add(enum metric_counter counter, unsigned long long n);
+extern void metrics_set(enum metric_counter counter, unsigned long long val);
+extern void metrics_record(int hist, unsigned long long start);
+extern void metrics_save_timer(nh_bool done);
+extern void metrics_socket_event(int server_fd, int epfd);
+extern int metrics_conn_event(int fd, int epfd, unsigned int event_mask);
+
 /* miscsetup.c */
 extern void setup_signals(void);
 extern int init_workdir(void);
-extern int remove_unix_socket(void);
+extern int remove_unix_socket(const struct sockaddr_un *addr);
 
 /* server.c */
 extern int runserver(void);
@@ -39,10 +39,11 @@ static int is_valid_username(const char *name)
 }
 
 
-int auth_user(char *authbuf, const char *peername, int *is_reg, int *reconnect_id)
+int auth_user(char *authbuf, const char *peername, int *is_reg,
+	      int *reconnect_id, int *caps)
 {
     json_error_t err;
-    json_t *obj, *cmd, *name, *pass, *email, *reconn;
+    json_t *obj, *cmd, *name, *pass, *email, *reconn, *jcaps;
     const char *namestr, *passstr, *emailstr;
     int userid = 0;
    
@@ -65,6 +66,7 @@ int auth_user(char *authbuf, const char *peername, int *is_reg, int *reconnect_i
     pass = json_object_get(cmd, "password");
     email = json_object_get(cmd, "email"); /* is null for auth */
     reconn = json_object_get(cmd, "reconnect");
+    jcaps = json_object_get(cmd, "caps"); /* optional protocol features */
     
     if (!name || !pass)
 	goto err;
@@ -77,6 +79,9 @@ int auth_user(char *authbuf, const char *peername, int *is_reg, int *reconnect_i
 	goto err;
     
     *reconnect_id = 0;
+    *caps = 0;
+    if (jcaps && json_is_integer(jcaps))
+	*caps = json_integer_value(jcaps) & NHNET_CAP_ALL;
     if (!*is_reg) {
 	if (reconn && json_is_integer(reconn))
 	    *reconnect_id = json_integer_value(reconn);
@@ -29,6 +29,10 @@ static void ccmd_get_root_pl_prompt(json_t *params);
 static void ccmd_set_email(json_t *params);
 static void ccmd_set_password(json_t *params);
 
+/* the game that ended last in this process; it is highlighted in the high
+ * score list */
+static int topten_gid;
+
 const struct client_command clientcmd[] = {
     {"shutdown",	ccmd_shutdown},
     
@@ -89,6 +93,7 @@ static void ccmd_start_game(json_t *params)
     
     /* reset cached display data from a previous game */
     reset_cached_diplaydata();
+    topten_gid = 0;
     
     if (mode == MODE_WIZARD && !user_info.can_debug)
 	mode = MODE_EXPLORE;
@@ -113,6 +118,7 @@ static void ccmd_start_game(json_t *params)
 				 ri->racenames[race], ri->gendnames[gend],
 				 ri->alignnames[align], mode, name,
 				 player_info.levdesc_dlvl);
+	db_set_game_status(gameid, LS_IN_PROGRESS, NULL);
 	log_msg("%s has started a new game (%d) as %s",
 		user_info.username, gameid, name);
 	j_msg = json_pack("{si,si}", "return", ret, "gameid", gameid);
@@ -130,6 +136,7 @@ static void ccmd_restore_game(json_t *params)
 {
     int gid, fd, status;
     char filename[1024], basename[1024];
+    unsigned long long start = metrics_now();
     
     if (json_unpack(params, "{si*}", "gameid", &gid) == -1)
 	exit_client("Bad set of parameters for restore_game");
@@ -148,6 +155,7 @@ static void ccmd_restore_game(json_t *params)
     
     /* reset cached display data from a previous game */
     reset_cached_diplaydata();
+    topten_gid = 0;
     
     status = nh_restore_game(fd, NULL, FALSE);
     if (status == ERR_REPLAY_FAILED) {
@@ -165,7 +173,10 @@ static void ccmd_restore_game(json_t *params)
 	gameid = gid;
 	gamefd = fd;
 	db_update_game(gameid, player_info.moves, player_info.z, player_info.levdesc_dlvl);
-	log_msg("%s has restored game %d", user_info.username, gameid);
+	db_set_game_status(gameid, LS_IN_PROGRESS, NULL);
+	/* this is the time a hibernated game takes to come back */
+	log_msg("%s has restored game %d in %llu ms", user_info.username,
+		gameid, (metrics_now() - start) / 1000);
     }
 }
 
@@ -180,6 +191,8 @@ static void ccmd_exit_game(json_t *params)
     status = nh_exit_game(etype);
     if (status) {
 	db_update_game(gameid, player_info.moves, player_info.z, player_info.levdesc_dlvl);
+	db_flush_updates();
+	store_game_status(gameid, gamefd);
 	log_msg("%s has closed game %d", user_info.username, gameid);
 	gameid = 0;
 	close(gamefd);
@@ -232,6 +245,9 @@ static void ccmd_game_command(json_t *params)
     
     gid = gameid;
     if (result >= GAME_OVER) {
+	db_update_game(gameid, player_info.moves, player_info.z, player_info.levdesc_dlvl);
+	db_flush_updates();
+	store_game_status(gameid, gamefd);
 	close(gamefd);
 	log_msg("Game %d (by %s) closed: game %s.", gameid, user_info.username, 
 		result == GAME_SAVED ? "saved" : "ended");
@@ -257,8 +273,8 @@ static void ccmd_game_command(json_t *params)
 		 user_info.username, basename);
 	snprintf(final_name, 1024, "%s/completed/%s", settings.workdir, basename);
 	rename(filename, final_name);
-	db_add_topten_entry(gid, tte->points, tte->hp, tte->maxhp, tte->deaths,
-			    tte->end_how, tte->death, tte->entrytxt);
+	db_add_topten_entry(gid, tte);
+	topten_gid = gid;
     }
 }
 
@@ -339,13 +355,28 @@ static void ccmd_view_finish(json_t *params)
 }
 
 
+/*
+ * Read the status of a closed game from its file and cache it in the games
+ * table, so that list_games doesn't need to open the file.
+ */
+int store_game_status(int gid, int fd)
+{
+    struct nh_game_info gi;
+    enum nh_log_status status;
+    
+    memset(&gi, 0, sizeof(gi));
+    status = nh_get_savegame_status(fd, &gi);
+    db_set_game_status(gid, status, &gi);
+    return status;
+}
+
+
 static void ccmd_list_games(json_t *params)
 {
     char filename[1024];
     int completed, limit, show_all, count, i, fd;
     struct gamefile_info *files;
-    enum nh_log_status status;
-    struct nh_game_info gi;
+    struct nh_game_info *gi;
     json_t *jarr, *jobj;
     
     if (json_unpack(params, "{si,si*}", "completed", &completed, "limit", &limit) == -1)
@@ -353,44 +384,57 @@ static void ccmd_list_games(json_t *params)
     if (json_unpack(params, "{si*}", "show_all", &show_all) == -1)
 	show_all = 0;
     
-    /* step 1: get a list of files from the db. */
+    /* everything needed is cached in the games table */
     files = db_list_games(completed, show_all ? 0 : user_info.uid, limit, &count);
     
     jarr = json_array();
-    /* step 2: get extra info for each file. */
     for (i = 0; i < count; i++) {
-	if (completed)
-	    snprintf(filename, 1024, "%s/completed/%s", settings.workdir, files[i].filename);
-	else
-	    snprintf(filename, 1024, "%s/save/%s/%s", settings.workdir,
-		     user_info.username, files[i].filename);
-	fd = open(filename, O_RDWR);
-	if (fd == -1) {
-	    log_msg("Game file %s could not be opened in ccmd_list_games.", files[i].filename);
-	    continue;
+	gi = &files[i].gi;
+	
+	/* Games from before the status was cached must be read once.
+	 * Games marked as in progress are read again: that mark is only
+	 * cleared by the game process itself, so a process that was killed
+	 * would leave it behind. The lock check in nh_get_savegame_status
+	 * tells whether the game is really still running or has crashed. */
+	if (files[i].status == GAME_STATUS_UNKNOWN ||
+	    files[i].status == LS_IN_PROGRESS) {
+	    int oldstatus = files[i].status;
+	    
+	    if (completed)
+		snprintf(filename, 1024, "%s/completed/%s", settings.workdir, files[i].filename);
+	    else
+		snprintf(filename, 1024, "%s/save/%s/%s", settings.workdir,
+			 files[i].username, files[i].filename);
+	    fd = open(filename, O_RDWR);
+	    if (fd == -1) {
+		log_msg("Game file %s could not be opened in ccmd_list_games.", files[i].filename);
+		goto next;
+	    }
+	    files[i].status = nh_get_savegame_status(fd, gi);
+	    if (files[i].status != oldstatus)
+		db_set_game_status(files[i].gid, files[i].status, gi);
+	    close(fd);
 	}
 	
-	status = nh_get_savegame_status(fd, &gi);
 	jobj = json_pack("{si,si,si,ss,ss,ss,ss,ss}", "gameid", files[i].gid,
-			 "status", status, "playmode", gi.playmode,
-			 "plname", gi.name, "plrole", gi.plrole, "plrace", gi.plrace,
-			 "plgend", gi.plgend, "plalign", gi.plalign);
-	if (status == LS_SAVED) {
-	    json_object_set_new(jobj, "level_desc", json_string(gi.level_desc));
-	    json_object_set_new(jobj, "moves", json_integer(gi.moves));
-	    json_object_set_new(jobj, "depth", json_integer(gi.depth));
-	    json_object_set_new(jobj, "has_amulet", json_integer(gi.has_amulet));
-	} else if (status == LS_DONE) {
-	    json_object_set_new(jobj, "death", json_string(gi.death));
-	    json_object_set_new(jobj, "moves", json_integer(gi.moves));
-	    json_object_set_new(jobj, "depth", json_integer(gi.depth));
+			 "status", files[i].status, "playmode", gi->playmode,
+			 "plname", gi->name, "plrole", gi->plrole, "plrace", gi->plrace,
+			 "plgend", gi->plgend, "plalign", gi->plalign);
+	if (files[i].status == LS_SAVED) {
+	    json_object_set_new(jobj, "level_desc", json_string(gi->level_desc));
+	    json_object_set_new(jobj, "moves", json_integer(gi->moves));
+	    json_object_set_new(jobj, "depth", json_integer(gi->depth));
+	    json_object_set_new(jobj, "has_amulet", json_integer(gi->has_amulet));
+	} else if (files[i].status == LS_DONE) {
+	    json_object_set_new(jobj, "death", json_string(gi->death));
+	    json_object_set_new(jobj, "moves", json_integer(gi->moves));
+	    json_object_set_new(jobj, "depth", json_integer(gi->depth));
 	}
 	json_array_append_new(jarr, jobj);
 	
+next:
 	free((void*)files[i].username);
 	free((void*)files[i].filename);
-	
-	close(fd);
     }
     free(files);
     
@@ -525,12 +569,25 @@ static void ccmd_get_roles(json_t *params)
 }
 
 
+static const char *ordinal_suffix(int n)
+{
+    if (n % 100 >= 11 && n % 100 <= 13)
+	return "th";
+    switch (n % 10) {
+	case 1: return "st";
+	case 2: return "nd";
+	case 3: return "rd";
+	default: return "th";
+    }
+}
+
+
 static void ccmd_get_topten(json_t *params)
 {
     struct nh_topten_entry *scores;
     char buf[BUFSZ];
     const char *player;
-    int listlen, top, around, own, i;
+    int listlen, top, around, own, i, rank, from_db;
     json_t *jmsg, *jarr, *jobj;
     
     if (json_unpack(params, "{ss,si,si,si*}",
@@ -540,7 +597,22 @@ static void ccmd_get_topten(json_t *params)
     if (player && !player[0])
 	player = NULL;
     
-    scores = nh_get_topten(&listlen, buf, player, top, around, own);
+    /* The score list is kept in the database, where it can be queried
+     * without reading all of it. Only a game that just ended without being
+     * scored (explore or wizard mode) is left to the game library, which
+     * knows how to present it. */
+    buf[0] = '\0';
+    rank = topten_gid ? db_get_topten_rank(topten_gid, NULL, 0) : 0;
+    from_db = (!topten_gid || rank);
+    if (from_db) {
+	scores = db_get_topten(player, top, around, own, topten_gid, &listlen);
+	if (rank && rank <= 10)
+	    snprintf(buf, BUFSZ, "You made the top ten list!");
+	else if (rank)
+	    snprintf(buf, BUFSZ, "You reached the %d%s place on the score list.",
+		     rank, ordinal_suffix(rank));
+    } else
+	scores = nh_get_topten(&listlen, buf, player, top, around, own);
     
     jarr = json_array();
     for (i = 0; i < listlen; i++) {
@@ -568,6 +640,8 @@ static void ccmd_get_topten(json_t *params)
 	    "highlight", scores[i].highlight);
 	json_array_append_new(jarr, jobj);
     }
+    if (from_db)
+	free(scores);
     jmsg = json_pack("{so,ss}", "toplist", jarr, "msg", buf);
     client_msg("get_topten", jmsg);
 }
@@ -7,15 +7,23 @@
 #include "nhserver.h"
 #include <poll.h>
 #include <ctype.h>
+#include <time.h>
 
 #define COMMBUF_SIZE (1024 * 1024)
 
 
 static int infd, outfd;
 int gamefd;
+int client_caps; /* NHNET_CAP_* features supported by the client */
 long gameid; /* id in the database */
 struct user_info user_info;
 int can_send_msg;
+static int client_prepared; /* database and game library are ready */
+static struct nhnet_zstream zstream; /* state for NHNET_CAP_COMPRESSION */
+static int at_command_prompt; /* waiting for a new command, not inside one */
+static time_t client_gone; /* when the master reported the client gone, or 0 */
+static unsigned long long input_wait; /* time spent waiting for the player
+					 during the current command */
 
 
 static char** init_game_paths(void)
@@ -58,8 +66,9 @@ static char** init_game_paths(void)
 void client_msg(const char *key, json_t *value)
 {
     int len, ret, pos;
-    char *jsonstr;
+    char *jsonstr, *outbuf;
     json_t *jval, *display_data;
+    unsigned long long start = metrics_now();
     jval = json_object();
     
     /* send out display data whenever anything else goes out */
@@ -76,6 +85,12 @@ void client_msg(const char *key, json_t *value)
     
     if (can_send_msg) {
 	len = strlen(jsonstr);
+	if (client_caps & NHNET_CAP_COMPRESSION) {
+	    outbuf = (char*)nhnet_compress(&zstream, jsonstr, len, &len);
+	    free(jsonstr);
+	    jsonstr = outbuf;
+	}
+	metrics_record(MH_ENCODE, start);
 	pos = 0;
 	do {
 	    ret = write(outfd, &jsonstr[pos], len - pos);
@@ -123,14 +138,20 @@ void exit_client(const char *err)
     }
     
     termination_flag = 3; /* make sure the command loop exits if nh_exit_game jumps there */
-    if (!sigsegv_flag)
+    if (!sigsegv_flag) {
 	nh_exit_game(EXIT_FORCE_SAVE); /* might not return here */
+	if (gameid && gamefd != -1) {
+	    db_flush_updates();
+	    store_game_status(gameid, gamefd);
+	}
+    }
     nh_lib_exit();
     close_database();
     if (user_info.username)
 	free(user_info.username);
     free_config();
     reset_cached_diplaydata();
+    nhnet_zstream_free(&zstream);
     end_logging();
     exit(err != NULL);
 }
@@ -138,35 +159,82 @@ void exit_client(const char *err)
 
 json_t *read_input(void)
 {
-    int ret, datalen, done;
+    int ret, datalen, done, timeout, flush_delay, can_hibernate;
+    time_t idle_limit, hibernate_limit;
     static char commbuf[COMMBUF_SIZE];
     char *bp;
     json_t *jval = NULL;
     json_error_t err;
     struct pollfd pfd[1] = {{infd, POLLIN | POLLRDHUP | POLLERR | POLLHUP, 0}};
+    unsigned long long wait_start = metrics_now();
     
     done = FALSE;
     datalen = 0;
+    idle_limit = time(NULL) + settings.client_timeout;
+    /* Hibernation: once the client has disconnected, the game is saved and
+     * this process exits to free its memory. When the player reconnects,
+     * the master finds no process for the game and the client restores it
+     * into a spare process. */
+    can_hibernate = (gameid && settings.hibernate_timeout &&
+		     settings.hibernate_timeout < settings.client_timeout);
     while (!done && !termination_flag) {
-	ret = poll(pfd, 1, settings.client_timeout * 1000);
-	if (ret == 0)
-	    exit_client("Inactivity timeout");
+	hibernate_limit = (can_hibernate && client_gone) ?
+			  client_gone + settings.hibernate_timeout : idle_limit;
+	/* wake up early to write out deferred database updates while the
+	 * player is idle */
+	timeout = (hibernate_limit - time(NULL)) * 1000;
+	flush_delay = db_flush_delay();
+	if (flush_delay >= 0 && flush_delay < timeout)
+	    timeout = flush_delay;
+	
+	ret = poll(pfd, 1, timeout > 0 ? timeout : 0);
+	if (ret == 0) {
+	    if (time(NULL) >= idle_limit)
+		exit_client("Inactivity timeout");
+	    if (time(NULL) >= hibernate_limit) {
+		log_msg("Game %ld (by %s) is disconnected; hibernating",
+			gameid, user_info.username);
+		metrics_add(MC_HIBERNATIONS, 1);
+		/* nobody is listening for a message about it */
+		can_send_msg = FALSE;
+		exit_client(NULL);
+	    }
+	    db_flush_updates();
+	    continue;
+	}
 	
 	ret = read(infd, &commbuf[datalen], COMMBUF_SIZE - datalen - 1);
 	if (ret == -1)
 	    continue; /* sone signals will set termination_flag, others won't */
 	else if (ret == 0)
 	    exit_client("Input pipe lost");
+	
+	/* the master sends '\034' when the client's socket closes. Raw control
+	 * characters never occur in JSON data. */
+	bp = memchr(&commbuf[datalen], '\034', ret);
+	if (bp) {
+	    client_gone = time(NULL);
+	    memmove(bp, bp + 1, &commbuf[datalen] + ret - bp - 1);
+	    if (--ret == 0)
+		continue;
+	}
 	datalen += ret;
+	idle_limit = time(NULL) + settings.client_timeout;
 	
-	if (commbuf[datalen-ret] == '\033') {
+	if (commbuf[datalen-ret] == '\033' && ret >= 2) {
 	    /* this is a request to reset the buffer when recovering from a
 	     * connection error. After such an error it simply isn't possible
-	     * to know what data actually arrived. */
+	     * to know what data actually arrived.
+	     * The byte after the '\033' holds the capabilities of the newly
+	     * connected client, which may not be the same program as before. */
+	    client_caps = (unsigned char)commbuf[datalen-ret+1];
+	    client_gone = 0;
+	    /* the new connection starts with a fresh compression history */
+	    nhnet_zstream_reset(&zstream);
 	    /* do a memmove in case there was already some new legitimate data
-	     * queued after the '\033' reset request. */
-	    memmove(commbuf, &commbuf[datalen-ret+1], ret - 1);
-	    datalen = ret - 1;
+	     * queued after the reset request. */
+	    memmove(commbuf, &commbuf[datalen-ret+2], ret - 2);
+	    datalen = ret - 2;
 	    /* also reset the cached display data to make sure all display state is re-sent */
 	    continue;
 	}
@@ -190,6 +258,8 @@ json_t *read_input(void)
     }
     /* message received; mow it's our turn to send */
     can_send_msg = TRUE;
+    if (!at_command_prompt)
+	input_wait += metrics_now() - wait_start;
     return jval;
 }
 
@@ -200,9 +270,12 @@ static void client_main_loop(void)
     const char *key;
     void *iter;
     int i;
+    unsigned long long start;
     
     while (!termination_flag) {
+	at_command_prompt = TRUE;
 	obj = read_input();
+	at_command_prompt = FALSE;
 	if (termination_flag) {
 	    if (obj)
 		json_decref(obj);
@@ -219,7 +292,11 @@ static void client_main_loop(void)
 	value = json_object_iter_value(iter);
 	for (i = 0; clientcmd[i].name; i++)
 	    if (!strcmp(clientcmd[i].name, key)) {
+		input_wait = 0;
+		start = metrics_now();
 		clientcmd[i].func(value);
+		/* time spent waiting for answers from the player doesn't count */
+		metrics_record(MH_COMMAND + i, start + input_wait);
 		break;
 	    }
 	
@@ -235,6 +312,28 @@ static void client_main_loop(void)
 }
 
 
+/*
+ * Setup which does not depend on the user: connect to the database and
+ * initialize the game library. Spare processes do this ahead of time.
+ */
+static void prepare_client(void)
+{
+    char **gamepaths;
+    int i;
+    
+    init_database();
+    
+    gamepaths = init_game_paths();
+    nh_lib_init(&server_windowprocs, gamepaths);
+    nh_set_save_timer(metrics_save_timer);
+    for (i = 0; i < PREFIX_COUNT; i++)
+	free(gamepaths[i]);
+    free(gamepaths);
+    
+    client_prepared = TRUE;
+}
+
+
 /*
  * This is the start of the client handling code.
  * The server process has accepted a connection and authenticated it. Data from
@@ -243,27 +342,71 @@ static void client_main_loop(void)
  * An instance of DynaHack will run in this process under the control of the
  * remote player.
  */
-void client_main(int userid, int _infd, int _outfd)
+/*
+ * Repair tool ("dynahack_server -r"): read every game file once and store
+ * its status in the games table. Needed once after upgrading from a server
+ * version that didn't cache the status; later it can fix rows for game files
+ * that were changed or recovered by hand.
+ */
+int rebuild_game_metadata(void)
 {
-    char **gamepaths;
-    int i;
+    char filename[1024];
+    struct gamefile_info *files;
+    int count, i, fd, updated = 0;
+    
+    prepare_client();
     
+    files = db_list_all_games(&count);
+    for (i = 0; i < count; i++) {
+	if (files[i].done)
+	    snprintf(filename, 1024, "%s/completed/%s", settings.workdir,
+		     files[i].filename);
+	else
+	    snprintf(filename, 1024, "%s/save/%s/%s", settings.workdir,
+		     files[i].username, files[i].filename);
+	fd = open(filename, O_RDWR);
+	if (fd == -1)
+	    fprintf(stderr, "Game %d: could not open %s: %s\n", files[i].gid,
+		    filename, strerror(errno));
+	else {
+	    store_game_status(files[i].gid, fd);
+	    close(fd);
+	    updated++;
+	}
+	
+	free((void*)files[i].username);
+	free((void*)files[i].filename);
+    }
+    free(files);
+    
+    printf("Updated the status of %d of %d games.\n", updated, count);
+    nh_lib_exit();
+    return updated == count;
+}
+
+
+void client_main(int userid, int caps, int _infd, int _outfd)
+{
     infd = _infd;
     outfd = _outfd;
     gamefd = -1;
+    client_caps = caps;
+    nhnet_zstream_reset(&zstream);
+    
+    if (!client_prepared)
+	prepare_client();
     
-    init_database();
     if (!db_get_user_info(userid, &user_info)) {
-	log_msg("get_user_info error for uid %d!", userid);
-	exit_client("database error");
+	/* the connection of a spare process may have gone stale while it
+	 * was waiting; try once more with a new one */
+	close_database();
+	init_database();
+	if (!db_get_user_info(userid, &user_info)) {
+	    log_msg("get_user_info error for uid %d!", userid);
+	    exit_client("database error");
+	}
     }
     
-    gamepaths = init_game_paths();
-    nh_lib_init(&server_windowprocs, gamepaths);
-    for (i = 0; i < PREFIX_COUNT; i++)
-	free(gamepaths[i]);
-    free(gamepaths);
-
     db_restore_options(userid);
     
     client_main_loop();
@@ -273,3 +416,48 @@ void client_main(int userid, int _infd, int _outfd)
     
     return;
 }
+
+
+/*
+ * Main function of a spare game process: prepare everything that can be set up
+ * before a user is known, then wait for the server to send the user id, the
+ * client capabilities and the two pipe fds for a new game.
+ */
+void spare_main(int sock)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    int data[2], ret;
+    char cbuf[CMSG_SPACE(2 * sizeof(int))];
+    
+    prepare_client();
+    
+    iov.iov_base = data;
+    iov.iov_len = sizeof(data);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    
+    do {
+	ret = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (ret == -1 && errno == EINTR && !termination_flag);
+    close(sock);
+    
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (ret != sizeof(data) || !cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+	cmsg->cmsg_type != SCM_RIGHTS ||
+	cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+	/* the server is shutting down (or something is badly wrong) */
+	nh_lib_exit();
+	close_database();
+	free_config();
+	end_logging();
+	exit(0);
+    }
+    
+    client_main(data[0], data[1], ((int*)CMSG_DATA(cmsg))[0],
+		((int*)CMSG_DATA(cmsg))[1]);
+}
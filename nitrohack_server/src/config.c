@@ -151,6 +151,19 @@ static int parse_config_line(char *line)
 	}
     }
     
+    else if (!strcmp(line, "metrics_socket")) {
+	if (strlen(val) > SUN_PATH_MAX - 1) {
+	    fprintf(stderr, "Error: The metrics socket filename is too long.\n");
+	    return FALSE;
+	}
+	    
+	if (settings.metrics_addr.sun_family == 0) {
+	    settings.metrics_addr.sun_family = AF_UNIX;
+	    strncpy(settings.metrics_addr.sun_path, val, SUN_PATH_MAX - 1);
+	    settings.metrics_addr.sun_path[SUN_PATH_MAX-1] = '\0';
+	}
+    }
+    
     else if (!strcmp(line, "nodaemon")) {
 	if (*val == '1' || !strcmp(val, "true"))
 	    settings.nodaemon = TRUE;
@@ -179,6 +192,41 @@ static int parse_config_line(char *line)
 	}
     }
     
+    else if (!strcmp(line, "spare_processes")) {
+	if (settings.spare_processes < 0)
+	    settings.spare_processes = atoi(val);
+	
+	if (settings.spare_processes < 0 || settings.spare_processes > 100) {
+	    fprintf(stderr, "Error: the value for spare_processes must be in the"
+	                    " range [0, 100].\n");
+	    return FALSE;
+	}
+    }
+    
+    else if (!strcmp(line, "hibernate_timeout")) {
+	if (settings.hibernate_timeout < 0)
+	    settings.hibernate_timeout = atoi(val);
+	
+	if (settings.hibernate_timeout < 0 ||
+	    settings.hibernate_timeout > (24 * 60 * 60)) {
+	    fprintf(stderr, "Error: the value for hibernate_timeout must be in the"
+	                    " range [0, 86400].\n");
+	    return FALSE;
+	}
+    }
+    
+    else if (!strcmp(line, "db_flush_interval")) {
+	if (!settings.db_flush_interval)
+	    settings.db_flush_interval = atoi(val);
+	
+	if (settings.db_flush_interval < 1 ||
+	    settings.db_flush_interval > (60 * 60)) {
+	    fprintf(stderr, "Error: the value for db_flush_interval must be in the"
+	                    " range [1, 3600].\n");
+	    return FALSE;
+	}
+    }
+    
     else if (!strcmp(line, "dbhost")) {
 	if (!settings.dbhost)
 	    settings.dbhost = strdup(val);
@@ -292,6 +340,15 @@ void setup_defaults(void)
     
     if (!settings.client_timeout)
 	settings.client_timeout = DEFAULT_CLIENT_TIMEOUT;
+    
+    if (settings.spare_processes < 0)
+	settings.spare_processes = DEFAULT_SPARE_PROCESSES;
+    
+    if (settings.hibernate_timeout < 0)
+	settings.hibernate_timeout = DEFAULT_HIBERNATE_TIMEOUT;
+    
+    if (!settings.db_flush_interval)
+	settings.db_flush_interval = DEFAULT_DB_FLUSH_INTERVAL;
 }
 
 
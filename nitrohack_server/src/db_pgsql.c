@@ -11,10 +11,19 @@
 #else
 # include <libpq-fe.h>
 #endif
+#include <time.h>
 
 /* prepared statement names */
 #define PREP_AUTH	"auth_user"
 #define PREP_REGISTER	"register_user"
+#define PREP_TOPTEN_RANK	"topten_rank"
+#define PREP_TOPTEN_TOP		"topten_top"
+#define PREP_TOPTEN_ABOVE	"topten_above"
+#define PREP_TOPTEN_BELOW	"topten_below"
+#define PREP_TOPTEN_OWN		"topten_own"
+
+/* upper limit for the size of each part of a db_get_topten selection */
+#define TOPTEN_MAX_ENTRIES 10000
 
 /* SQL statements used */
 static const char SQL_init_user_table[] =
@@ -41,12 +50,27 @@ static const char SQL_init_games_table[] =
        "moves integer NOT NULL, "
        "depth integer NOT NULL, "
        "level_desc text NOT NULL, "
+       "status integer, "
+       "has_amulet boolean NOT NULL DEFAULT FALSE, "
+       "death text NOT NULL DEFAULT '', "
        "done boolean NOT NULL DEFAULT FALSE, "
        "owner integer NOT NULL REFERENCES users (uid), "
        "ts timestamp NOT NULL, "
        "start_ts timestamp NOT NULL"
     ");";
 
+/* Databases created before the game status was cached in the games table
+ * lack the status columns. NULL status means "unknown": list_games reads
+ * the game file once for such games, and "dynahack_server -r" fills in all
+ * of them at once. */
+static const char SQL_upgrade_games_table[] =
+    "ALTER TABLE games "
+	"ADD COLUMN IF NOT EXISTS status integer, "
+	"ADD COLUMN IF NOT EXISTS has_amulet boolean NOT NULL DEFAULT FALSE, "
+	"ADD COLUMN IF NOT EXISTS death text NOT NULL DEFAULT '';"
+    "CREATE INDEX IF NOT EXISTS games_owner_done_ts ON games (owner, done, ts);"
+    "CREATE INDEX IF NOT EXISTS games_plname ON games (plname);";
+
 static const char SQL_init_options_table[] =
     "CREATE TABLE options("
 	"uid integer NOT NULL REFERENCES users (uid), "
@@ -65,9 +89,57 @@ static const char SQL_init_topten_table[] =
 	"deaths integer NOT NULL, "
 	"end_how integer NOT NULL, "
 	"death text NOT NULL, "
-	"entrytxt text NOT NULL"
+	"entrytxt text NOT NULL, "
+	"maxlvl integer, "
+	"moves integer, "
+	"deathdate integer, "
+	"birthdate integer, "
+	"ver_major integer NOT NULL DEFAULT 0, "
+	"ver_minor integer NOT NULL DEFAULT 0, "
+	"patchlevel integer NOT NULL DEFAULT 0, "
+	"scored boolean NOT NULL DEFAULT TRUE, "
+	"plname text"
     ");";
 
+/* Older topten tables only have the columns up to entrytxt; the rest is
+ * filled in from the games table as well as possible.
+ * "scored" is false for games that don't count for the high score list
+ * (explore and wizard mode). plname is a copy of the character name from
+ * the games table, so that a character's entries can be found by index.
+ *
+ * Ranks are positions in descending (points, -gid) order: more points
+ * first, and the older game first among equal points. Both indexes end in
+ * that key, so each ranking query below starts at a known position in an
+ * index and stops at the lowest entry it needs; nothing reads the whole
+ * table. */
+static const char SQL_upgrade_topten_table[] =
+    "ALTER TABLE topten "
+	"ADD COLUMN IF NOT EXISTS maxlvl integer, "
+	"ADD COLUMN IF NOT EXISTS moves integer, "
+	"ADD COLUMN IF NOT EXISTS deathdate integer, "
+	"ADD COLUMN IF NOT EXISTS birthdate integer, "
+	"ADD COLUMN IF NOT EXISTS ver_major integer NOT NULL DEFAULT 0, "
+	"ADD COLUMN IF NOT EXISTS ver_minor integer NOT NULL DEFAULT 0, "
+	"ADD COLUMN IF NOT EXISTS patchlevel integer NOT NULL DEFAULT 0, "
+	"ADD COLUMN IF NOT EXISTS scored boolean NOT NULL DEFAULT TRUE, "
+	"ADD COLUMN IF NOT EXISTS plname text;"
+    "UPDATE topten AS t SET plname = g.plname "
+	"FROM games AS g WHERE g.gid = t.gid AND t.plname IS NULL;"
+    "DROP INDEX IF EXISTS topten_scored_points;"
+    "CREATE INDEX IF NOT EXISTS topten_scored_rank "
+	"ON topten (points, (-gid)) WHERE scored;"
+    "CREATE INDEX IF NOT EXISTS topten_scored_plname "
+	"ON topten (plname, points, (-gid)) WHERE scored;";
+
+static const char SQL_backfill_topten_table[] =
+    "UPDATE topten AS t "
+    "SET maxlvl = g.depth, moves = g.moves, "
+	"deathdate = to_char(g.ts, 'YYYYMMDD')::integer, "
+	"birthdate = to_char(g.start_ts, 'YYYYMMDD')::integer, "
+	"scored = (g.mode = ANY($1::integer[])) "
+    "FROM games AS g "
+    "WHERE g.gid = t.gid AND t.moves IS NULL;";
+
 static const char SQL_check_table[] =
     "SELECT 1::integer "
     "FROM   pg_tables "
@@ -136,13 +208,33 @@ static const char SQL_set_game_done[] =
     "SET done = TRUE "
     "WHERE gid = $1::integer;";
 
-static const char SQL_list_games[] =
-    "SELECT g.gid, g.filename, u.name "
+static const char SQL_set_game_status[] =
+    "UPDATE games "
+    "SET status = $2::integer "
+    "WHERE gid = $1::integer;";
+
+static const char SQL_set_game_info[] =
+    "UPDATE games "
+    "SET status = $2::integer, moves = $3::integer, depth = $4::integer, "
+        "level_desc = $5::text, has_amulet = $6::boolean, death = $7::text "
+    "WHERE gid = $1::integer;";
+
+#define GAME_LIST_COLUMNS \
+    "SELECT g.gid, g.filename, u.name, g.status, g.done, g.mode, g.plname, " \
+           "g.role, g.race, g.gender, g.alignment, g.moves, g.depth, " \
+           "g.level_desc, g.has_amulet, g.death " \
     "FROM games AS g JOIN users AS u ON g.owner = u.uid "
+
+static const char SQL_list_games[] =
+    GAME_LIST_COLUMNS
     "WHERE (u.uid = $1::integer OR $1::integer = 0) AND g.done = $2::boolean "
     "ORDER BY g.ts DESC "
     "LIMIT $3::integer;";
 
+static const char SQL_list_all_games[] =
+    GAME_LIST_COLUMNS
+    "ORDER BY g.gid;";
+
 static const char SQL_update_option[] =
     "UPDATE options "
     "SET optvalue = $1::text "
@@ -158,12 +250,112 @@ static const char SQL_get_options[] =
     "WHERE uid = $1::integer;";
 
 static const char SQL_add_topten_entry[] =
-    "INSERT INTO topten (gid, points, hp, maxhp, deaths, end_how, death, entrytxt) "
-    "VALUES ($1::integer, $2::integer, $3::integer, $4::integer, "
-            "$5::integer, $6::integer, $7::text, $8::text);";
+    "INSERT INTO topten (gid, points, hp, maxhp, deaths, end_how, death, entrytxt, "
+			"maxlvl, moves, deathdate, birthdate, ver_major, "
+			"ver_minor, patchlevel, scored, plname) "
+    "SELECT $1::integer, $2::integer, $3::integer, $4::integer, "
+	   "$5::integer, $6::integer, $7::text, $8::text, $9::integer, "
+	   "$10::integer, $11::integer, $12::integer, $13::integer, "
+	   "$14::integer, $15::integer, g.mode = ANY($16::integer[]), g.plname "
+    "FROM games AS g WHERE g.gid = $1::integer;";
+
+/* Rank, character name and points of a game on the high score list. The
+ * count only reads the part of topten_scored_rank above the game. */
+static const char SQL_topten_rank[] =
+    "SELECT (SELECT count(*) FROM topten AS t "
+	    "WHERE t.scored AND (t.points, -t.gid) > (me.points, -me.gid)) + 1, "
+	   "me.plname, me.points "
+    "FROM topten AS me "
+    "WHERE me.gid = $1::integer AND me.scored;";
+
+/* the columns of a high score list entry, as read by read_topten_rows() */
+#define TOPTEN_COLUMNS \
+    "t.points, t.maxlvl, t.hp, t.maxhp, t.deaths, t.ver_major, t.ver_minor, " \
+    "t.patchlevel, t.deathdate, t.birthdate, t.moves, t.end_how, g.role, " \
+    "g.race, g.gender, g.alignment, g.plname, t.death, t.entrytxt "
+
+/* the first $1 entries */
+static const char SQL_topten_top[] =
+    "SELECT " TOPTEN_COLUMNS
+    "FROM (SELECT * FROM topten WHERE scored "
+	  "ORDER BY points DESC, -gid DESC LIMIT $1::integer) AS t "
+	"JOIN games AS g ON g.gid = t.gid "
+    "ORDER BY t.points DESC, -t.gid DESC;";
+
+/* the $3 entries just above the one with $1 points and gid $2, nearest first */
+static const char SQL_topten_above[] =
+    "SELECT " TOPTEN_COLUMNS
+    "FROM (SELECT * FROM topten "
+	  "WHERE scored AND (points, -gid) > ($1::integer, -$2::integer) "
+	  "ORDER BY points, -gid LIMIT $3::integer) AS t "
+	"JOIN games AS g ON g.gid = t.gid "
+    "ORDER BY t.points, -t.gid;";
+
+/* the entry with $1 points and gid $2 and the ones below it, $3 in all */
+static const char SQL_topten_below[] =
+    "SELECT " TOPTEN_COLUMNS
+    "FROM (SELECT * FROM topten "
+	  "WHERE scored AND (points, -gid) <= ($1::integer, -$2::integer) "
+	  "ORDER BY points DESC, -gid DESC LIMIT $3::integer) AS t "
+	"JOIN games AS g ON g.gid = t.gid "
+    "ORDER BY t.points DESC, -t.gid DESC;";
+
+/* the best $2 entries of the character $1, each with its rank. The ranks
+ * are numbered in one walk down topten_scored_rank that stops at the lowest
+ * of these entries. */
+static const char SQL_topten_own[] =
+    "WITH own AS (SELECT * FROM topten WHERE scored AND plname = $1::text "
+		 "ORDER BY points DESC, -gid DESC LIMIT $2::integer), "
+	 "last AS (SELECT points, gid FROM own ORDER BY points, -gid LIMIT 1), "
+	 "ranked AS (SELECT r.gid, row_number() OVER "
+			"(ORDER BY r.points DESC, -r.gid DESC) AS rank "
+		    "FROM topten AS r, last WHERE r.scored AND "
+			"(r.points, -r.gid) >= (last.points, -last.gid)) "
+    "SELECT " TOPTEN_COLUMNS ", ranked.rank "
+    "FROM own AS t JOIN ranked ON ranked.gid = t.gid "
+	"JOIN games AS g ON g.gid = t.gid "
+    "ORDER BY t.points DESC, -t.gid DESC;";
 
 
 static PGconn *conn;
+static int topten_prepared; /* topten statements exist on this connection */
+
+/* play modes which count for the high score list, as a postgres array */
+static char scored_modes[32];
+
+
+/*
+ * Wrappers around the libpq query functions which add the time spent waiting
+ * for the database to the server metrics.
+ */
+static PGresult *db_exec(const char *sql)
+{
+    unsigned long long start = metrics_now();
+    PGresult *res = PQexec(conn, sql);
+    metrics_record(MH_DB, start);
+    return res;
+}
+
+
+static PGresult *db_exec_params(const char *sql, int nparams,
+				const char *const *params, const int *formats)
+{
+    unsigned long long start = metrics_now();
+    PGresult *res = PQexecParams(conn, sql, nparams, NULL, params, NULL,
+				 formats, 0);
+    metrics_record(MH_DB, start);
+    return res;
+}
+
+
+static PGresult *db_exec_prepared(const char *name, int nparams,
+				  const char *const *params)
+{
+    unsigned long long start = metrics_now();
+    PGresult *res = PQexecPrepared(conn, name, nparams, params, NULL, NULL, 0);
+    metrics_record(MH_DB, start);
+    return res;
+}
 
 
 /*
@@ -173,6 +365,9 @@ int init_database(void)
 {
     if (conn)
 	close_database();
+    
+    topten_prepared = FALSE;
+    sprintf(scored_modes, "{%d,%d}", MODE_NORMAL, MODE_TUTORIAL);
 
     conn = PQsetdbLogin(settings.dbhost, settings.dbport, NULL, NULL,
 			settings.dbname, settings.dbuser, settings.dbpass);
@@ -196,12 +391,12 @@ static int check_create_table(const char *tablename, const char *create_stmt)
     int paramFormats[1] = {0};
     
     params[0] = tablename;
-    res2 = PQexecParams(conn, SQL_check_table, 1, NULL, params, NULL, paramFormats, 0);
+    res2 = db_exec_params(SQL_check_table, 1, params, paramFormats);
     if (PQresultStatus(res2) != PGRES_TUPLES_OK || PQntuples(res2) == 0) {
 	fprintf(stderr, "Table '%s' was not found. It will be created now.\n", tablename);
 	PQclear(res2);
 	
-	res = PQexec(conn, create_stmt);
+	res = db_exec(create_stmt);
 	if (PQresultStatus(res) != PGRES_COMMAND_OK) {
 	    fprintf(stderr, "Failed to create table %s: %s",
 		    tablename, PQerrorMessage(conn));
@@ -223,12 +418,13 @@ static int check_create_table(const char *tablename, const char *create_stmt)
 int check_database(void)
 {
     PGresult *res;
+    const char *params[1];
     
     /*
      * Perform a quick check for the presence of the pgcrypto extension:
      * A function crypt(text, text) must exist.
      */
-    res = PQexec(conn, SQL_check_pgcrypto);
+    res = db_exec(SQL_check_pgcrypto);
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         fprintf(stderr, "PostgreSQL pgcrypto check failed: %s", PQerrorMessage(conn));
         PQclear(res);
@@ -245,6 +441,27 @@ int check_database(void)
 	!check_create_table("options", SQL_init_options_table))
 	goto err;
     
+    res = db_exec(SQL_upgrade_topten_table);
+    if (PQresultStatus(res) == PGRES_COMMAND_OK) {
+	PQclear(res);
+	params[0] = scored_modes;
+	res = db_exec_params(SQL_backfill_topten_table, 1, params, NULL);
+    }
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+	fprintf(stderr, "Failed to upgrade table topten: %s", PQerrorMessage(conn));
+	PQclear(res);
+	goto err;
+    }
+    PQclear(res);
+    
+    res = db_exec(SQL_upgrade_games_table);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+	fprintf(stderr, "Failed to upgrade table games: %s", PQerrorMessage(conn));
+	PQclear(res);
+	goto err;
+    }
+    PQclear(res);
+    
     /*
      * Create prepared statements
      */
@@ -274,6 +491,7 @@ err:
 
 void close_database(void)
 {
+    db_flush_updates();
     PQfinish(conn);
     conn = NULL;
 }
@@ -286,7 +504,7 @@ int db_auth_user(const char *name, const char *pass)
     int uid, auth_ok, col;
     const char *uidstr;
     
-    res = PQexecPrepared(conn, PREP_AUTH, 2, params, NULL, NULL, 0);
+    res = db_exec_prepared(PREP_AUTH, 2, params);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         PQclear(res);
 	return 0;
@@ -311,7 +529,7 @@ int db_register_user(const char *name, const char *pass, const char *email)
     int uid;
     const char *uidstr;
     
-    res = PQexecPrepared(conn, PREP_REGISTER, 3, params, NULL, NULL, 0);
+    res = db_exec_prepared(PREP_REGISTER, 3, params);
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
 	log_msg("db_register_user failed: %s", PQerrorMessage(conn));
         PQclear(res);
@@ -319,7 +537,7 @@ int db_register_user(const char *name, const char *pass, const char *email)
     }
     PQclear(res);
     
-    res = PQexec(conn, SQL_last_reg_id);
+    res = db_exec(SQL_last_reg_id);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
 	log_msg("db_register_user get last id failed: %s", PQerrorMessage(conn));
         PQclear(res);
@@ -343,7 +561,7 @@ int db_get_user_info(int uid, struct user_info *info)
     
     sprintf(uidstr, "%d", uid);
     
-    res = PQexecParams(conn, SQL_get_user_info, 1, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_get_user_info, 1, params, paramFormats);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
 	log_msg("db_get_user_info error: %s", PQerrorMessage(conn));
         PQclear(res);
@@ -363,7 +581,7 @@ int db_get_user_info(int uid, struct user_info *info)
 }
 
 
-void db_update_user_ts(int uid)
+static void write_user_ts(int uid)
 {
     PGresult *res;
     char uidstr[16];
@@ -371,7 +589,7 @@ void db_update_user_ts(int uid)
     const int paramFormats[] = {0}; /* text format */
     
     sprintf(uidstr, "%d", uid);
-    res = PQexecParams(conn, SQL_update_user_ts, 1, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_update_user_ts, 1, params, paramFormats);
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	log_msg("update_user_ts error: %s", PQerrorMessage(conn));
     PQclear(res);
@@ -388,7 +606,7 @@ int db_set_user_email(int uid, const char *email)
     
     sprintf(uidstr, "%d", uid);
     
-    res = PQexecParams(conn, SQL_set_user_email, 2, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_set_user_email, 2, params, paramFormats);
     numrows = PQcmdTuples(res);
     if (PQresultStatus(res) == PGRES_COMMAND_OK && atoi(numrows) == 1) {
 	PQclear(res);
@@ -409,7 +627,7 @@ int db_set_user_password(int uid, const char *password)
     
     sprintf(uidstr, "%d", uid);
     
-    res = PQexecParams(conn, SQL_set_user_password, 2, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_set_user_password, 2, params, paramFormats);
     numrows = PQcmdTuples(res);
     if (PQresultStatus(res) == PGRES_COMMAND_OK && atoi(numrows) == 1) {
 	PQclear(res);
@@ -435,7 +653,7 @@ long db_add_new_game(int uid, const char *filename, const char *role,
     sprintf(uidstr, "%d", uid);
     sprintf(modestr, "%d", mode);
     
-    res = PQexecParams(conn, SQL_add_game, 9, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_add_game, 9, params, paramFormats);
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
 	log_msg("db_add_new_game error while adding (%s - %s): %s",
 		plname, filename, PQerrorMessage(conn));
@@ -443,7 +661,7 @@ long db_add_new_game(int uid, const char *filename, const char *role,
 	return 0;
     }
     
-    res = PQexec(conn, SQL_last_game_id);
+    res = db_exec(SQL_last_game_id);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         PQclear(res);
 	return 0;
@@ -457,7 +675,7 @@ long db_add_new_game(int uid, const char *filename, const char *role,
 }
 
 
-void db_update_game(int gameid, int moves, int depth, const char *levdesc)
+static void write_game(int gameid, int moves, int depth, const char *levdesc)
 {
     PGresult *res;
     char gidstr[16], movesstr[16], depthstr[16];
@@ -468,13 +686,91 @@ void db_update_game(int gameid, int moves, int depth, const char *levdesc)
     sprintf(movesstr, "%d", moves);
     sprintf(depthstr, "%d", depth);
     
-    res = PQexecParams(conn, SQL_update_game, 4, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_update_game, 4, params, paramFormats);
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	log_msg("update_game_ts error: %s", PQerrorMessage(conn));
     PQclear(res);
 }
 
 
+/*
+ * The user timestamp and the game progress are updated after every
+ * command.  Rather than making a round trip to the database each time,
+ * db_update_user_ts and db_update_game only record the new values.  They
+ * are written at most once every settings.db_flush_interval seconds, and
+ * whenever db_flush_updates is called: when a game is closed and when the
+ * database connection is shut down.
+ */
+static struct pending_updates {
+    int uid;		/* user whose timestamp is out of date, or 0 */
+    int gameid;		/* game whose progress is out of date, or 0 */
+    int moves, depth;
+    char levdesc[COLNO];
+    time_t last_flush;
+} pending;
+
+
+void db_flush_updates(void)
+{
+    if (conn) {
+	if (pending.uid)
+	    write_user_ts(pending.uid);
+	if (pending.gameid)
+	    write_game(pending.gameid, pending.moves, pending.depth,
+		       pending.levdesc);
+    }
+    pending.uid = pending.gameid = 0;
+    pending.last_flush = time(NULL);
+}
+
+
+/* Milliseconds until pending updates are due to be written, or -1 if there
+ * is nothing to write. */
+int db_flush_delay(void)
+{
+    time_t remaining;
+    
+    if (!pending.uid && !pending.gameid)
+	return -1;
+    
+    remaining = pending.last_flush + settings.db_flush_interval - time(NULL);
+    return remaining > 0 ? remaining * 1000 : 0;
+}
+
+
+static void flush_if_due(void)
+{
+    if (db_flush_delay() == 0)
+	db_flush_updates();
+}
+
+
+void db_update_user_ts(int uid)
+{
+    if (pending.uid && pending.uid != uid)
+	write_user_ts(pending.uid);
+    pending.uid = uid;
+    flush_if_due();
+}
+
+
+void db_update_game(int gameid, int moves, int depth, const char *levdesc)
+{
+    if (!gameid)
+	return;
+    
+    if (pending.gameid && pending.gameid != gameid)
+	write_game(pending.gameid, pending.moves, pending.depth, pending.levdesc);
+    
+    pending.gameid = gameid;
+    pending.moves = moves;
+    pending.depth = depth;
+    strncpy(pending.levdesc, levdesc, sizeof(pending.levdesc) - 1);
+    pending.levdesc[sizeof(pending.levdesc) - 1] = '\0';
+    flush_if_due();
+}
+
+
 int db_get_game_filename(int uid, int gid, char *namebuf, int buflen)
 {
     PGresult *res;
@@ -485,7 +781,7 @@ int db_get_game_filename(int uid, int gid, char *namebuf, int buflen)
     sprintf(uidstr, "%d", uid);
     sprintf(gidstr, "%d", gid);
     
-    res = PQexecParams(conn, SQL_get_game_filename, 2, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_get_game_filename, 2, params, paramFormats);
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
 	log_msg("get_game_filename error: %s", PQerrorMessage(conn));
 	PQclear(res);
@@ -508,7 +804,7 @@ void db_delete_game(int uid, int gid)
     sprintf(uidstr, "%d", uid);
     sprintf(gidstr, "%d", gid);
     
-    res = PQexecParams(conn, SQL_delete_game, 2, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_delete_game, 2, params, paramFormats);
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	log_msg("db_delete_game error: %s", PQerrorMessage(conn));
 
@@ -516,10 +812,79 @@ void db_delete_game(int uid, int gid)
 }
 
 
+void db_set_game_status(int gid, int status, const struct nh_game_info *gi)
+{
+    PGresult *res;
+    char gidstr[16], statusstr[16], movesstr[16], depthstr[16];
+    const char * const params[] = {gidstr, statusstr, movesstr, depthstr,
+	gi ? gi->level_desc : "", gi && gi->has_amulet ? "t" : "f",
+	gi ? gi->death : ""};
+    const int paramFormats[] = {0, 0, 0, 0, 0, 0, 0};
+    
+    sprintf(gidstr, "%d", gid);
+    sprintf(statusstr, "%d", status);
+    
+    /* moves, depth etc. are only meaningful for saved and finished games */
+    if (gi && (status == LS_SAVED || status == LS_DONE)) {
+	sprintf(movesstr, "%d", gi->moves);
+	sprintf(depthstr, "%d", gi->depth);
+	res = db_exec_params(SQL_set_game_info, 7, params, paramFormats);
+    } else
+	res = db_exec_params(SQL_set_game_status, 2, params, paramFormats);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	log_msg("set_game_status error: %s", PQerrorMessage(conn));
+    PQclear(res);
+}
+
+
+static void copy_field(char *dest, const char *src, int destlen)
+{
+    strncpy(dest, src, destlen - 1);
+    dest[destlen - 1] = '\0';
+}
+
+
+static struct gamefile_info *read_game_list(PGresult *res, int *count)
+{
+    int i;
+    struct gamefile_info *files;
+    struct nh_game_info *gi;
+    
+    *count = PQntuples(res);
+    files = malloc(sizeof(struct gamefile_info) * (*count));
+    memset(files, 0, sizeof(struct gamefile_info) * (*count));
+    for (i = 0; i < *count; i++) {
+	/* columns in the order of GAME_LIST_COLUMNS */
+	files[i].gid = atoi(PQgetvalue(res, i, 0));
+	files[i].filename = strdup(PQgetvalue(res, i, 1));
+	files[i].username = strdup(PQgetvalue(res, i, 2));
+	if (PQgetisnull(res, i, 3))
+	    files[i].status = GAME_STATUS_UNKNOWN;
+	else
+	    files[i].status = atoi(PQgetvalue(res, i, 3));
+	files[i].done = (PQgetvalue(res, i, 4)[0] == 't');
+	
+	gi = &files[i].gi;
+	gi->playmode = atoi(PQgetvalue(res, i, 5));
+	copy_field(gi->name, PQgetvalue(res, i, 6), sizeof(gi->name));
+	copy_field(gi->plrole, PQgetvalue(res, i, 7), sizeof(gi->plrole));
+	copy_field(gi->plrace, PQgetvalue(res, i, 8), sizeof(gi->plrace));
+	copy_field(gi->plgend, PQgetvalue(res, i, 9), sizeof(gi->plgend));
+	copy_field(gi->plalign, PQgetvalue(res, i, 10), sizeof(gi->plalign));
+	gi->moves = atoi(PQgetvalue(res, i, 11));
+	gi->depth = atoi(PQgetvalue(res, i, 12));
+	copy_field(gi->level_desc, PQgetvalue(res, i, 13), sizeof(gi->level_desc));
+	gi->has_amulet = (PQgetvalue(res, i, 14)[0] == 't');
+	copy_field(gi->death, PQgetvalue(res, i, 15), sizeof(gi->death));
+    }
+    
+    return files;
+}
+
+
 struct gamefile_info *db_list_games(int completed, int uid, int limit, int *count)
 {
     PGresult *res;
-    int i, gidcol, fncol, ucol;
     struct gamefile_info *files;
     char uidstr[16], complstr[16], limitstr[16];
     const char * const params[] = {uidstr, complstr, limitstr};
@@ -532,7 +897,7 @@ struct gamefile_info *db_list_games(int completed, int uid, int limit, int *coun
     sprintf(complstr, "%d", !!completed);
     sprintf(limitstr, "%d", limit);
     
-    res = PQexecParams(conn, SQL_list_games, 3, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_list_games, 3, params, paramFormats);
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 	log_msg("list_games error: %s", PQerrorMessage(conn));
 	PQclear(res);
@@ -540,18 +905,26 @@ struct gamefile_info *db_list_games(int completed, int uid, int limit, int *coun
 	return NULL;
     }
     
-    *count = PQntuples(res);
-    gidcol = PQfnumber(res, "gid");
-    fncol = PQfnumber(res, "filename");
-    ucol = PQfnumber(res, "name");
+    files = read_game_list(res, count);
+    PQclear(res);
+    return files;
+}
+
+
+struct gamefile_info *db_list_all_games(int *count)
+{
+    PGresult *res;
+    struct gamefile_info *files;
     
-    files = malloc(sizeof(struct gamefile_info) * (*count));
-    for (i = 0; i < *count; i++) {
-	files[i].gid = atoi(PQgetvalue(res, i, gidcol));
-	files[i].filename = strdup(PQgetvalue(res, i, fncol));
-	files[i].username = strdup(PQgetvalue(res, i, ucol));
+    res = db_exec(SQL_list_all_games);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+	fprintf(stderr, "list_all_games error: %s", PQerrorMessage(conn));
+	PQclear(res);
+	*count = 0;
+	return NULL;
     }
     
+    files = read_game_list(res, count);
     PQclear(res);
     return files;
 }
@@ -569,7 +942,7 @@ void db_set_option(int uid, const char *optname, int type, const char *optval)
     sprintf(typestr, "%d", type);
     
     /* try to update first */
-    res = PQexecParams(conn, SQL_update_option, 3, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_update_option, 3, params, paramFormats);
     numrows = PQcmdTuples(res);
     if (PQresultStatus(res) == PGRES_COMMAND_OK && atoi(numrows) == 1) {
 	PQclear(res);
@@ -578,7 +951,7 @@ void db_set_option(int uid, const char *optname, int type, const char *optval)
     PQclear(res);
     
     /* update failed, try to insert */
-    res = PQexecParams(conn, SQL_insert_option, 4, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_insert_option, 4, params, paramFormats);
     numrows = PQcmdTuples(res);
     if (PQresultStatus(res) == PGRES_COMMAND_OK && atoi(numrows) == 1) {
 	PQclear(res);
@@ -604,7 +977,7 @@ void db_restore_options(int uid)
 
     sprintf(uidstr, "%d", uid);
     
-    res = PQexecParams(conn, SQL_get_options, 1, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_get_options, 1, params, paramFormats);
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 	log_msg("get_options error: %s", PQerrorMessage(conn));
 	PQclear(res);
@@ -623,33 +996,254 @@ void db_restore_options(int uid)
 }
 
 
-void db_add_topten_entry(int gid, int points, int hp, int maxhp, int deaths,
-			 int end_how, const char *death, const char *entrytxt)
+void db_add_topten_entry(int gid, const struct nh_topten_entry *tte)
 {
     PGresult *res;
-    char gidstr[16], pointstr[16], hpstr[16], maxhpstr[16], dcountstr[16], endstr[16];
+    char gidstr[16], pointstr[16], hpstr[16], maxhpstr[16], dcountstr[16],
+	 endstr[16], maxlvlstr[16], movesstr[16], ddatestr[16], bdatestr[16],
+	 vmajstr[16], vminstr[16], plvlstr[16];
     const char * const params[] = {gidstr, pointstr, hpstr, maxhpstr,
-                                   dcountstr, endstr, death, entrytxt};
-    const int paramFormats[] = {0, 0, 0, 0, 0, 0, 0, 0};
+                                   dcountstr, endstr, tte->death, tte->entrytxt,
+				   maxlvlstr, movesstr, ddatestr, bdatestr,
+				   vmajstr, vminstr, plvlstr, scored_modes};
     
     sprintf(gidstr, "%d", gid);
-    sprintf(pointstr, "%d", points);
-    sprintf(hpstr, "%d", hp);
-    sprintf(maxhpstr, "%d", maxhp);
-    sprintf(dcountstr, "%d", deaths);
-    sprintf(endstr, "%d", end_how);
+    sprintf(pointstr, "%d", tte->points);
+    sprintf(hpstr, "%d", tte->hp);
+    sprintf(maxhpstr, "%d", tte->maxhp);
+    sprintf(dcountstr, "%d", tte->deaths);
+    sprintf(endstr, "%d", tte->end_how);
+    sprintf(maxlvlstr, "%d", tte->maxlvl);
+    sprintf(movesstr, "%d", tte->moves);
+    sprintf(ddatestr, "%d", tte->deathdate);
+    sprintf(bdatestr, "%d", tte->birthdate);
+    sprintf(vmajstr, "%d", tte->ver_major);
+    sprintf(vminstr, "%d", tte->ver_minor);
+    sprintf(plvlstr, "%d", tte->patchlevel);
     
-    res = PQexecParams(conn, SQL_add_topten_entry, 8, NULL, params, NULL, paramFormats, 0);
+    res = db_exec_params(SQL_add_topten_entry, 16, params, NULL);
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	log_msg("add_topten_entry error: %s", PQerrorMessage(conn));
     PQclear(res);
     
-    /* note: the params and paramFormats arrays are re-used, but only the 1. entry matters */
-    res = PQexecParams(conn, SQL_set_game_done, 1, NULL, params, NULL, paramFormats, 0);
+    /* note: the params array is re-used, but only the 1. entry matters */
+    res = db_exec_params(SQL_set_game_done, 1, params, NULL);
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	log_msg("set_game_done error: %s", PQerrorMessage(conn));
     PQclear(res);
     return;
 }
 
+
+static int prepare_topten(void)
+{
+    PGresult *res;
+    static const char * const names[] =
+	{PREP_TOPTEN_RANK, PREP_TOPTEN_TOP, PREP_TOPTEN_ABOVE,
+	 PREP_TOPTEN_BELOW, PREP_TOPTEN_OWN};
+    const char *stmts[] = {SQL_topten_rank, SQL_topten_top, SQL_topten_above,
+			   SQL_topten_below, SQL_topten_own};
+    int i;
+    
+    if (topten_prepared)
+	return TRUE;
+    
+    for (i = 0; i < 5; i++) {
+	res = PQprepare(conn, names[i], stmts[i], 0, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+	    log_msg("prepare statement %s failed: %s", names[i],
+		    PQerrorMessage(conn));
+	    PQclear(res);
+	    return FALSE;
+	}
+	PQclear(res);
+    }
+    
+    topten_prepared = TRUE;
+    return TRUE;
+}
+
+
+/*
+ * Rank of the game gid on the high score list, or 0 if it isn't on the
+ * list. If plname is not NULL, the character name is stored there; if
+ * points is not NULL, the game's score.
+ */
+static int get_topten_rank(int gid, char *plname, int plname_len, int *points)
+{
+    PGresult *res;
+    char gidstr[16];
+    const char * const params[] = {gidstr};
+    int rank;
+    
+    if (!prepare_topten())
+	return 0;
+    
+    sprintf(gidstr, "%d", gid);
+    res = db_exec_prepared(PREP_TOPTEN_RANK, 1, params);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
+	PQclear(res);
+	return 0;
+    }
+    
+    rank = atoi(PQgetvalue(res, 0, 0));
+    if (plname) {
+	strncpy(plname, PQgetvalue(res, 0, 1), plname_len - 1);
+	plname[plname_len - 1] = '\0';
+    }
+    if (points)
+	*points = atoi(PQgetvalue(res, 0, 2));
+    PQclear(res);
+    return rank;
+}
+
+
+int db_get_topten_rank(int gid, char *plname, int plname_len)
+{
+    return get_topten_rank(gid, plname, plname_len, NULL);
+}
+
+
+static void copy_topten_string(char *dest, const char *src, int destlen)
+{
+    strncpy(dest, src, destlen - 1);
+    dest[destlen - 1] = '\0';
+}
+
+
+/*
+ * Run one of the prepared high score list queries and append the entries it
+ * returns to list. The n-th entry gets the rank first_rank + n * step; if
+ * step is 0, the rank is taken from the column after TOPTEN_COLUMNS.
+ */
+static void read_topten_rows(struct nh_topten_entry **list, int *len, int *size,
+			     const char *stmt, int nparams,
+			     const char *const *params, int first_rank, int step)
+{
+    PGresult *res;
+    struct nh_topten_entry *e;
+    int i, rows;
+    
+    res = db_exec_prepared(stmt, nparams, params);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+	log_msg("get_topten error: %s", PQerrorMessage(conn));
+	PQclear(res);
+	return;
+    }
+    
+    rows = PQntuples(res);
+    for (i = 0; i < rows; i++) {
+	if (*len >= *size) {
+	    *size = *size ? 2 * *size : 64;
+	    *list = realloc(*list, *size * sizeof(struct nh_topten_entry));
+	}
+	e = &(*list)[(*len)++];
+	memset(e, 0, sizeof(struct nh_topten_entry));
+	
+	/* columns in the order of TOPTEN_COLUMNS */
+	e->points = atoi(PQgetvalue(res, i, 0));
+	e->maxlvl = atoi(PQgetvalue(res, i, 1));
+	e->hp = atoi(PQgetvalue(res, i, 2));
+	e->maxhp = atoi(PQgetvalue(res, i, 3));
+	e->deaths = atoi(PQgetvalue(res, i, 4));
+	e->ver_major = atoi(PQgetvalue(res, i, 5));
+	e->ver_minor = atoi(PQgetvalue(res, i, 6));
+	e->patchlevel = atoi(PQgetvalue(res, i, 7));
+	e->deathdate = atoi(PQgetvalue(res, i, 8));
+	e->birthdate = atoi(PQgetvalue(res, i, 9));
+	e->moves = atoi(PQgetvalue(res, i, 10));
+	e->end_how = atoi(PQgetvalue(res, i, 11));
+	copy_topten_string(e->plrole, PQgetvalue(res, i, 12), sizeof(e->plrole));
+	copy_topten_string(e->plrace, PQgetvalue(res, i, 13), sizeof(e->plrace));
+	copy_topten_string(e->plgend, PQgetvalue(res, i, 14), sizeof(e->plgend));
+	copy_topten_string(e->plalign, PQgetvalue(res, i, 15), sizeof(e->plalign));
+	copy_topten_string(e->name, PQgetvalue(res, i, 16), sizeof(e->name));
+	copy_topten_string(e->death, PQgetvalue(res, i, 17), sizeof(e->death));
+	copy_topten_string(e->entrytxt, PQgetvalue(res, i, 18), sizeof(e->entrytxt));
+	e->rank = step ? first_rank + i * step : atoi(PQgetvalue(res, i, 19));
+    }
+    PQclear(res);
+}
+
+
+static int compare_rank(const void *a, const void *b)
+{
+    return ((const struct nh_topten_entry*)a)->rank -
+	   ((const struct nh_topten_entry*)b)->rank;
+}
+
+
+/*
+ * Select entries from the high score list with the same meaning of the
+ * parameters as nh_get_topten: the first top entries (all of them if top is
+ * -1), the entries of the character player if own is set, and around
+ * entries on either side of the game highlight_gid, which is highlighted.
+ * Each part of the selection is one indexed query that holds at most
+ * TOPTEN_MAX_ENTRIES entries; the full list is never read.
+ */
+struct nh_topten_entry *db_get_topten(const char *player, int top, int around,
+				      int own, int highlight_gid, int *count)
+{
+    struct nh_topten_entry *list = NULL;
+    char plname[PL_NSIZ], pointstr[16], gidstr[16], limitstr[16];
+    const char *params[3];
+    int len = 0, size = 0, rank = 0, points = 0, i, j;
+    
+    *count = 0;
+    if (!prepare_topten())
+	return NULL;
+    
+    if (highlight_gid) {
+	rank = get_topten_rank(highlight_gid, plname, sizeof(plname), &points);
+	if (rank && !player)
+	    player = plname;
+    }
+    
+    if (top == -1 || top > TOPTEN_MAX_ENTRIES)
+	top = TOPTEN_MAX_ENTRIES;
+    if (top > 0) {
+	sprintf(limitstr, "%d", top);
+	params[0] = limitstr;
+	read_topten_rows(&list, &len, &size, PREP_TOPTEN_TOP, 1, params, 1, 1);
+    }
+    
+    if (around >= TOPTEN_MAX_ENTRIES)
+	around = TOPTEN_MAX_ENTRIES - 1;
+    if (rank && around >= 0) {
+	sprintf(pointstr, "%d", points);
+	sprintf(gidstr, "%d", highlight_gid);
+	params[0] = pointstr;
+	params[1] = gidstr;
+	params[2] = limitstr;
+	if (around > 0) {
+	    sprintf(limitstr, "%d", around);
+	    read_topten_rows(&list, &len, &size, PREP_TOPTEN_ABOVE, 3, params,
+			     rank - 1, -1);
+	}
+	sprintf(limitstr, "%d", around + 1);
+	read_topten_rows(&list, &len, &size, PREP_TOPTEN_BELOW, 3, params,
+			 rank, 1);
+    }
+    
+    if (own && player) {
+	sprintf(limitstr, "%d", TOPTEN_MAX_ENTRIES);
+	params[0] = player;
+	params[1] = limitstr;
+	read_topten_rows(&list, &len, &size, PREP_TOPTEN_OWN, 2, params, 0, 0);
+    }
+    
+    /* the parts of the selection may overlap */
+    qsort(list, len, sizeof(struct nh_topten_entry), compare_rank);
+    for (i = 0, j = 0; i < len; i++) {
+	if (j > 0 && list[j-1].rank == list[i].rank)
+	    continue;
+	list[j] = list[i];
+	list[j].highlight = (rank && list[j].rank == rank);
+	j++;
+    }
+    
+    *count = j;
+    return list;
+}
+
 /* db_pgsql.c */
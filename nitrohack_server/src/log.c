@@ -108,8 +108,11 @@ void report_startup(void)
     log_msg("  ipv4addr = %s", addr2str(&settings.bind_addr_4));
     log_msg("  ipv6addr = %s", addr2str(&settings.bind_addr_6));
     log_msg("  unixsocket = %s", addr2str(&settings.bind_addr_unix));
+    if (settings.metrics_addr.sun_family)
+	log_msg("  metrics_socket = %s", settings.metrics_addr.sun_path);
     log_msg("  port = %d", settings.port);
     log_msg("  client_timeout = %d", settings.client_timeout);
+    log_msg("  hibernate_timeout = %d", settings.hibernate_timeout);
     
     /* database settings */
     log_msg("  dbhost = %s", settings.dbhost ? settings.dbhost : "(not set)");
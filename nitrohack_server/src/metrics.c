@@ -0,0 +1,385 @@
+/* The DynaHack server may be freely redistributed under the terms of either:
+ *  - the NetHack license
+ *  - the GNU General Public license v2 or later
+ */
+
+/*
+ * Server metrics.
+ *
+ * The master process maps a small shared memory region before it forks any
+ * game processes. Every process adds its counters and timings to this region
+ * directly with atomic operations, so the numbers are always aggregated over
+ * all running and finished games without any extra messages on the pipes.
+ *
+ * Timings are kept in log-linear histograms (in the style of HdrHistogram):
+ * each power of two of microseconds is split into 1 << HIST_SUB_BITS buckets,
+ * which bounds the relative error of a bucket to 25% for any duration from a
+ * microsecond up to two minutes. Longer durations are only counted in a
+ * final overflow bucket, which is reported as le="+Inf".
+ *
+ * If the metrics_socket setting is given, the master process listens on that
+ * unix socket. Each connection receives one report in the plain text
+ * exposition format understood by Prometheus and is then closed, so the
+ * report can also be read with "socat - UNIX-CONNECT:<path>".
+ * These connections are non-blocking and are written from the main event
+ * loop, so that a slow reader can't hold up the games.
+ */
+
+#include "nhserver.h"
+
+#include <stdarg.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+
+#define HIST_SUB_BITS	2
+#define HIST_SUB	(1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS	27 /* the last bucket ends at 2^27 us, about 134s */
+#define HIST_BUCKETS	((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+#define HIST_OVERFLOW	HIST_BUCKETS /* everything from 2^27 us up */
+
+/* metrics connections still being written; more are refused */
+#define MAX_REPORT_CONNS 8
+
+struct metric_hist {
+    unsigned long long sum; /* in microseconds */
+    unsigned long long buckets[HIST_BUCKETS + 1];
+};
+
+struct metrics_region {
+    unsigned long long counters[MC_COUNT];
+    struct metric_hist hist[1]; /* MH_COMMAND + number of client commands */
+};
+
+static struct metrics_region *metrics;
+static size_t metrics_size;
+static int command_count;
+
+/* a report that didn't fit into the socket buffer at once */
+struct report_conn {
+    int fd;
+    char *buf;
+    int len, pos;
+};
+static struct report_conn report_conns[MAX_REPORT_CONNS];
+static int report_conn_count;
+
+static const struct {
+    const char *name, *type, *help;
+} counter_desc[MC_COUNT] = {
+    {"connections_total", "counter", "Accepted client connections."},
+    {"games_started_total", "counter", "Game processes handed a client, "
+	"including reconnects after hibernation."},
+    {"spare_handoffs_total", "counter", "Games started in a spare process."},
+    {"hibernations_total", "counter", "Idle games saved to free their process."},
+    {"relay_in_bytes_total", "counter", "Bytes relayed from clients to games."},
+    {"relay_out_bytes_total", "counter", "Bytes relayed from games to clients."},
+    {"relay_out_bursts_total", "counter", "Bursts of game output relayed to "
+	"clients; usually one per message."},
+    {"clients_connected", "gauge", "Games with a connected client."},
+    {"clients_disconnected", "gauge", "Games waiting for their client to reconnect."},
+};
+
+static const struct {
+    const char *name, *help;
+} hist_desc[MH_COMMAND] = {
+    {"save_seconds", "Time spent saving and diffing the game after a command."},
+    {"encode_seconds", "Time spent encoding messages to the client as JSON."},
+    {"db_seconds", "Time spent waiting for database queries."},
+};
+
+
+int init_metrics(void)
+{
+    void *map;
+
+    for (command_count = 0; clientcmd[command_count].name; command_count++)
+	;
+
+    metrics_size = sizeof(struct metrics_region) +
+		   (MH_COMMAND + command_count - 1) * sizeof(struct metric_hist);
+    /* MAP_SHARED | MAP_ANONYMOUS memory stays shared with all forked children.
+     * It starts out zeroed. */
+    map = mmap(NULL, metrics_size, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+	log_msg("Failed to allocate memory for metrics: %s", strerror(errno));
+	return FALSE;
+    }
+    metrics = map;
+
+    return TRUE;
+}
+
+
+void end_metrics(void)
+{
+    while (report_conn_count) {
+	report_conn_count--;
+	close(report_conns[report_conn_count].fd);
+	free(report_conns[report_conn_count].buf);
+    }
+    if (metrics)
+	munmap(metrics, metrics_size);
+    metrics = NULL;
+}
+
+
+/* monotonic time in microseconds, used as the start value for metrics_record */
+unsigned long long metrics_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+void metrics_add(enum metric_counter counter, unsigned long long n)
+{
+    if (metrics)
+	__atomic_fetch_add(&metrics->counters[counter], n, __ATOMIC_RELAXED);
+}
+
+
+/* gauges are only ever set by the master process */
+void metrics_set(enum metric_counter counter, unsigned long long val)
+{
+    if (metrics)
+	__atomic_store_n(&metrics->counters[counter], val, __ATOMIC_RELAXED);
+}
+
+
+static int hist_bucket(unsigned long long usec)
+{
+    int msb;
+
+    if (usec < HIST_SUB)
+	return usec;
+
+    msb = 63 - __builtin_clzll(usec);
+    if (msb >= HIST_MAX_BITS)
+	return HIST_OVERFLOW;
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB +
+	   ((usec >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+
+/* largest value (in microseconds) that falls into the given bucket */
+static unsigned long long hist_bucket_limit(int bucket)
+{
+    int shift;
+
+    if (bucket < HIST_SUB)
+	return bucket;
+
+    shift = bucket / HIST_SUB - 1;
+    return ((unsigned long long)(HIST_SUB + bucket % HIST_SUB + 1) << shift) - 1;
+}
+
+
+/*
+ * Add the time elapsed since start (a value from metrics_now()) to a
+ * histogram. hist is either one of MH_SAVE, MH_ENCODE, MH_DB or MH_COMMAND
+ * plus the index of a client command.
+ */
+void metrics_record(int hist, unsigned long long start)
+{
+    unsigned long long now = metrics_now();
+    unsigned long long usec = now > start ? now - start : 0;
+    struct metric_hist *h;
+
+    if (!metrics || hist < 0 || hist >= MH_COMMAND + command_count)
+	return;
+
+    h = &metrics->hist[hist];
+    __atomic_fetch_add(&h->buckets[hist_bucket(usec)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, usec, __ATOMIC_RELAXED);
+}
+
+
+/* Save timer callback for the game library, see nh_set_save_timer(). */
+void metrics_save_timer(nh_bool done)
+{
+    static unsigned long long start;
+
+    if (!done)
+	start = metrics_now();
+    else
+	metrics_record(MH_SAVE, start);
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+struct report {
+    char *buf;
+    int len, size;
+};
+
+static void report_printf(struct report *r, const char *fmt, ...)
+{
+    va_list args;
+    int len;
+
+    while (1) {
+	va_start(args, fmt);
+	len = vsnprintf(r->buf + r->len, r->size - r->len, fmt, args);
+	va_end(args);
+	if (len < r->size - r->len)
+	    break;
+	r->size = r->size * 2 + len;
+	r->buf = realloc(r->buf, r->size);
+    }
+    r->len += len;
+}
+
+
+static void report_hist(struct report *r, const char *name, const char *label,
+			const struct metric_hist *h)
+{
+    unsigned long long cumulative = 0;
+    int i;
+
+    /* only buckets that contain anything are listed; that is valid since
+     * the buckets are cumulative. The total is taken from the buckets as
+     * well, so that a concurrent update can't make it inconsistent. */
+    for (i = 0; i < HIST_BUCKETS; i++) {
+	unsigned long long n = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+	if (!n)
+	    continue;
+	cumulative += n;
+	report_printf(r, "nhserver_%s_bucket{%s%sle=\"%.6f\"} %llu\n", name,
+		      label, *label ? "," : "",
+		      hist_bucket_limit(i) / 1000000.0, cumulative);
+    }
+    cumulative += __atomic_load_n(&h->buckets[HIST_OVERFLOW], __ATOMIC_RELAXED);
+    report_printf(r, "nhserver_%s_bucket{%s%sle=\"+Inf\"} %llu\n", name,
+		  label, *label ? "," : "", cumulative);
+    report_printf(r, "nhserver_%s_sum%s%s%s %.6f\n", name, *label ? "{" : "",
+		  label, *label ? "}" : "",
+		  __atomic_load_n(&h->sum, __ATOMIC_RELAXED) / 1000000.0);
+    report_printf(r, "nhserver_%s_count%s%s%s %llu\n", name, *label ? "{" : "",
+		  label, *label ? "}" : "", cumulative);
+}
+
+
+static char *metrics_report(int *len)
+{
+    struct report r = {NULL, 0, 0};
+    char label[128];
+    int i;
+
+    for (i = 0; i < MC_COUNT; i++) {
+	report_printf(&r, "# HELP nhserver_%s %s\n", counter_desc[i].name,
+		      counter_desc[i].help);
+	report_printf(&r, "# TYPE nhserver_%s %s\n", counter_desc[i].name,
+		      counter_desc[i].type);
+	report_printf(&r, "nhserver_%s %llu\n", counter_desc[i].name,
+		      __atomic_load_n(&metrics->counters[i], __ATOMIC_RELAXED));
+    }
+
+    for (i = 0; i < MH_COMMAND; i++) {
+	report_printf(&r, "# HELP nhserver_%s %s\n", hist_desc[i].name,
+		      hist_desc[i].help);
+	report_printf(&r, "# TYPE nhserver_%s histogram\n", hist_desc[i].name);
+	report_hist(&r, hist_desc[i].name, "", &metrics->hist[i]);
+    }
+
+    report_printf(&r, "# HELP nhserver_command_seconds Time spent executing "
+		  "client commands, excluding time spent waiting for the player.\n");
+    report_printf(&r, "# TYPE nhserver_command_seconds histogram\n");
+    for (i = 0; i < command_count; i++) {
+	snprintf(label, sizeof(label), "command=\"%s\"", clientcmd[i].name);
+	report_hist(&r, "command_seconds", label, &metrics->hist[MH_COMMAND + i]);
+    }
+
+    *len = r.len;
+    return r.buf;
+}
+
+
+/*
+ * Write as much of a report as the socket takes now. Returns FALSE once the
+ * connection is finished, either because everything was sent or because of
+ * an error.
+ */
+static int report_write(struct report_conn *rc)
+{
+    int ret;
+
+    while (rc->pos < rc->len) {
+	ret = write(rc->fd, &rc->buf[rc->pos], rc->len - rc->pos);
+	if (ret == -1 && errno == EINTR)
+	    continue;
+	else if (ret == -1 && errno == EAGAIN)
+	    return TRUE;
+	else if (ret <= 0)
+	    return FALSE;
+	rc->pos += ret;
+    }
+    return FALSE;
+}
+
+
+/*
+ * A connection on the metrics socket is ready to be accepted: send the
+ * report and close it again. A report that doesn't fit into the socket
+ * buffer is queued and finished by metrics_conn_event().
+ */
+void metrics_socket_event(int server_fd, int epfd)
+{
+    struct epoll_event ev;
+    struct report_conn rc;
+
+    while ((rc.fd = accept4(server_fd, NULL, NULL,
+			    SOCK_CLOEXEC | SOCK_NONBLOCK)) != -1) {
+	if (!metrics || report_conn_count == MAX_REPORT_CONNS) {
+	    close(rc.fd);
+	    continue;
+	}
+
+	rc.buf = metrics_report(&rc.len);
+	rc.pos = 0;
+	if (report_write(&rc)) {
+	    memset(&ev, 0, sizeof(ev));
+	    ev.events = EPOLLOUT | EPOLLRDHUP;
+	    ev.data.fd = rc.fd;
+	    if (epoll_ctl(epfd, EPOLL_CTL_ADD, rc.fd, &ev) != -1) {
+		report_conns[report_conn_count++] = rc;
+		continue;
+	    }
+	}
+	free(rc.buf);
+	close(rc.fd);
+    }
+}
+
+
+/*
+ * Continue sending a queued report. Returns FALSE if fd isn't a metrics
+ * connection.
+ */
+int metrics_conn_event(int fd, int epfd, unsigned int event_mask)
+{
+    struct report_conn *rc;
+    int i;
+
+    for (i = 0; i < report_conn_count; i++)
+	if (report_conns[i].fd == fd)
+	    break;
+    if (i == report_conn_count)
+	return FALSE;
+
+    rc = &report_conns[i];
+    if (!(event_mask & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && report_write(rc))
+	return TRUE;
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    free(rc->buf);
+    report_conns[i] = report_conns[--report_conn_count];
+    return TRUE;
+}
+
+/* metrics.c */
@@ -44,6 +44,12 @@
  * inactivity, though).
  * When the connection is re-established, the client's requests get forwarded
  * again.
+ *
+ * To keep the time from login to the first screen short, the server keeps a
+ * few spare game processes around. They are forked ahead of time, connect to
+ * the database and initialize the game library, then wait on a unix socket.
+ * A new game is started by passing the game ends of the pipes to one of them
+ * (SCM_RIGHTS). A fresh process is forked only if no spare is available.
  */
 
 #include "nhserver.h"
@@ -54,6 +60,7 @@
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #if defined(OPEN_MAX)
 static int get_open_max(void) { return OPEN_MAX; }
@@ -70,6 +77,10 @@ static int get_open_max(void) { return sysconf(_SC_OPEN_MAX); }
 /* make the buffer slightly bigger to detect when the client sends too much data */
 #define AUTHBUFSIZE 512
 
+/* size of the per-client buffer for data going from the game to the client.
+ * When it is full, the pipe is not read until the socket accepts more data. */
+#define OUTBUF_SIZE 65536
+
 enum comm_status {
     NEW_CONNECTION,
     CLIENT_DISCONNECTED,
@@ -88,12 +99,14 @@ struct client_data {
     int pid;
     int userid; /* owner of this game */
     int connid;
+    int caps; /* NHNET_CAP_* features supported by the connected client */
     struct client_data *prev, *next;
     int pipe_out; /* master -> game pipe */
     int pipe_in;/* game -> master pipe */
     int sock; /* master <-> client socket */
-    int unsent_data_size;
-    char *unsent_data;
+    char *outbuf; /* ring buffer of OUTBUF_SIZE bytes, allocated on first use */
+    int out_start, out_len; /* position and amount of unsent data in outbuf */
+    int corked; /* TCP_CORK is set on sock */
 };
 
 
@@ -113,6 +126,14 @@ static struct client_data connected_list_head;
 static struct client_data **fd_to_client;
 static int client_count, fd_to_client_max;
 
+/* spare game processes waiting for a game, see the comment at the top */
+struct spare_process {
+    int pid;
+    int sock; /* master end of the socket the pipes are passed over */
+};
+static struct spare_process *spares;
+static int spare_count;
+
 /*---------------------------------------------------------------------------*/
 
 
@@ -251,26 +272,118 @@ static void post_fork_cleanup(void)
     
     for (ccur = disconnected_list_head.next; ccur; ccur = cnext) {
 	cnext = ccur->next;
+	free(ccur->outbuf);
 	free(ccur);
     }
     
     for (ccur = connected_list_head.next; ccur; ccur = cnext) {
 	cnext = ccur->next;
+	free(ccur->outbuf);
 	free(ccur);
     }
     
     free(fd_to_client);
+    free(spares);
+}
+
+
+/*
+ * Fork spare game processes until there are settings.spare_processes of them.
+ */
+static void spawn_spares(void)
+{
+    int sv[2], pid;
+    
+    while (spare_count < settings.spare_processes) {
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+	    log_msg("Failed to create a socket for a spare process: %s",
+		    strerror(errno));
+	    return;
+	}
+	/* neither the spare nor any later child needs the master end */
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	
+	pid = fork();
+	if (pid == 0) {
+	    post_fork_cleanup();
+	    spare_main(sv[1]);
+	    exit(0); /* shouldn't get here... */
+	}
+	
+	close(sv[1]);
+	if (pid == -1) {
+	    close(sv[0]);
+	    log_msg("Failed to fork a spare process: %s", strerror(errno));
+	    return;
+	}
+	spares[spare_count].pid = pid;
+	spares[spare_count].sock = sv[0];
+	spare_count++;
+    }
+}
+
+
+/*
+ * Hand a new game to a waiting spare process by sending it the game ends of
+ * the communication pipes. Returns the pid of the spare that took the game,
+ * or 0 if there was none.
+ */
+static int start_in_spare(struct client_data *client, int infd, int outfd)
+{
+    struct spare_process spare;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    int data[2], ret;
+    char cbuf[CMSG_SPACE(2 * sizeof(int))];
+    
+    while (spare_count > 0) {
+	spare = spares[--spare_count];
+	
+	data[0] = client->userid;
+	data[1] = client->caps;
+	iov.iov_base = data;
+	iov.iov_len = sizeof(data);
+	
+	memset(&msg, 0, sizeof(msg));
+	memset(cbuf, 0, sizeof(cbuf));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	((int*)CMSG_DATA(cmsg))[0] = infd;
+	((int*)CMSG_DATA(cmsg))[1] = outfd;
+	
+	do {
+	    ret = sendmsg(spare.sock, &msg, MSG_NOSIGNAL);
+	} while (ret == -1 && errno == EINTR);
+	close(spare.sock);
+	
+	if (ret == sizeof(data)) {
+	    metrics_add(MC_SPARE_HANDOFFS, 1);
+	    return spare.pid;
+	}
+	
+	/* this spare exited early, perhaps it could not reach the database */
+	log_msg("Spare process %d is gone: %s", spare.pid, strerror(errno));
+    }
+    
+    return 0;
 }
 
 
 /*
  * A new game process is needed.
- * Create the communication pipes, register them with epoll and fork the new
- * process.
+ * Create the communication pipes, register them with epoll and pass them to a
+ * spare process or fork a new one.
  */
 static int fork_client(struct client_data *client, int epfd)
 {
-    int ret1, ret2, userid;
+    int ret1, ret2, userid, caps;
     int pipe_out_fd[2];
     int pipe_in_fd[2];
     struct epoll_event ev;
@@ -301,12 +414,15 @@ static int fork_client(struct client_data *client, int epfd)
     map_fd_to_client(client->pipe_out, client);
     map_fd_to_client(client->pipe_in, client);
     
-    client->pid = fork();
+    client->pid = start_in_spare(client, pipe_out_fd[0], pipe_in_fd[1]);
+    if (!client->pid)
+	client->pid = fork();
     if (client->pid > 0) { /* parent */
     } else if (client->pid == 0) { /* child */
 	userid = client->userid;
+	caps = client->caps;
 	post_fork_cleanup();
-	client_main(userid, pipe_out_fd[0], pipe_in_fd[1]);
+	client_main(userid, caps, pipe_out_fd[0], pipe_in_fd[1]);
 	exit(0); /* shouldn't get here... client is done. */
     } else if (client->pid == -1) { /* error */
 	/* can't proceed, so clean up. The client side of the pipes needs to be
@@ -321,6 +437,7 @@ static int fork_client(struct client_data *client, int epfd)
     client->state = CLIENT_CONNECTED;
     unlink_client_data(client);
     link_client_data(client, &connected_list_head);
+    metrics_add(MC_GAMES_STARTED, 1);
     
     /* register the pipe fds for monitoring by epoll */
     ev.data.ptr = NULL;
@@ -352,6 +469,7 @@ static void server_socket_event(int server_fd, int epfd)
     newfd = accept4(server_fd, (struct sockaddr*)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (newfd == -1) /* maybe the connection attempt was aborted early? */
 	return;
+    metrics_add(MC_CONNECTIONS, 1);
     
     /* no need to complain if this setsockopt fails; TCP_NODELAY doesn't exist
      * for AF_UNIX sockets. */
@@ -383,7 +501,8 @@ static void handle_new_connection(int newfd, int epfd)
     struct sockaddr_storage addr;
     socklen_t addrlen = sizeof(addr);
     char authbuf[AUTHBUFSIZE];
-    int pos, is_reg, reconnect_id, authlen, userid;
+    char resetbuf[2];
+    int pos, is_reg, reconnect_id, authlen, userid, caps;
     static int connection_id = 1;
     
     if (fd_to_client_max > newfd && fd_to_client[newfd] == &new_connection_dummy) {
@@ -423,7 +542,7 @@ static void handle_new_connection(int newfd, int epfd)
     /*
      * ready to authenticate the user here
      */
-    userid = auth_user(authbuf, addr2str(&addr), &is_reg, &reconnect_id);
+    userid = auth_user(authbuf, addr2str(&addr), &is_reg, &reconnect_id, &caps);
     if (userid <= 0) {
 	if (!userid)
 	    auth_send_result(newfd, AUTH_FAILED_UNKNOWN_USER, is_reg, 0);
@@ -463,9 +582,13 @@ static void handle_new_connection(int newfd, int epfd)
 	client->sock = newfd;
 	map_fd_to_client(client->sock, client);
 	client->state = CLIENT_CONNECTED;
+	client->caps = caps;
 	unlink_client_data(client);
 	link_client_data(client, &connected_list_head);
-	write(client->pipe_out, "\033", 1); /* signal to reset the read buffer */
+	/* signal to reset the read buffer; the new client's features follow */
+	resetbuf[0] = '\033';
+	resetbuf[1] = caps;
+	write(client->pipe_out, resetbuf, 2);
 	
 	log_msg("Connection to game at pid %d reestablished for user %d",
 		client->pid, client->userid);
@@ -477,6 +600,7 @@ static void handle_new_connection(int newfd, int epfd)
 	map_fd_to_client(newfd, client);
 	client->connid = connection_id++;
 	client->userid = userid;
+	client->caps = caps;
 	/* there is no process yet */
 	if (fork_client(client, epfd))
 	    auth_send_result(newfd, AUTH_SUCCESS_NEW, is_reg, client->connid);
@@ -518,6 +642,7 @@ static void cleanup_game_process(struct client_data *client, int epfd)
     
     client->pipe_in = client->pipe_out = client->sock = -1;
     unlink_client_data(client);
+    free(client->outbuf);
     free(client);
     
     log_msg("There are now %d clients on the server", client_count);
@@ -548,7 +673,7 @@ static void close_client_pipe(struct client_data *client, int epfd)
     }
     
     
-    if (client->sock)
+    if (client->sock != -1)
 	/* allow a send to complete (incl retransmits). close() is too brutal. */
 	shutdown(client->sock, SHUT_RDWR);
     else {
@@ -560,45 +685,133 @@ static void close_client_pipe(struct client_data *client, int epfd)
 }
 
 
-static int send_to_client(struct client_data *client, char *buffer, int sendlen)
+static void set_cork(struct client_data *client, int cork)
 {
-    int sent, ret;
-    char *newbuf;
+    if (client->corked == cork)
+	return;
+    /* fails harmlessly on unix sockets */
+    setsockopt(client->sock, IPPROTO_TCP, TCP_CORK, &cork, sizeof(int));
+    client->corked = cork;
+}
+
+
+/*
+ * Fill the free part of the output ring from the game pipe.
+ * Returns 1 if the pipe has been drained (or the ring is full), 0 on EOF and
+ * -1 on error.
+ */
+static int fill_outbuf(struct client_data *client)
+{
+    struct iovec iov[2];
+    int end, iovcnt, ret;
     
-    if (!buffer) {
-	buffer = client->unsent_data;
-	sendlen = client->unsent_data_size;
-	if (!buffer)
+    while (client->out_len < OUTBUF_SIZE) {
+	end = (client->out_start + client->out_len) % OUTBUF_SIZE;
+	iov[0].iov_base = &client->outbuf[end];
+	if (end >= client->out_start) {
+	    /* the free space may wrap around the end of the buffer */
+	    iov[0].iov_len = OUTBUF_SIZE - end;
+	    iov[1].iov_base = client->outbuf;
+	    iov[1].iov_len = client->out_start;
+	    iovcnt = client->out_start ? 2 : 1;
+	} else {
+	    iov[0].iov_len = client->out_start - end;
+	    iovcnt = 1;
+	}
+	
+	ret = readv(client->pipe_in, iov, iovcnt);
+	if (ret == -1 && errno == EINTR)
+	    continue;
+	else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	    return 1;
+	else if (ret == -1)
+	    return -1;
+	else if (ret == 0)
 	    return 0;
+	client->out_len += ret;
     }
+    return 1;
+}
+
+
+/*
+ * Send as much of the output ring as the socket will take.
+ * Returns 1 if everything was sent, 0 if the socket is full and -1 on error.
+ */
+static int flush_outbuf(struct client_data *client)
+{
+    struct iovec iov[2];
+    int iovcnt, ret;
     
-    sent = 0;
-    do {
-	ret = write(client->sock, &buffer[sent], sendlen - sent);
-	if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-	    /* be careful, buffer == client->unsent_data is possible */
-	    newbuf = malloc(sendlen - sent);
-	    memcpy(newbuf, &buffer[sent], sendlen - sent);
-	    if (client->unsent_data)
-		free(client->unsent_data);
-	    client->unsent_data = newbuf;
-	    client->unsent_data_size = sendlen - sent;
-	    return sent;
+    while (client->out_len) {
+	iov[0].iov_base = &client->outbuf[client->out_start];
+	if (client->out_start + client->out_len > OUTBUF_SIZE) {
+	    iov[0].iov_len = OUTBUF_SIZE - client->out_start;
+	    iov[1].iov_base = client->outbuf;
+	    iov[1].iov_len = client->out_len - iov[0].iov_len;
+	    iovcnt = 2;
+	} else {
+	    iov[0].iov_len = client->out_len;
+	    iovcnt = 1;
 	}
-	else if (ret == -1 && errno == EPIPE) {
-	    shutdown(client->sock, SHUT_RDWR);
-	    return -1;
-	} else if (ret == -1 && errno != EINTR)
+	
+	ret = writev(client->sock, iov, iovcnt);
+	if (ret == -1 && errno == EINTR)
+	    continue;
+	else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	    return 0;
+	else if (ret == -1) {
+	    if (errno == EPIPE)
+		shutdown(client->sock, SHUT_RDWR);
 	    return -1;
-	sent += ret;
-    } while (sent < sendlen);
+	}
+	client->out_start = (client->out_start + ret) % OUTBUF_SIZE;
+	client->out_len -= ret;
+	metrics_add(MC_RELAY_OUT_BYTES, ret);
+    }
+    client->out_start = 0; /* keep the data contiguous when possible */
+    return 1;
+}
 
-    if (client->unsent_data)
-	free(client->unsent_data);
-    client->unsent_data = NULL;
-    client->unsent_data_size = 0;
+
+/*
+ * Move data from the game pipe to the client socket until either the pipe
+ * runs dry or the socket can't take any more. In the second case the rest
+ * waits in the ring (and the pipe stays unread once the ring is full) until
+ * EPOLLOUT reports that the socket is writable again.
+ * 
+ * The game process writes a complete message and then waits for the next
+ * command, so an empty pipe marks the end of a message. The socket is corked
+ * while a message is being relayed in several pieces and uncorked at the end
+ * so that the final partial segment goes out immediately.
+ */
+static void relay_output(struct client_data *client)
+{
+    int rret, wret, full;
     
-    return sent;
+    if (!client->outbuf)
+	client->outbuf = malloc(OUTBUF_SIZE);
+    
+    do {
+	rret = fill_outbuf(client);
+	if (rret == -1)
+	    log_msg("error while reading from pipe: %s", strerror(errno));
+	full = (client->out_len == OUTBUF_SIZE);
+	if (full)
+	    set_cork(client, TRUE); /* more of this message is waiting */
+	wret = flush_outbuf(client);
+	if (wret == -1) {
+	    log_msg("error while sending: %s", strerror(errno));
+	    client->out_start = client->out_len = 0; /* nowhere to send it */
+	}
+	/* a full ring may have left more data in the pipe */
+    } while (rret == 1 && wret == 1 && full);
+    
+    if (client->out_len == 0) {
+	set_cork(client, FALSE);
+	if (rret == 1 && wret == 1)
+	    metrics_add(MC_RELAY_OUT_BURSTS, 1); /* usually a whole message */
+    }
 }
 
 
@@ -611,9 +824,8 @@ static int send_to_client(struct client_data *client, char *buffer, int sendlen)
  */
 static void handle_communication(int fd, int epfd, unsigned int event_mask)
 {
-    int ret, closed, write_count, errno_orig, read_ret, write_ret;
+    int closed, write_count, read_ret, write_ret;
     struct client_data *client = fd_to_client[fd];
-    struct epoll_event ev;
     char buf[16384];
     
     if (event_mask & EPOLLERR || /* fd error */
@@ -631,6 +843,8 @@ static void handle_communication(int fd, int epfd, unsigned int event_mask)
 	    client->sock = -1;
 	    if (client->pipe_in != -1 && client->pipe_out != -1) {
 		log_msg("User %d has disconnected from a game", client->userid);
+		/* let the game know, so that it can hibernate */
+		write(client->pipe_out, "\034", 1);
 		client->state = CLIENT_DISCONNECTED;
 		unlink_client_data(client);
 		link_client_data(client, &disconnected_list_head);
@@ -640,13 +854,10 @@ static void handle_communication(int fd, int epfd, unsigned int event_mask)
 		cleanup_game_process(client, epfd);
 	    }
 	    /* Maybe the destination vanished before sending completed...
-	     * unsent_data is likely to be an incomplete JSON object; deleting
-	     * it is the only sane option. */
-	    if (client->unsent_data)
-		free(client->unsent_data);
-	    client->unsent_data = NULL;
-	    client->unsent_data_size = 0;
-		
+	     * the unsent data is likely to be an incomplete JSON object;
+	     * deleting it is the only sane option. */
+	    client->out_start = client->out_len = 0;
+	    client->corked = FALSE;
 	
 	} else { /* it is possible to receive or send data */
 	    if (event_mask & EPOLLIN) {
@@ -667,24 +878,18 @@ static void handle_communication(int fd, int epfd, unsigned int event_mask)
 			    break;
 			write_count += write_ret;
 		    } while (write_count < read_ret);
+		    metrics_add(MC_RELAY_IN_BYTES, write_count);
 		} while (read_ret == sizeof(buf) && write_ret != -1);
 		if (read_ret <= 0 || write_ret == -1) {
 		    log_msg("data transfer error for game process %d (read = %d, write = %d): %s", client->pid, read_ret, write_ret, strerror(errno));
 		    cleanup_game_process(client, epfd);
 		}
 	    }
-	    if ((event_mask & EPOLLOUT) && client->unsent_data) {
-		write_count = send_to_client(client, NULL, 0);
-		if (write_count == -1)
-		    log_msg("error while sending: %s", strerror(errno));
-		
-		/* re-arm pipe_in notification: there may be more data to send in the
-		 * pipe for which an event was already received but not acted upon */
-		ev.data.ptr = NULL;
-		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
-		ev.data.fd = client->pipe_in;
-		epoll_ctl(epfd, EPOLL_CTL_MOD, client->pipe_in, &ev);
-	    }
+	    /* the socket accepts data again: send what is waiting in the ring
+	     * and pick up anything left in the pipe while it was full */
+	    if ((event_mask & EPOLLOUT) && client->out_len &&
+		client->pipe_in != -1)
+		relay_output(client);
 	}
 
     } else if (fd == client->pipe_in) {
@@ -692,31 +897,14 @@ static void handle_communication(int fd, int epfd, unsigned int event_mask)
 	    close_client_pipe(client, epfd);
 
 	else { /* there is data to send */
-	    if (client->unsent_data)
+	    if (client->out_len)
 		return; /* socket isn't ready for sending */
 	    
 	    /* oddity alert: this code originally used splice for sending.
 	     * That would match the receive case above and no buffer would be
 	     * required. Unfortunately sending that way is significantly slower.
 	     * splice: 200ms - read+write: 0.2ms! Ouch! */
-	    do {
-		/* read from the pipe */
-		ret = read(client->pipe_in, buf, sizeof(buf));
-		errno_orig = errno;
-		if (ret == -1 && errno == EINTR)
-		    continue;
-		else if (ret > 0) {
-		    /* write to the socket; be careful to write all of it... */
-		    write_count = send_to_client(client, buf, ret);
-		    /* write_count != ret if no more data could be sent and the
-		     * remainder buf was copied to client->unsent_data for later
-		     * sending  */
-		}
-	    } while (ret == write_count && ret == sizeof(buf));
-	    if (ret == -1)
-		log_msg("error while reading from pipe: %s", strerror(errno_orig));
-	    if (write_count == -1)
-		log_msg("error while sending: %s", strerror(errno));
+	    relay_output(client);
 	}
 
     } else if (fd == client->pipe_out) {
@@ -731,7 +919,8 @@ static void handle_communication(int fd, int epfd, unsigned int event_mask)
 }
 
 
-static int setup_server_sockets(int *ipv4fd, int *ipv6fd, int *unixfd, int epfd)
+static int setup_server_sockets(int *ipv4fd, int *ipv6fd, int *unixfd,
+				int *metricsfd, int epfd)
 {
     struct epoll_event ev;
     ev.data.ptr = NULL;
@@ -755,7 +944,8 @@ static int setup_server_sockets(int *ipv4fd, int *ipv6fd, int *unixfd, int epfd)
     } else
 	*ipv4fd = -1;
     
-    if (settings.bind_addr_unix.sun_family && remove_unix_socket()) {
+    if (settings.bind_addr_unix.sun_family &&
+	remove_unix_socket(&settings.bind_addr_unix)) {
 	int prevmask = umask(0);
 	*unixfd = init_server_socket((struct sockaddr*)&settings.bind_addr_unix);
 	ev.data.fd = *unixfd;
@@ -764,6 +954,17 @@ static int setup_server_sockets(int *ipv4fd, int *ipv6fd, int *unixfd, int epfd)
 	umask(prevmask);
     }
     
+    /* the metrics socket keeps the default umask: the report is not meant
+     * for everyone */
+    *metricsfd = -1;
+    if (settings.metrics_addr.sun_family &&
+	remove_unix_socket(&settings.metrics_addr) && init_metrics()) {
+	*metricsfd = init_server_socket((struct sockaddr*)&settings.metrics_addr);
+	ev.data.fd = *metricsfd;
+	if (*metricsfd != -1)
+	    epoll_ctl(epfd, EPOLL_CTL_ADD, *metricsfd, &ev);
+    }
+    
     if (*ipv4fd == -1 && *ipv6fd == -1) {
 	log_msg("Failed to create any listening socket. Nothing to do except shut down.");
 	return FALSE;
@@ -773,6 +974,16 @@ static int setup_server_sockets(int *ipv4fd, int *ipv6fd, int *unixfd, int epfd)
 }
 
 
+static int count_clients(struct client_data *list)
+{
+    int count = 0;
+    
+    for (list = list->next; list; list = list->next)
+	count++;
+    return count;
+}
+
+
 /*
  * The signal handler for SIGTERM and SIGINT ran and set termination_flag to 1
  * to indicate the shutdown request.
@@ -814,13 +1025,15 @@ static int trigger_server_shutdown(struct timeval *tv, int *ipv4fd, int *ipv6fd,
  */
 int runserver(void)
 {
-    int i, ipv4fd, ipv6fd, unixfd, epfd, nfds, timeout, fd, childstatus;
+    int i, ipv4fd, ipv6fd, unixfd, metricsfd, epfd, nfds, timeout, fd,
+	childstatus;
     struct epoll_event events[MAX_EVENTS];
     struct client_data *client;
     struct timeval sigtime, curtime, tmp;
     
     fd_to_client_max = 64; /* will be doubled every time it becomes too small */
     fd_to_client = malloc(fd_to_client_max * sizeof(struct client_data*));
+    spares = malloc(settings.spare_processes * sizeof(struct spare_process));
     
     epfd = epoll_create1(EPOLL_CLOEXEC);
     if (epfd == -1) {
@@ -828,7 +1041,7 @@ int runserver(void)
 	return FALSE;
     }
     
-    if (!setup_server_sockets(&ipv4fd, &ipv6fd, &unixfd, epfd))
+    if (!setup_server_sockets(&ipv4fd, &ipv6fd, &unixfd, &metricsfd, epfd))
 	return FALSE;
     
     /*
@@ -848,7 +1061,12 @@ int runserver(void)
 	}
 	
 	/* make sure child processes are cleaned up */
-	waitpid(-1, &childstatus, WNOHANG);
+	while (waitpid(-1, &childstatus, WNOHANG) > 0)
+	    ;
+	
+	/* replace spare processes that were handed a game */
+	if (!termination_flag)
+	    spawn_spares();
 	
 	nfds = epoll_wait(epfd, events, MAX_EVENTS, timeout);
 	if (nfds == -1) {
@@ -884,6 +1102,19 @@ int runserver(void)
 		continue;
 	    }
 	    
+	    if (fd == metricsfd) {
+		metrics_set(MC_CLIENTS_CONNECTED,
+			    count_clients(&connected_list_head));
+		metrics_set(MC_CLIENTS_DISCONNECTED,
+			    count_clients(&disconnected_list_head));
+		metrics_socket_event(fd, epfd);
+		continue;
+	    }
+	    
+	    /* a slow reader of the metrics report */
+	    if (metrics_conn_event(fd, epfd, events[i].events))
+		continue;
+	    
 	    /* activity on a client socket or pipe */
 	    client = fd_to_client[fd];
 	    /* was this fd closed while handling a prior event? */
@@ -934,6 +1165,11 @@ int runserver(void)
     } /* while(1) */
 
 finally:
+    /* spare processes exit when their socket is closed */
+    while (spare_count > 0)
+	close(spares[--spare_count].sock);
+    free(spares);
+    
     while (disconnected_list_head.next)
 	cleanup_game_process(disconnected_list_head.next, epfd);
     while (connected_list_head.next)
@@ -946,6 +1182,9 @@ finally:
 	close(ipv6fd);
     if (unixfd != -1)
 	close(unixfd);
+    if (metricsfd != -1)
+	close(metricsfd);
+    end_metrics();
     free(fd_to_client);
 
     return TRUE;
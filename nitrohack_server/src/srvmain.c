@@ -8,21 +8,25 @@
 
 #include <arpa/inet.h>
 
-struct settings settings;
+struct settings settings = {
+    .spare_processes = -1, /* not set */
+    .hibernate_timeout = -1
+};
 int termination_flag;
 
 
 static void print_usage(const char *progname);
 static int read_parameters(int argc, char *argv[], char **conffile,
-			   int *request_kill, int *show_message);
+			   int *request_kill, int *show_message, int *rebuild);
 
 
 int main(int argc, char *argv[])
 {
     char *conffile = NULL;
-    int request_kill = 0, show_message = 0;
+    int request_kill = 0, show_message = 0, rebuild = 0;
     
-    if (!read_parameters(argc, argv, &conffile, &request_kill, &show_message)) {
+    if (!read_parameters(argc, argv, &conffile, &request_kill, &show_message,
+			 &rebuild)) {
 	print_usage(argv[0]);
 	return 1;
     }
@@ -42,6 +46,14 @@ int main(int argc, char *argv[])
 	return 0;
     }
     
+    if (rebuild) {
+	if (!init_database() || !check_database())
+	    return 1;
+	rebuild = rebuild_game_metadata();
+	close_database();
+	return !rebuild;
+    }
+    
     setup_signals();
     
     /* Init files and directories.
@@ -72,7 +84,8 @@ int main(int argc, char *argv[])
     remove_pidfile();
     end_logging();
     close_database();
-    remove_unix_socket();
+    remove_unix_socket(&settings.bind_addr_unix);
+    remove_unix_socket(&settings.metrics_addr);
     free_config();
     
     return 0;
@@ -102,6 +115,8 @@ static void print_usage(const char *progname)
     printf("  -P <number>      Port number. Default: %d\n", DEFAULT_PORT);
     printf("  -p <file name>   Name of the file used to store the pid of a running\n");
     printf("                     server daemon.\n");
+    printf("  -r               Read every game file and rebuild the cached game\n");
+    printf("                     status in the database, then exit.\n");
     printf("  -t <seconds>     Client timeout in seconds. Default: %d.\n", DEFAULT_CLIENT_TIMEOUT);
     printf("  -w <directory>   Working directory which will store user details,\n");
     printf("                     saved games, high score etc.\n");
@@ -120,11 +135,11 @@ static void print_usage(const char *progname)
 
 
 static int read_parameters(int argc, char *argv[], char **conffile,
-			   int *request_kill, int *show_message)
+			   int *request_kill, int *show_message, int *rebuild)
 {
     int opt;
     
-    while ((opt = getopt(argc, argv, "4:6:a:c:D:d:H:hkl:mno:P:p:s:t:u:w:")) != -1) {
+    while ((opt = getopt(argc, argv, "4:6:a:c:D:d:H:hkl:mno:P:p:rs:t:u:w:")) != -1) {
 	switch (opt) {
 	    case '4': /* bind address */
 		if (!parse_ip_addr(optarg, (struct sockaddr*)&settings.bind_addr_4, TRUE)) {
@@ -199,6 +214,10 @@ static int read_parameters(int argc, char *argv[], char **conffile,
 		settings.pidfile = strdup(optarg);
 		break;
 		
+	    case 'r':
+		*rebuild = TRUE;
+		break;
+		
 	    case 's':
 		if (strlen(optarg) > SUN_PATH_MAX - 1) {
 		    fprintf(stderr, "Error: The unix socket filename is too long.\n");
@@ -14,6 +14,8 @@ static void srv_print_message(int turn, const char *msg);
 static void srv_print_message_nonblocking(int turn, const char *msg);
 static void srv_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, int uy);
 static void srv_delay_output(void);
+static void srv_play_animation(struct nh_anim_frame *frames, int nframes,
+			       struct nh_anim_cell *cells, int ux, int uy);
 static void srv_level_changed(int displaymode);
 static void srv_outrip(struct nh_menuitem *items,int icount, nh_bool tombstone,
 	const char *name, int gold, const char *killbuf, int end_how, int year);
@@ -68,6 +70,7 @@ struct nh_window_procs server_windowprocs = {
     srv_level_changed,
     srv_outrip,
     srv_print_message_nonblocking,
+    srv_play_animation,
 };
 
 
@@ -91,6 +94,7 @@ struct nh_window_procs server_alt_windowprocs = {
     srv_alt_level_changed,
     srv_alt_outrip,
     srv_alt_print_message,
+    NULL,
 };
 
 /*---------------------------------------------------------------------------*/
@@ -308,11 +312,137 @@ static void srv_print_message_nonblocking(int turn, const char *msg)
 }
 
 
+/*
+ * Binary display data for clients with NHNET_CAP_BINARY_DISPLAY. The format is
+ * described in section 3 of protocol_specification.txt: runs of unchanged,
+ * zero and explicitly sent cells in the same column-major order as the JSON
+ * encoding, with all numbers written as varints. The result is base64 encoded
+ * to fit into the JSON message.
+ */
+#define DBUF_FORMAT	1
+#define DBUF_RUN_SAME	0
+#define DBUF_RUN_ZERO	1
+#define DBUF_RUN_CELLS	2
+#define DBUF_FIELDS	10
+/* worst case: run header + field mask + every field at 5 bytes, for each cell */
+#define DBUF_BIN_MAX	(1 + ROWNO * COLNO * (5 + 2 + DBUF_FIELDS * 5))
+
+static const char b64chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void base64_encode(const unsigned char *in, int len, char *out)
+{
+    int i;
+    unsigned int v;
+    
+    for (i = 0; i + 2 < len; i += 3) {
+	v = (in[i] << 16) | (in[i+1] << 8) | in[i+2];
+	*out++ = b64chars[(v >> 18) & 63];
+	*out++ = b64chars[(v >> 12) & 63];
+	*out++ = b64chars[(v >> 6) & 63];
+	*out++ = b64chars[v & 63];
+    }
+    if (i < len) {
+	v = in[i] << 16;
+	if (i + 1 < len)
+	    v |= in[i+1] << 8;
+	*out++ = b64chars[(v >> 18) & 63];
+	*out++ = b64chars[(v >> 12) & 63];
+	*out++ = (i + 1 < len) ? b64chars[(v >> 6) & 63] : '=';
+	*out++ = '=';
+    }
+    *out = '\0';
+}
+
+
+static unsigned char *put_varint(unsigned char *out, unsigned int val)
+{
+    while (val >= 0x80) {
+	*out++ = (val & 0x7f) | 0x80;
+	val >>= 7;
+    }
+    *out++ = val;
+    return out;
+}
+
+
+static unsigned char *put_dbe(unsigned char *out, const struct nh_dbuf_entry *dbe)
+{
+    int fields[DBUF_FIELDS] = {dbe->effect, dbe->bg, dbe->trap, dbe->obj,
+	dbe->obj_mn, dbe->objflags, dbe->mon, dbe->monflags, dbe->invis,
+	dbe->dgnflags};
+    unsigned int mask = 0;
+    int i;
+    
+    for (i = 0; i < DBUF_FIELDS; i++)
+	if (fields[i])
+	    mask |= 1 << i;
+    out = put_varint(out, mask);
+    for (i = 0; i < DBUF_FIELDS; i++)
+	if (fields[i]) /* zigzag: small negative numbers stay short */
+	    out = put_varint(out, ((unsigned int)fields[i] << 1) ^
+				  (unsigned int)(fields[i] >> 31));
+    return out;
+}
+
+
+/* Returns NULL if nothing changed since the last update. */
+static json_t *binary_dbuf(struct nh_dbuf_entry dbuf[ROWNO][COLNO])
+{
+    static unsigned char bin[DBUF_BIN_MAX];
+    static char b64[(DBUF_BIN_MAX + 2) / 3 * 4 + 1];
+    unsigned char kind[ROWNO * COLNO], *out;
+    int i, j, x, y, samecount = 0, zerocount = 0;
+    
+    for (i = 0; i < ROWNO * COLNO; i++) {
+	x = i / ROWNO;
+	y = i % ROWNO;
+	if (!memcmp(&dbuf[y][x], &zero_dbuf, sizeof(dbuf[y][x]))) {
+	    kind[i] = DBUF_RUN_ZERO;
+	    zerocount++;
+	    if (!memcmp(&dbuf[y][x], &prev_dbuf[y][x], sizeof(dbuf[y][x])))
+		samecount++;
+	} else if (!memcmp(&dbuf[y][x], &prev_dbuf[y][x], sizeof(dbuf[y][x]))) {
+	    kind[i] = DBUF_RUN_SAME;
+	    samecount++;
+	} else
+	    kind[i] = DBUF_RUN_CELLS;
+    }
+    
+    if (samecount == ROWNO * COLNO)
+	return NULL;
+    if (zerocount == ROWNO * COLNO)
+	return json_integer(0);
+    
+    out = bin;
+    *out++ = DBUF_FORMAT;
+    for (i = 0; i < ROWNO * COLNO; i = j) {
+	for (j = i + 1; j < ROWNO * COLNO && kind[j] == kind[i]; j++)
+	    ;
+	out = put_varint(out, ((j - i) << 2) | kind[i]);
+	if (kind[i] == DBUF_RUN_CELLS)
+	    for (; i < j; i++)
+		out = put_dbe(out, &dbuf[i % ROWNO][i / ROWNO]);
+    }
+    
+    base64_encode(bin, out - bin, b64);
+    return json_string(b64);
+}
+
+
 static void srv_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, int uy)
 {
     int i, x, y, samedbe, samecols, zerodbe, zerocols, is_same, is_zero;
     json_t *jmsg, *jdbuf, *dbufcol, *dbufent;
     
+    if (client_caps & NHNET_CAP_BINARY_DISPLAY) {
+	jdbuf = binary_dbuf(dbuf);
+	if (!jdbuf)
+	    return; /* no point in sending out a message that nothing changed */
+	jmsg = json_pack("{si,si,so}", "ux", ux, "uy", uy, "dbuf", jdbuf);
+	goto send;
+    }
+    
     samecols = 0;
     zerocols = 0;
     jdbuf = json_array();
@@ -379,6 +509,7 @@ static void srv_update_screen(struct nh_dbuf_entry dbuf[ROWNO][COLNO], int ux, i
     } else
 	jmsg = json_pack("{si,si,so}", "ux", ux, "uy", uy, "dbuf", jdbuf);
     
+send:
     add_display_data("update_screen", jmsg);
     
     for (i = 0; i < ROWNO; i++)
@@ -392,6 +523,55 @@ static void srv_delay_output(void)
 }
 
 
+/*
+ * Clients that announced NHNET_CAP_ANIMATION get the whole animation in one
+ * display list entry and play it back locally.  Older clients are sent the
+ * same sequence of update_screen and delay_output entries they would have
+ * received without batching.
+ */
+static void srv_play_animation(struct nh_anim_frame *frames, int nframes,
+			       struct nh_anim_cell *cells, int ux, int uy)
+{
+    static struct nh_dbuf_entry anim_dbuf[ROWNO][COLNO];
+    struct nh_anim_cell *cell;
+    json_t *jframes, *jframe;
+    int i, j;
+    
+    if (!(client_caps & NHNET_CAP_ANIMATION)) {
+	memcpy(anim_dbuf, prev_dbuf, sizeof(anim_dbuf));
+	for (i = 0; i < nframes; i++) {
+	    for (j = 0; j < frames[i].cell_count; j++) {
+		cell = &cells[frames[i].first_cell + j];
+		anim_dbuf[cell->y][cell->x] = cell->dbe;
+	    }
+	    srv_update_screen(anim_dbuf, ux, uy);
+	    for (j = 0; j < frames[i].delay; j++)
+		srv_delay_output();
+	}
+	return;
+    }
+    
+    jframes = json_array();
+    for (i = 0; i < nframes; i++) {
+	jframe = json_array();
+	json_array_append_new(jframe, json_integer(frames[i].delay));
+	for (j = 0; j < frames[i].cell_count; j++) {
+	    cell = &cells[frames[i].first_cell + j];
+	    json_array_append_new(jframe,
+		json_pack("[i,i,i,i,i,i,i,i,i,i,i,i]", cell->x, cell->y,
+			  cell->dbe.effect, cell->dbe.bg, cell->dbe.trap,
+			  cell->dbe.obj, cell->dbe.obj_mn, cell->dbe.objflags,
+			  cell->dbe.mon, cell->dbe.monflags, cell->dbe.invis,
+			  cell->dbe.dgnflags));
+	}
+	json_array_append_new(jframes, jframe);
+    }
+    
+    add_display_data("play_animation", json_pack("{si,si,so}", "ux", ux,
+						  "uy", uy, "frames", jframes));
+}
+
+
 static void srv_level_changed(int displaymode)
 {
     add_display_data("level_changed", json_integer(displaymode));